@@ -0,0 +1,286 @@
+/**
+ * Drip C++ SDK (C++03) - Fault-injection suite
+ *
+ * Runs a fixed trackUsage workload against the in-process mock server
+ * through a FaultInjectionTransport (tests/fault_transport.hpp), once per
+ * scenario file, and reports goodput and tail latency for each.
+ *
+ * Usage:
+ *   drip_fault_suite [--threads N] [--ops N] [--max-retries N]
+ *                    [--timeout-ms N] [--backoff-ms N] [--circuit-breaker]
+ *                    [SCENARIO.conf ...]
+ *
+ * Without scenario arguments every *.conf in bench/scenarios runs, in
+ * name order. Scenarios are seeded, so the injected fault sequence is the
+ * same on every run; compare --max-retries 0 against the default to see
+ * what the retry policy buys under each.
+ */
+
+#include <drip/drip.hpp>
+#include "mock_server.hpp"
+#include "fault_transport.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+
+#ifndef DRIP_SCENARIO_DIR
+#define DRIP_SCENARIO_DIR "bench/scenarios"
+#endif
+
+// =============================================================================
+// Helpers
+// =============================================================================
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static uint64_t percentile(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.999999);
+    if (rank == 0) rank = 1;
+    if (rank > sorted.size()) rank = sorted.size();
+    return sorted[rank - 1];
+}
+
+static std::vector<std::string> default_scenarios() {
+    std::vector<std::string> paths;
+    DIR* dir = opendir(DRIP_SCENARIO_DIR);
+    if (dir == NULL) return paths;
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 5 && name.compare(name.size() - 5, 5, ".conf") == 0) {
+            paths.push_back(std::string(DRIP_SCENARIO_DIR) + "/" + name);
+        }
+    }
+    closedir(dir);
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+// =============================================================================
+// Workload
+// =============================================================================
+
+struct SuiteOptions {
+    int threads;
+    int ops;
+    int max_retries;
+    int timeout_ms;
+    int backoff_ms;
+    bool circuit_breaker;
+    std::vector<std::string> scenarios;
+
+    SuiteOptions()
+        : threads(8)
+        , ops(2000)
+        , max_retries(3)
+        , timeout_ms(1000)
+        , backoff_ms(50)
+        , circuit_breaker(false)
+    {}
+};
+
+struct Shared {
+    drip::Client* client;
+    std::string customer_id;
+    int ops;
+    int next_op;
+    pthread_mutex_t mutex;
+};
+
+struct Worker {
+    Shared* shared;
+    pthread_t thread;
+    std::vector<uint64_t> latency;   // Successful calls only
+    uint64_t failures;
+    std::string last_error;
+};
+
+static bool take_ticket(Shared& s, int& op) {
+    pthread_mutex_lock(&s.mutex);
+    op = s.next_op < s.ops ? s.next_op++ : -1;
+    pthread_mutex_unlock(&s.mutex);
+    return op >= 0;
+}
+
+static void* worker_main(void* arg) {
+    Worker& w = *static_cast<Worker*>(arg);
+    Shared& s = *w.shared;
+    int op = 0;
+    while (take_ticket(s, op)) {
+        drip::TrackUsageParams p;
+        p.customer_id = s.customer_id;
+        p.meter = "fault_suite";
+        p.quantity = op + 1;   /* Distinct idempotency key per op */
+        uint64_t start = now_ns();
+        try {
+            s.client->trackUsage(p);
+            w.latency.push_back(now_ns() - start);
+        } catch (const std::exception& e) {
+            ++w.failures;
+            w.last_error = e.what();
+        }
+    }
+    return NULL;
+}
+
+static void run_scenario(const SuiteOptions& o, const drip::mock::FaultScenario& scenario,
+                         drip::Transport& inner, const std::string& base_url,
+                         const std::string& customer_id) {
+    drip::mock::FaultInjectionTransport faults(inner, scenario);
+
+    drip::Config cfg;
+    cfg.api_key = "sk_test_fault_suite";
+    cfg.base_url = base_url;
+    cfg.transport = &faults;
+    cfg.timeout_ms = o.timeout_ms;
+    cfg.max_retries = o.max_retries;
+    cfg.retry_backoff_ms = o.backoff_ms;
+    cfg.circuit_breaker.enabled = o.circuit_breaker;
+    drip::Client client(cfg);
+
+    Shared s;
+    s.client = &client;
+    s.customer_id = customer_id;
+    s.ops = o.ops;
+    s.next_op = 0;
+    pthread_mutex_init(&s.mutex, NULL);
+
+    std::vector<Worker> workers(static_cast<size_t>(o.threads));
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].shared = &s;
+        workers[i].failures = 0;
+        workers[i].latency.reserve(static_cast<size_t>(o.ops));
+        pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+    }
+    for (size_t i = 0; i < workers.size(); ++i) pthread_join(workers[i].thread, NULL);
+    double elapsed_s = static_cast<double>(now_ns() - start) / 1e9;
+    pthread_mutex_destroy(&s.mutex);
+
+    std::vector<uint64_t> latency;
+    uint64_t failures = 0;
+    std::string last_error;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        latency.insert(latency.end(), workers[i].latency.begin(), workers[i].latency.end());
+        failures += workers[i].failures;
+        if (!workers[i].last_error.empty()) last_error = workers[i].last_error;
+    }
+    std::sort(latency.begin(), latency.end());
+
+    double ok = static_cast<double>(latency.size());
+    std::printf("  %-16s %6.1f%% %9.1f %8.2f %8.2f %9.3f %9.3f %9.3f\n",
+                scenario.name.c_str(),
+                100.0 * ok / o.ops,
+                ok / elapsed_s,
+                static_cast<double>(faults.requestCount()) / o.ops,
+                static_cast<double>(faults.faultCount()) / o.ops,
+                static_cast<double>(percentile(latency, 50)) / 1e6,
+                static_cast<double>(percentile(latency, 99)) / 1e6,
+                static_cast<double>(percentile(latency, 99.9)) / 1e6);
+    if (failures > 0) {
+        std::printf("  %-16s last error: %s\n", "", last_error.c_str());
+    }
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+static void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options] [SCENARIO.conf ...]\n"
+              << "  --threads N       Concurrent callers sharing one Client (default 8)\n"
+              << "  --ops N           trackUsage calls per scenario (default 2000)\n"
+              << "  --max-retries N   Config::max_retries (default 3)\n"
+              << "  --timeout-ms N    Config::timeout_ms (default 1000)\n"
+              << "  --backoff-ms N    Config::retry_backoff_ms (default 50)\n"
+              << "  --circuit-breaker Enable the per-endpoint circuit breaker (default settings)\n"
+              << "Default scenarios: " << DRIP_SCENARIO_DIR << "/*.conf\n";
+}
+
+static bool parse_args(int argc, char** argv, SuiteOptions& o) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            o.scenarios.push_back(arg);
+            continue;
+        }
+        if (arg == "--circuit-breaker") {
+            o.circuit_breaker = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* v = argv[++i];
+        if (arg == "--threads") o.threads = std::atoi(v);
+        else if (arg == "--ops") o.ops = std::atoi(v);
+        else if (arg == "--max-retries") o.max_retries = std::atoi(v);
+        else if (arg == "--timeout-ms") o.timeout_ms = std::atoi(v);
+        else if (arg == "--backoff-ms") o.backoff_ms = std::atoi(v);
+        else return false;
+    }
+    if (o.threads < 1 || o.ops < 1) return false;
+    if (o.scenarios.empty()) o.scenarios = default_scenarios();
+    return !o.scenarios.empty();
+}
+
+int main(int argc, char** argv) {
+    SuiteOptions o;
+    if (!parse_args(argc, argv, o)) {
+        usage(argv[0]);
+        return 2;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::vector<drip::mock::FaultScenario> scenarios;
+    try {
+        for (size_t i = 0; i < o.scenarios.size(); ++i) {
+            scenarios.push_back(drip::mock::load_fault_scenario(o.scenarios[i]));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    drip::mock::MockServer mock;
+    mock.start();
+    drip::CurlTransport inner;
+
+    std::string customer_id;
+    try {
+        drip::Config cfg;
+        cfg.api_key = "sk_test_fault_suite";
+        cfg.base_url = mock.baseUrl();
+        drip::Client setup(cfg);
+        drip::CreateCustomerParams cp;
+        cp.external_customer_id = "fault_suite";
+        customer_id = setup.createCustomer(cp).id;
+    } catch (const std::exception& e) {
+        std::cerr << "Setup failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::printf("Drip fault suite: %d ops, %d threads, max_retries=%d, timeout=%d ms%s\n\n",
+                o.ops, o.threads, o.max_retries, o.timeout_ms,
+                o.circuit_breaker ? ", circuit breaker" : "");
+    std::printf("  %-16s %7s %9s %8s %8s %9s %9s %9s\n", "scenario", "success", "goodput/s",
+                "att/op", "flt/op", "p50 ms", "p99 ms", "p99.9 ms");
+    for (size_t i = 0; i < scenarios.size(); ++i) {
+        run_scenario(o, scenarios[i], inner, mock.baseUrl(), customer_id);
+    }
+
+    mock.stop();
+    return 0;
+}
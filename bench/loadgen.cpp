@@ -0,0 +1,587 @@
+/**
+ * Drip C++ SDK (C++03) - Load generator
+ *
+ * Drives one shared Client from N threads against a Drip endpoint
+ * (normally drip_mock_server) and reports throughput, latency percentiles,
+ * CPU time and heap allocations per operation.
+ *
+ * Closed loop (default): every thread issues its next call as soon as the
+ * previous one returns. Open loop (--rate): calls are scheduled at a fixed
+ * rate and latency is measured from the scheduled start, so queueing delay
+ * when the client falls behind is included (no coordinated omission).
+ *
+ * Usage:
+ *   drip_loadgen [--mock | --url URL] [--workload usage,event,run,customer]
+ *                [--threads N] [--duration-s S | --ops N] [--rate QPS]
+ *                [--events N] [--metadata-keys N] [--metadata-bytes N]
+ *                [--warmup N] [--ack-only] [--no-conditional]
+ *                [--mock-latency-ms N]
+ *
+ * CPU time and allocations are measured on the calling threads only, so
+ * an in-process mock (--mock) does not inflate them. Allocation counts
+ * cover C++ operator new (SDK, picojson, STL); libcurl's malloc() calls
+ * are not included.
+ */
+
+#include <drip/drip.hpp>
+#include "mock_server.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+
+#include <pthread.h>
+#include <time.h>
+#include <sys/time.h>
+
+// =============================================================================
+// Allocation counting
+// =============================================================================
+
+/*
+ * Counted per thread and only on measured worker threads, so the
+ * in-process mock server and setup work do not show up in the numbers.
+ * __thread is a GCC/Clang extension (C++03 has no thread_local).
+ */
+static __thread bool t_counting = false;
+static __thread uint64_t t_alloc_count = 0;
+static __thread uint64_t t_alloc_bytes = 0;
+
+#if __cplusplus >= 201103L
+#define LOADGEN_THROW_BAD_ALLOC
+#define LOADGEN_NOTHROW noexcept
+#else
+#define LOADGEN_THROW_BAD_ALLOC throw(std::bad_alloc)
+#define LOADGEN_NOTHROW throw()
+#endif
+
+static void* counted_alloc(std::size_t size) {
+    if (t_counting) {
+        ++t_alloc_count;
+        t_alloc_bytes += size;
+    }
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size) LOADGEN_THROW_BAD_ALLOC { return counted_alloc(size); }
+void* operator new[](std::size_t size) LOADGEN_THROW_BAD_ALLOC { return counted_alloc(size); }
+void operator delete(void* p) LOADGEN_NOTHROW { std::free(p); }
+void operator delete[](void* p) LOADGEN_NOTHROW { std::free(p); }
+
+// =============================================================================
+// Helpers
+// =============================================================================
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static void sleep_until_ns(uint64_t deadline) {
+    for (;;) {
+        uint64_t now = now_ns();
+        if (now >= deadline) return;
+        uint64_t wait = deadline - now;
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(wait / 1000000000ULL);
+        ts.tv_nsec = static_cast<long>(wait % 1000000000ULL);
+        nanosleep(&ts, NULL);
+    }
+}
+
+/** CPU time consumed by the calling thread. */
+static uint64_t thread_cpu_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static uint64_t percentile(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.999999);
+    if (rank == 0) rank = 1;
+    if (rank > sorted.size()) rank = sorted.size();
+    return sorted[rank - 1];
+}
+
+// =============================================================================
+// Workloads
+// =============================================================================
+
+enum Operation {
+    OP_USAGE,      // trackUsage
+    OP_EVENT,      // emitEvent on a per-thread run
+    OP_RUN,        // recordRun with --events events
+    OP_CUSTOMER,   // getCustomer
+    OP_COUNT
+};
+
+static const char* op_name(Operation op) {
+    switch (op) {
+        case OP_USAGE:    return "trackUsage";
+        case OP_EVENT:    return "emitEvent";
+        case OP_RUN:      return "recordRun";
+        case OP_CUSTOMER: return "getCustomer";
+        default:          return "unknown";
+    }
+}
+
+struct LoadOptions {
+    std::string url;
+    std::string api_key;
+    bool mock;
+    int mock_latency_ms;
+    std::vector<Operation> workload;
+    int threads;
+    double duration_s;
+    uint64_t ops;          // 0 = run for duration_s
+    double rate;           // 0 = closed loop
+    int events;
+    int metadata_keys;
+    int metadata_bytes;
+    int warmup;            // Operations per thread before measuring
+    bool ack_only;
+    bool conditional;
+    int customers;
+
+    LoadOptions()
+        : mock(false)
+        , mock_latency_ms(0)
+        , threads(4)
+        , duration_s(10.0)
+        , ops(0)
+        , rate(0.0)
+        , events(5)
+        , metadata_keys(0)
+        , metadata_bytes(32)
+        , warmup(10)
+        , ack_only(false)
+        , conditional(true)
+        , customers(8)
+    {}
+};
+
+struct Shared {
+    const LoadOptions* options;
+    drip::Client* client;
+    std::vector<std::string> customer_ids;
+    std::string workflow_slug;
+    std::string workflow_id;
+    drip::Metadata metadata;
+
+    /* Start barrier */
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int ready;
+    bool go;
+
+    uint64_t start_ns;
+    uint64_t end_ns;          // Duration mode deadline
+    volatile uint64_t next_ticket;
+    volatile int stop;
+};
+
+struct Worker {
+    Shared* shared;
+    int index;
+    pthread_t thread;
+    std::string run_id;
+    uint64_t sequence;
+
+    std::vector<uint64_t> latency[OP_COUNT];   // ns, from scheduled start
+    std::vector<uint64_t> service[OP_COUNT];   // ns, from actual start
+    uint64_t errors[OP_COUNT];
+    std::string last_error;
+
+    uint64_t cpu_ns;
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+
+    Worker() : shared(NULL), index(0), sequence(0), cpu_ns(0), allocs(0), alloc_bytes(0) {
+        for (int i = 0; i < OP_COUNT; ++i) errors[i] = 0;
+    }
+};
+
+static void run_operation(Worker& w, Operation op) {
+    Shared& s = *w.shared;
+    const LoadOptions& o = *s.options;
+    std::ostringstream key;
+    key << "lg_" << w.index << "_" << w.sequence++;
+    drip::RequestOptions ropts;
+    ropts.ack_only = o.ack_only;
+
+    const std::string& customer = s.customer_ids[w.sequence % s.customer_ids.size()];
+
+    switch (op) {
+        case OP_USAGE: {
+            drip::TrackUsageParams p;
+            p.customer_id = customer;
+            p.meter = "tokens";
+            p.quantity = 100;
+            p.idempotency_key = key.str();
+            p.metadata = s.metadata;
+            s.client->trackUsage(p, ropts);
+            break;
+        }
+        case OP_EVENT: {
+            drip::EmitEventParams p;
+            p.run_id = w.run_id;
+            p.event_type = "loadgen.step";
+            p.quantity = 1;
+            p.cost_units = 0.001;
+            p.idempotency_key = key.str();
+            p.metadata = s.metadata;
+            s.client->emitEvent(p, ropts);
+            break;
+        }
+        case OP_RUN: {
+            drip::RecordRunParams p;
+            p.customer_id = customer;
+            p.workflow = s.workflow_slug;
+            p.status = drip::RUN_COMPLETED;
+            p.external_run_id = key.str();
+            p.metadata = s.metadata;
+            for (int i = 0; i < o.events; ++i) {
+                drip::RecordRunEvent evt;
+                evt.event_type = "loadgen.step";
+                evt.quantity = 1;
+                evt.cost_units = 0.001;
+                evt.metadata = s.metadata;
+                p.events.push_back(evt);
+            }
+            s.client->recordRun(p, ropts);
+            break;
+        }
+        case OP_CUSTOMER:
+            s.client->getCustomer(customer, ropts);
+            break;
+        default:
+            break;
+    }
+}
+
+static void* worker_main(void* arg) {
+    Worker& w = *static_cast<Worker*>(arg);
+    Shared& s = *w.shared;
+    const LoadOptions& o = *s.options;
+    size_t mix = o.workload.size();
+
+    /* Warmup is not measured */
+    for (int i = 0; i < o.warmup; ++i) {
+        try {
+            run_operation(w, o.workload[i % mix]);
+        } catch (const std::exception&) {
+        }
+    }
+
+    pthread_mutex_lock(&s.mutex);
+    ++s.ready;
+    pthread_cond_broadcast(&s.cond);
+    while (!s.go) pthread_cond_wait(&s.cond, &s.mutex);
+    pthread_mutex_unlock(&s.mutex);
+
+    uint64_t interval_ns = o.rate > 0.0 ? static_cast<uint64_t>(1e9 / o.rate) : 0;
+    uint64_t cpu_start = thread_cpu_ns();
+    t_counting = true;
+
+    while (!s.stop) {
+        uint64_t ticket = __sync_fetch_and_add(&s.next_ticket, 1);
+        if (o.ops > 0 && ticket >= o.ops) break;
+
+        uint64_t scheduled;
+        if (interval_ns > 0) {
+            scheduled = s.start_ns + ticket * interval_ns;
+            if (o.ops == 0 && scheduled >= s.end_ns) break;
+            sleep_until_ns(scheduled);
+        } else {
+            scheduled = now_ns();
+            if (o.ops == 0 && scheduled >= s.end_ns) break;
+        }
+
+        Operation op = o.workload[ticket % mix];
+        uint64_t started = now_ns();
+        try {
+            run_operation(w, op);
+            uint64_t done = now_ns();
+            w.latency[op].push_back(done - scheduled);
+            w.service[op].push_back(done - started);
+        } catch (const std::exception& e) {
+            ++w.errors[op];
+            w.last_error = e.what();
+        }
+    }
+
+    t_counting = false;
+    w.cpu_ns = thread_cpu_ns() - cpu_start;
+    w.allocs = t_alloc_count;
+    w.alloc_bytes = t_alloc_bytes;
+    return NULL;
+}
+
+// =============================================================================
+// Setup and report
+// =============================================================================
+
+static bool parse_workload(const std::string& spec, std::vector<Operation>& out) {
+    std::istringstream in(spec);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (item == "usage") out.push_back(OP_USAGE);
+        else if (item == "event") out.push_back(OP_EVENT);
+        else if (item == "run") out.push_back(OP_RUN);
+        else if (item == "customer") out.push_back(OP_CUSTOMER);
+        else return false;
+    }
+    return !out.empty();
+}
+
+static void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options]\n"
+              << "  --mock               Start an in-process mock server (default if no --url)\n"
+              << "  --mock-latency-ms N  Latency added by the in-process mock\n"
+              << "  --url URL            Target base URL (default $DRIP_BASE_URL)\n"
+              << "  --api-key KEY        API key (default $DRIP_API_KEY or sk_test_loadgen)\n"
+              << "  --workload LIST      Comma-separated mix of usage,event,run,customer (default usage)\n"
+              << "  --threads N          Concurrent callers sharing one Client (default 4)\n"
+              << "  --duration-s S       Measured duration (default 10)\n"
+              << "  --ops N              Stop after N operations instead of a duration\n"
+              << "  --rate QPS           Open loop at a fixed arrival rate (default closed loop)\n"
+              << "  --events N           Events per recordRun (default 5)\n"
+              << "  --metadata-keys N    Metadata entries per call (default 0)\n"
+              << "  --metadata-bytes N   Bytes per metadata value (default 32)\n"
+              << "  --customers N        Customers to spread calls over (default 8)\n"
+              << "  --warmup N           Unmeasured operations per thread (default 10)\n"
+              << "  --ack-only           Send calls in ack-only mode\n"
+              << "  --no-conditional     Disable ETag revalidation of customer/workflow reads\n";
+}
+
+static bool parse_args(int argc, char** argv, LoadOptions& o) {
+    std::string workload = "usage";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (arg == "--mock") { o.mock = true; continue; }
+        if (arg == "--ack-only") { o.ack_only = true; continue; }
+        if (arg == "--no-conditional") { o.conditional = false; continue; }
+        if (v == NULL) return false;
+        ++i;
+
+        if (arg == "--url") o.url = v;
+        else if (arg == "--api-key") o.api_key = v;
+        else if (arg == "--mock-latency-ms") o.mock_latency_ms = std::atoi(v);
+        else if (arg == "--workload") workload = v;
+        else if (arg == "--threads") o.threads = std::atoi(v);
+        else if (arg == "--duration-s") o.duration_s = std::atof(v);
+        else if (arg == "--ops") o.ops = strtoull(v, NULL, 10);
+        else if (arg == "--rate") o.rate = std::atof(v);
+        else if (arg == "--events") o.events = std::atoi(v);
+        else if (arg == "--metadata-keys") o.metadata_keys = std::atoi(v);
+        else if (arg == "--metadata-bytes") o.metadata_bytes = std::atoi(v);
+        else if (arg == "--customers") o.customers = std::atoi(v);
+        else if (arg == "--warmup") o.warmup = std::atoi(v);
+        else return false;
+    }
+
+    if (!parse_workload(workload, o.workload)) return false;
+    if (o.threads < 1 || o.customers < 1) return false;
+
+    if (o.url.empty() && !o.mock) {
+        const char* env = std::getenv("DRIP_BASE_URL");
+        if (env != NULL && env[0] != '\0') o.url = env;
+        else o.mock = true;
+    }
+    if (o.api_key.empty()) {
+        const char* env = std::getenv("DRIP_API_KEY");
+        o.api_key = (env != NULL && env[0] != '\0') ? env : "sk_test_loadgen";
+    }
+    return true;
+}
+
+static void print_row(const char* name, std::vector<uint64_t>& samples, uint64_t errors) {
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (size_t i = 0; i < samples.size(); ++i) sum += static_cast<double>(samples[i]);
+    double mean = samples.empty() ? 0 : sum / static_cast<double>(samples.size());
+
+    std::printf("  %-16s %9lu %7lu %9.3f %9.3f %9.3f %9.3f %9.3f\n", name,
+                static_cast<unsigned long>(samples.size()), static_cast<unsigned long>(errors),
+                mean / 1e6,
+                static_cast<double>(percentile(samples, 50)) / 1e6,
+                static_cast<double>(percentile(samples, 99)) / 1e6,
+                static_cast<double>(percentile(samples, 99.9)) / 1e6,
+                static_cast<double>(samples.empty() ? 0 : samples.back()) / 1e6);
+}
+
+int main(int argc, char** argv) {
+    LoadOptions o;
+    if (!parse_args(argc, argv, o)) {
+        usage(argv[0]);
+        return 2;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+
+    drip::mock::MockServer* mock = NULL;
+    if (o.mock) {
+        drip::mock::MockServerOptions mo;
+        mo.latency_ms = o.mock_latency_ms;
+        mock = new drip::mock::MockServer(mo);
+        mock->start();
+        o.url = mock->baseUrl();
+    }
+
+    drip::Config cfg;
+    cfg.api_key = o.api_key;
+    cfg.base_url = o.url;
+    cfg.conditional_gets.enabled = o.conditional;
+    drip::Client client(cfg);
+
+    Shared s;
+    s.options = &o;
+    s.client = &client;
+    s.ready = 0;
+    s.go = false;
+    s.next_ticket = 0;
+    s.stop = 0;
+    pthread_mutex_init(&s.mutex, NULL);
+    pthread_cond_init(&s.cond, NULL);
+
+    std::vector<Worker> workers(static_cast<size_t>(o.threads));
+    try {
+        /* Fixtures: customers, a workflow, and one open run per thread */
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), "%ld", static_cast<long>(time(NULL)));
+        for (int i = 0; i < o.customers; ++i) {
+            drip::CreateCustomerParams cp;
+            std::ostringstream ext;
+            ext << "loadgen_" << suffix << "_" << i;
+            cp.external_customer_id = ext.str();
+            s.customer_ids.push_back(client.createCustomer(cp).id);
+        }
+        for (int i = 0; i < o.metadata_keys; ++i) {
+            std::ostringstream k;
+            k << "key_" << i;
+            s.metadata[k.str()] = std::string(static_cast<size_t>(o.metadata_bytes), 'x');
+        }
+        s.workflow_slug = std::string("loadgen-") + suffix;
+
+        drip::RecordRunParams seed;
+        seed.customer_id = s.customer_ids[0];
+        seed.workflow = s.workflow_slug;
+        seed.status = drip::RUN_COMPLETED;
+        drip::RecordRunEvent evt;
+        evt.event_type = "loadgen.seed";
+        seed.events.push_back(evt);
+        s.workflow_id = client.recordRun(seed).run.workflow_id;
+
+        for (size_t i = 0; i < workers.size(); ++i) {
+            drip::StartRunParams rp;
+            rp.customer_id = s.customer_ids[i % s.customer_ids.size()];
+            rp.workflow_id = s.workflow_id;
+            workers[i].run_id = client.startRun(rp).id;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Setup against " << o.url << " failed: " << e.what() << std::endl;
+        delete mock;
+        return 1;
+    }
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].shared = &s;
+        workers[i].index = static_cast<int>(i);
+        for (int op = 0; op < OP_COUNT; ++op) workers[i].latency[op].reserve(1 << 16);
+        for (int op = 0; op < OP_COUNT; ++op) workers[i].service[op].reserve(1 << 16);
+        pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+    }
+
+    /* Release all workers at once, after warmup */
+    pthread_mutex_lock(&s.mutex);
+    while (s.ready < o.threads) pthread_cond_wait(&s.cond, &s.mutex);
+    s.start_ns = now_ns();
+    s.end_ns = s.start_ns + static_cast<uint64_t>(o.duration_s * 1e9);
+    s.go = true;
+    pthread_cond_broadcast(&s.cond);
+    pthread_mutex_unlock(&s.mutex);
+
+    for (size_t i = 0; i < workers.size(); ++i) pthread_join(workers[i].thread, NULL);
+
+    uint64_t elapsed_ns = now_ns() - s.start_ns;
+    double cpu = 0;
+    uint64_t allocs = 0;
+    uint64_t alloc_bytes = 0;
+
+    /* Merge per-thread samples */
+    std::vector<uint64_t> latency[OP_COUNT];
+    std::vector<uint64_t> service[OP_COUNT];
+    uint64_t errors[OP_COUNT] = {0, 0, 0, 0};
+    std::vector<uint64_t> all_latency;
+    uint64_t total_errors = 0;
+    std::string last_error;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        for (int op = 0; op < OP_COUNT; ++op) {
+            latency[op].insert(latency[op].end(), workers[i].latency[op].begin(), workers[i].latency[op].end());
+            service[op].insert(service[op].end(), workers[i].service[op].begin(), workers[i].service[op].end());
+            all_latency.insert(all_latency.end(), workers[i].latency[op].begin(), workers[i].latency[op].end());
+            errors[op] += workers[i].errors[op];
+            total_errors += workers[i].errors[op];
+        }
+        if (!workers[i].last_error.empty()) last_error = workers[i].last_error;
+        cpu += static_cast<double>(workers[i].cpu_ns) / 1e9;
+        allocs += workers[i].allocs;
+        alloc_bytes += workers[i].alloc_bytes;
+    }
+
+    uint64_t ok = all_latency.size();
+    uint64_t total = ok + total_errors;
+    double seconds = static_cast<double>(elapsed_ns) / 1e9;
+
+    std::printf("\nDrip loadgen: %s, %d threads, %s loop", o.url.c_str(), o.threads,
+                o.rate > 0 ? "open" : "closed");
+    if (o.rate > 0) std::printf(" at %.0f/s", o.rate);
+    std::printf("%s\n\n", o.ack_only ? ", ack-only" : "");
+
+    std::printf("  operations        %lu ok, %lu failed in %.2fs\n",
+                static_cast<unsigned long>(ok), static_cast<unsigned long>(total_errors), seconds);
+    std::printf("  throughput        %.1f ops/s\n", seconds > 0 ? static_cast<double>(total) / seconds : 0.0);
+    std::printf("  cpu               %.1f us/op (%.1f%% of one core)\n",
+                total > 0 ? cpu * 1e6 / static_cast<double>(total) : 0.0,
+                seconds > 0 ? cpu * 100.0 / seconds : 0.0);
+    std::printf("  allocations       %.1f/op, %.0f bytes/op (operator new)\n",
+                total > 0 ? static_cast<double>(allocs) / static_cast<double>(total) : 0.0,
+                total > 0 ? static_cast<double>(alloc_bytes) / static_cast<double>(total) : 0.0);
+
+    std::printf("\n  latency (ms)         count  errors      mean       p50       p99     p99.9       max\n");
+    for (int op = 0; op < OP_COUNT; ++op) {
+        if (latency[op].empty() && errors[op] == 0) continue;
+        print_row(op_name(static_cast<Operation>(op)), latency[op], errors[op]);
+    }
+    print_row("all", all_latency, total_errors);
+
+    if (o.rate > 0) {
+        std::printf("\n  service time (ms, excludes queueing behind schedule)\n");
+        for (int op = 0; op < OP_COUNT; ++op) {
+            if (service[op].empty()) continue;
+            print_row(op_name(static_cast<Operation>(op)), service[op], errors[op]);
+        }
+    }
+
+    if (!last_error.empty()) std::printf("\n  last error: %s\n", last_error.c_str());
+    std::printf("\n");
+
+    if (mock != NULL) {
+        mock->stop();
+        delete mock;
+    }
+    pthread_cond_destroy(&s.cond);
+    pthread_mutex_destroy(&s.mutex);
+    return total_errors > 0 && ok == 0 ? 1 : 0;
+}
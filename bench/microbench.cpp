@@ -0,0 +1,322 @@
+/**
+ * Drip C++ SDK (C++03) - CPU microbenchmarks
+ *
+ * Times the pure-CPU hot paths behind every request: metadata conversion,
+ * request-body construction and serialization, response parsing,
+ * idempotency keys and run status mapping. No network involved.
+ *
+ * Usage:
+ *   drip_microbench [--filter SUBSTRING] [--min-time-ms N]
+ *
+ * Each case reports ns/op and operator-new allocations per op. Cases are
+ * parameterized by metadata entries (/m<N>) and event or record counts
+ * (/e<N>, /n<N>).
+ */
+
+#include "codec.hpp"
+
+#include <picojson/picojson.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+
+#include <time.h>
+
+using namespace drip;
+using namespace drip::detail;
+
+// =============================================================================
+// Harness
+// =============================================================================
+
+static uint64_t g_allocs = 0;
+
+#if __cplusplus >= 201103L
+#define MICROBENCH_THROW_BAD_ALLOC
+#define MICROBENCH_NOTHROW noexcept
+#else
+#define MICROBENCH_THROW_BAD_ALLOC throw(std::bad_alloc)
+#define MICROBENCH_NOTHROW throw()
+#endif
+
+/* Single-threaded, so a plain counter is enough */
+static void* counted_alloc(std::size_t size) {
+    ++g_allocs;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size) MICROBENCH_THROW_BAD_ALLOC { return counted_alloc(size); }
+void* operator new[](std::size_t size) MICROBENCH_THROW_BAD_ALLOC { return counted_alloc(size); }
+void operator delete(void* p) MICROBENCH_NOTHROW { std::free(p); }
+void operator delete[](void* p) MICROBENCH_NOTHROW { std::free(p); }
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+/* Results feed this so the optimizer cannot drop the work */
+static volatile size_t g_sink = 0;
+
+/** One benchmark case: run() performs a single operation. */
+class Case {
+public:
+    virtual ~Case() {}
+    virtual std::string name() const = 0;
+    virtual void run() = 0;
+};
+
+static uint64_t g_min_time_ns = 200000000ULL;
+
+static void measure(Case& c) {
+    /* Warm up, then grow the batch until it fills the minimum time */
+    c.run();
+    uint64_t iterations = 1;
+    uint64_t elapsed = 0;
+    uint64_t allocs = 0;
+    for (;;) {
+        uint64_t allocs_start = g_allocs;
+        uint64_t start = now_ns();
+        for (uint64_t i = 0; i < iterations; ++i) c.run();
+        elapsed = now_ns() - start;
+        allocs = g_allocs - allocs_start;
+        if (elapsed >= g_min_time_ns) break;
+        uint64_t next = elapsed > 0 ? iterations * g_min_time_ns / elapsed + 1 : iterations * 100;
+        if (next > iterations * 100) next = iterations * 100;
+        iterations = next > iterations ? next : iterations * 2;
+    }
+
+    std::printf("  %-36s %12.1f ns/op %10.1f allocs/op %12lu iters\n", c.name().c_str(),
+                static_cast<double>(elapsed) / static_cast<double>(iterations),
+                static_cast<double>(allocs) / static_cast<double>(iterations),
+                static_cast<unsigned long>(iterations));
+}
+
+// =============================================================================
+// Inputs
+// =============================================================================
+
+static Metadata make_metadata(int entries) {
+    Metadata m;
+    for (int i = 0; i < entries; ++i) {
+        std::ostringstream k, v;
+        k << "attribute_" << i;
+        v << "value-" << i << "-abcdefghijklmnopqrstuvwxyz";
+        m[k.str()] = v.str();
+    }
+    return m;
+}
+
+static std::string label(const char* base, char tag, int n) {
+    std::ostringstream oss;
+    oss << base << "/" << tag << n;
+    return oss.str();
+}
+
+static std::string customer_json(int metadata_entries, int index) {
+    JsonObj c;
+    std::ostringstream id;
+    id << "cus_" << (1000000 + index);
+    c["id"] = jstr(id.str());
+    c["externalCustomerId"] = jstr("user_" + id.str());
+    c["status"] = jstr("ACTIVE");
+    c["isInternal"] = jbool(false);
+    c["metadata"] = metadata_to_json(make_metadata(metadata_entries));
+    c["createdAt"] = jstr("2026-01-15T10:30:00.000Z");
+    c["updatedAt"] = jstr("2026-01-15T10:30:00.000Z");
+    return JsonVal(c).serialize();
+}
+
+// =============================================================================
+// Cases
+// =============================================================================
+
+class MetadataToJson : public Case {
+public:
+    explicit MetadataToJson(int n) : n_(n), m_(make_metadata(n)) {}
+    std::string name() const { return label("metadata_to_json", 'm', n_); }
+    void run() { g_sink += metadata_to_json(m_).get<JsonObj>().size(); }
+private:
+    int n_;
+    Metadata m_;
+};
+
+class MetadataFromJson : public Case {
+public:
+    explicit MetadataFromJson(int n) : n_(n), v_(metadata_to_json(make_metadata(n))) {}
+    std::string name() const { return label("metadata_from_json", 'm', n_); }
+    void run() { g_sink += metadata_from_json(v_).size(); }
+private:
+    int n_;
+    JsonVal v_;
+};
+
+class TrackUsageBody : public Case {
+public:
+    explicit TrackUsageBody(int n) : n_(n) {
+        p_.customer_id = "cus_1234567890";
+        p_.meter = "tokens";
+        p_.quantity = 1500;
+        p_.units = "tokens";
+        p_.metadata = make_metadata(n);
+    }
+    std::string name() const { return label("trackUsage body+serialize", 'm', n_); }
+    void run() { g_sink += JsonVal(track_usage_body(p_)).serialize().size(); }
+private:
+    int n_;
+    TrackUsageParams p_;
+};
+
+class EmitEventBody : public Case {
+public:
+    explicit EmitEventBody(int n) : n_(n) {
+        p_.run_id = "run_1234567890";
+        p_.event_type = "llm.completion";
+        p_.quantity = 42;
+        p_.cost_units = 0.0021;
+        p_.metadata = make_metadata(n);
+    }
+    std::string name() const { return label("emitEvent body+serialize", 'm', n_); }
+    void run() { g_sink += JsonVal(emit_event_body(p_)).serialize().size(); }
+private:
+    int n_;
+    EmitEventParams p_;
+};
+
+class BatchBody : public Case {
+public:
+    BatchBody(int events, int metadata) : events_(events), metadata_(metadata) {
+        for (int i = 0; i < events; ++i) {
+            RecordRunEvent e;
+            e.event_type = "step.completed";
+            e.quantity = i + 1;
+            e.cost_units = 0.001;
+            e.metadata = make_metadata(metadata);
+            list_.push_back(e);
+        }
+    }
+    std::string name() const {
+        std::ostringstream oss;
+        oss << "batch body+serialize/e" << events_ << "/m" << metadata_;
+        return oss.str();
+    }
+    void run() { g_sink += JsonVal(run_events_batch_body("run_1234567890", "", list_)).serialize().size(); }
+private:
+    int events_;
+    int metadata_;
+    std::vector<RecordRunEvent> list_;
+};
+
+class ParseCustomer : public Case {
+public:
+    explicit ParseCustomer(int n) : n_(n), body_(customer_json(n, 0)) {}
+    std::string name() const { return label("parse customer", 'm', n_); }
+    void run() {
+        JsonVal v;
+        picojson::parse(v, body_);
+        g_sink += parse_customer(v.get<JsonObj>()).id.size();
+    }
+private:
+    int n_;
+    std::string body_;
+};
+
+class ParseCustomerList : public Case {
+public:
+    explicit ParseCustomerList(int n) : n_(n) {
+        std::ostringstream oss;
+        oss << "{\"data\":[";
+        for (int i = 0; i < n; ++i) oss << (i ? "," : "") << customer_json(4, i);
+        oss << "],\"count\":" << n << "}";
+        body_ = oss.str();
+    }
+    std::string name() const { return label("parse customer list", 'n', n_); }
+    void run() {
+        JsonVal v;
+        picojson::parse(v, body_);
+        JsonArr arr = json_arr(v.get<JsonObj>(), "data");
+        for (size_t i = 0; i < arr.size(); ++i) g_sink += parse_customer(arr[i].get<JsonObj>()).id.size();
+    }
+private:
+    int n_;
+    std::string body_;
+};
+
+class ParseUsageResponse : public Case {
+public:
+    ParseUsageResponse()
+        : body_("{\"success\":true,\"usageEventId\":\"use_0000012345\",\"customerId\":\"cus_1234567890\","
+                "\"usageType\":\"tokens\",\"quantity\":1500,\"isInternal\":false,\"message\":\"Usage recorded\"}") {}
+    std::string name() const { return "parse usage response"; }
+    void run() {
+        JsonVal v;
+        picojson::parse(v, body_);
+        const JsonObj& o = v.get<JsonObj>();
+        g_sink += json_string(o, "usageEventId").size() + static_cast<size_t>(json_double(o, "quantity"));
+    }
+private:
+    std::string body_;
+};
+
+class IdempotencyKey : public Case {
+public:
+    std::string name() const { return "make_idempotency_key"; }
+    void run() { g_sink += make_idempotency_key("track", "cus_1234567890", "tokens", 1500.5).size(); }
+};
+
+class RunStatusFromString : public Case {
+public:
+    std::string name() const { return "run_status_from_string"; }
+    void run() {
+        static const std::string names[] = { "PENDING", "RUNNING", "COMPLETED", "FAILED", "CANCELLED", "TIMEOUT" };
+        for (int i = 0; i < 6; ++i) g_sink += static_cast<size_t>(run_status_from_string(names[i]));
+    }
+};
+
+// =============================================================================
+// Main
+// =============================================================================
+
+int main(int argc, char** argv) {
+    std::string filter;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--filter") filter = argv[i + 1];
+        else if (arg == "--min-time-ms") g_min_time_ns = strtoull(argv[i + 1], NULL, 10) * 1000000ULL;
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--filter SUBSTRING] [--min-time-ms N]" << std::endl;
+            return 2;
+        }
+    }
+
+    static const int METADATA_SIZES[] = { 0, 4, 16, 64 };
+    static const int EVENT_COUNTS[] = { 1, 10, 100 };
+
+    std::vector<Case*> cases;
+    for (size_t i = 0; i < 4; ++i) cases.push_back(new MetadataToJson(METADATA_SIZES[i]));
+    for (size_t i = 0; i < 4; ++i) cases.push_back(new MetadataFromJson(METADATA_SIZES[i]));
+    for (size_t i = 0; i < 4; ++i) cases.push_back(new TrackUsageBody(METADATA_SIZES[i]));
+    for (size_t i = 0; i < 4; ++i) cases.push_back(new EmitEventBody(METADATA_SIZES[i]));
+    for (size_t i = 0; i < 3; ++i) cases.push_back(new BatchBody(EVENT_COUNTS[i], 0));
+    for (size_t i = 0; i < 3; ++i) cases.push_back(new BatchBody(EVENT_COUNTS[i], 4));
+    cases.push_back(new ParseUsageResponse());
+    for (size_t i = 0; i < 4; ++i) cases.push_back(new ParseCustomer(METADATA_SIZES[i]));
+    for (size_t i = 0; i < 3; ++i) cases.push_back(new ParseCustomerList(EVENT_COUNTS[i]));
+    cases.push_back(new IdempotencyKey());
+    cases.push_back(new RunStatusFromString());
+
+    std::printf("Drip C++ SDK microbenchmarks\n\n");
+    for (size_t i = 0; i < cases.size(); ++i) {
+        if (filter.empty() || cases[i]->name().find(filter) != std::string::npos) measure(*cases[i]);
+        delete cases[i];
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef DRIP_CANCELLATION_HPP
+#define DRIP_CANCELLATION_HPP
+
+/* C++03: use <stdint.h> instead of <cstdint> */
+#include <stdint.h>
+
+namespace drip {
+
+/**
+ * Cooperative cancellation for SDK calls. Pass via
+ * RequestOptions::cancellation, then call cancel() from any thread: the
+ * call in progress aborts its transfer (within a few tens of
+ * milliseconds), skips any remaining retries or recordRun() steps, and
+ * throws CancelledError. Calls started with an already-cancelled token
+ * throw before sending anything.
+ *
+ * One token may be shared by several calls to cancel them together.
+ * Cancellation is permanent; use a new token for new work.
+ */
+class CancellationToken {
+public:
+    CancellationToken();
+
+    /** Request cancellation. Thread-safe and idempotent. */
+    void cancel();
+
+    bool isCancelled() const;
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    CancellationToken(const CancellationToken&);
+    CancellationToken& operator=(const CancellationToken&);
+
+    volatile uint64_t cancelled_;
+};
+
+} // namespace drip
+
+#endif // DRIP_CANCELLATION_HPP
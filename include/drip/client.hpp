@@ -3,6 +3,7 @@
 
 #include "types.hpp"
 #include "errors.hpp"
+#include "metrics.hpp"
 
 #include <string>
 
@@ -11,8 +12,15 @@ namespace drip {
 /**
  * Drip SDK Client - C++03 compatible interface for Drip's REST API.
  *
+ * A Client may be shared between threads. Connections are pooled and
+ * reused across calls.
+ *
+ * Every call takes an optional RequestOptions; set options.info to get
+ * the DNS / connect / TLS / server / download timing of that call.
+ *
  * Core methods:
  *   - ping()        - Health check and latency measurement
+ *   - health()      - Latest background health check, no round trip
  *   - trackUsage()  - Record usage without billing
  *   - recordRun()   - Record a complete execution with events
  *   - startRun()    - Start a run for incremental event emission
@@ -55,6 +63,24 @@ public:
     /** The detected key type (secret, public, unknown). */
     KeyType key_type() const;
 
+    /**
+     * Snapshot of per-endpoint request counts, errors, bytes and latency
+     * histograms recorded by this client. Lock-free; safe to call from any
+     * thread while requests are in flight.
+     */
+    MetricsSnapshot metrics() const;
+
+    /**
+     * The same metrics in Prometheus text exposition format, ready to serve
+     * from a /metrics handler. Reads the live counters directly (no snapshot
+     * copy); safe to call from a scrape thread while requests are in flight.
+     * Endpoints that have not been called yet are omitted.
+     */
+    std::string metricsText() const;
+
+    /** Append metricsText() to out, reusing its capacity across scrapes. */
+    void appendMetricsText(std::string& out) const;
+
     // =========================================================================
     // Customer Management
     // =========================================================================
@@ -65,26 +91,134 @@ public:
      *
      * @throws DripError on failure.
      */
-    CustomerResult createCustomer(const CreateCustomerParams& params);
+    CustomerResult createCustomer(const CreateCustomerParams& params,
+                                  const RequestOptions& options = RequestOptions());
 
     /**
-     * Get an existing customer by ID.
+     * createCustomer() for each of @p params, with up to concurrency
+     * requests in flight over pooled connections. Failures are reported
+     * per item instead of thrown. An external_customer_id that already
+     * exists counts as success: the item holds the existing customer
+     * (looked up with a listCustomers() filter on that id) with existed
+     * set.
+     *
+     * RequestOptions apply to each request (info is not filled).
+     */
+    CreateCustomersResult createCustomers(const std::vector<CreateCustomerParams>& params,
+                                          const CreateCustomersOptions& options = CreateCustomersOptions(),
+                                          const RequestOptions& request_options = RequestOptions());
+
+    /**
+     * Get an existing customer by ID. Served from memory when
+     * Config::customer_cache is enabled and the entry is fresh.
      *
      * @throws NotFoundError if customer doesn't exist.
      */
-    CustomerResult getCustomer(const std::string& customer_id);
+    CustomerResult getCustomer(const std::string& customer_id,
+                               const RequestOptions& options = RequestOptions());
+
+    /**
+     * getCustomer() for many ids, with up to concurrency requests in
+     * flight. Repeated ids are fetched once and cached customers are
+     * served without a request. Failures (e.g. NOT_FOUND) are reported
+     * per id instead of thrown.
+     *
+     * @return One lookup per input id, in input order.
+     */
+    std::vector<CustomerLookup> getCustomers(const std::vector<std::string>& customer_ids,
+                                             const MultiGetOptions& options = MultiGetOptions(),
+                                             const RequestOptions& request_options = RequestOptions());
+
+    /**
+     * Drop customer_id from the customer cache (including a cached "not
+     * found"), e.g. after changing it elsewhere. No-op without the cache.
+     */
+    void invalidateCustomer(const std::string& customer_id);
+
+    /**
+     * List one page of customers with optional filters. Use
+     * CustomerIterator to walk all of them.
+     */
+    ListCustomersResult listCustomers(const ListCustomersOptions& options = ListCustomersOptions(),
+                                      const RequestOptions& request_options = RequestOptions());
+
+    /**
+     * Map your external_customer_id to the Drip customer id.
+     *
+     * Answered from an in-memory index that customers returned by
+     * createCustomer(), getCustomer() and listCustomers() are added to
+     * once this (or warmCustomerIndex()) has been called. On a miss the
+     * index pages in customers created since its last refresh, then
+     * looks again. If the list total does not match what the index has
+     * read, or the new customers do not include this one, the whole list
+     * is read again before NotFoundError is thrown.
+     *
+     * @throws NotFoundError if no customer has that external id.
+     */
+    std::string resolveCustomer(const std::string& external_customer_id,
+                                const RequestOptions& options = RequestOptions());
+
+    /**
+     * Load every customer into the resolveCustomer() index up front
+     * (100 per request). Later calls only read customers created since.
+     *
+     * @return Number of external ids indexed.
+     */
+    size_t warmCustomerIndex(const RequestOptions& options = RequestOptions());
+
+    /**
+     * Rewrite the Config::id_cache file now, as its refresh thread does:
+     * every workflow slug, plus the customers created since the file was
+     * last written. No-op without Config::id_cache.path.
+     *
+     * @throws DripError on a failed request, or with code IO_ERROR if the
+     *         file cannot be written (the previous file stays in place).
+     */
+    void refreshIdCache(const RequestOptions& options = RequestOptions());
+
+    /**
+     * Stream every customer (or, per status pass, every customer with
+     * that status) to @p sink. Pages are fetched concurrently over pooled
+     * connections, up to 2 * concurrency pages ahead of the sink, so
+     * memory stays bounded however many customers there are.
+     *
+     * RequestOptions apply to each page request (info is not filled).
+     *
+     * @throws DripError if a page request failed; pages already delivered
+     *         stay delivered.
+     */
+    ExportCustomersResult exportCustomers(CustomerSink& sink,
+                                          const ExportCustomersOptions& options = ExportCustomersOptions(),
+                                          const RequestOptions& request_options = RequestOptions());
 
     /**
-     * List customers with optional filters.
+     * exportCustomers() to a newline-delimited JSON file, one customer
+     * object per line with the API's field names. The file is truncated
+     * first.
+     *
+     * @throws DripError with code IO_ERROR if the file cannot be written.
      */
-    ListCustomersResult listCustomers(const ListCustomersOptions& options = ListCustomersOptions());
+    ExportCustomersResult exportCustomersToFile(const std::string& ndjson_path,
+                                                const ExportCustomersOptions& options = ExportCustomersOptions(),
+                                                const RequestOptions& request_options = RequestOptions());
 
     /**
      * Get a customer's USDC balance.
      *
      * @throws NotFoundError if customer doesn't exist.
      */
-    BalanceResult getBalance(const std::string& customer_id);
+    BalanceResult getBalance(const std::string& customer_id,
+                             const RequestOptions& options = RequestOptions());
+
+    /**
+     * getBalance() for many customers, like getCustomers(). Estimates
+     * from Config::balance_cache are used where it is enabled.
+     *
+     * @return One lookup per input id, in input order.
+     */
+    std::vector<BalanceLookup> getBalances(const std::vector<std::string>& customer_ids,
+                                           const MultiGetOptions& options = MultiGetOptions(),
+                                           const RequestOptions& request_options = RequestOptions());
 
     // =========================================================================
     // Health Check
@@ -96,7 +230,14 @@ public:
      * @throws NetworkError on connection failure.
      * @throws TimeoutError if the request exceeds timeout_ms.
      */
-    PingResult ping();
+    PingResult ping(const RequestOptions& options = RequestOptions());
+
+    /**
+     * Latest background health check, without a round trip. Needs
+     * Config::probe_interval_ms; otherwise checks stays 0. Never blocks on
+     * the network; safe to call from any thread.
+     */
+    HealthSnapshot health() const;
 
     // =========================================================================
     // Usage Tracking (No Billing)
@@ -107,8 +248,12 @@ public:
      *
      * Use this for pilot programs, internal tracking, or pre-billing.
      * For actual billing, use charge() from the full SDK.
+     *
+     * With options.ack_only (or Config::ack_only) the response body is not
+     * parsed; the result echoes params with success = true.
      */
-    TrackUsageResult trackUsage(const TrackUsageParams& params);
+    TrackUsageResult trackUsage(const TrackUsageParams& params,
+                                const RequestOptions& options = RequestOptions());
 
     // =========================================================================
     // Run & Event Methods (Execution Ledger)
@@ -118,17 +263,22 @@ public:
      * Start a new run for tracking execution.
      * Use emitEvent() to add events, then endRun() to complete.
      */
-    RunResult startRun(const StartRunParams& params);
+    RunResult startRun(const StartRunParams& params,
+                       const RequestOptions& options = RequestOptions());
 
     /**
      * End a run with a final status.
      */
-    EndRunResult endRun(const std::string& run_id, const EndRunParams& params);
+    EndRunResult endRun(const std::string& run_id, const EndRunParams& params,
+                        const RequestOptions& options = RequestOptions());
 
     /**
      * Emit an event to a running run.
+     *
+     * Supports ack-only mode like trackUsage(); the result id is then empty.
      */
-    EventResult emitEvent(const EmitEventParams& params);
+    EventResult emitEvent(const EmitEventParams& params,
+                          const RequestOptions& options = RequestOptions());
 
     /**
      * Record a complete run in a single call.
@@ -153,13 +303,66 @@ public:
      *
      *   RecordRunResult result = client.recordRun(params);
      */
-    RecordRunResult recordRun(const RecordRunParams& params);
+    RecordRunResult recordRun(const RecordRunParams& params,
+                              const RequestOptions& options = RequestOptions());
 
 private:
     /* C++03: non-copyable via private declarations (no = delete) */
     Client(const Client&);
     Client& operator=(const Client&);
 
+    friend class CustomerIterator;
+
+    struct Impl;
+    Impl* impl_;  /* C++03: raw pointer instead of unique_ptr */
+};
+
+/**
+ * Walks every customer matching a filter, fetching listCustomers() pages
+ * lazily. With prefetch_pages > 0 a background thread fetches the next
+ * pages while the caller works through the current one; memory stays
+ * bounded by prefetch_pages + 1 pages.
+ *
+ * Pages are read by offset in creation order, so customers created
+ * during the walk are included. Not thread-safe; the Client must outlive
+ * the iterator. RequestOptions apply to each page request (info is only
+ * filled for pages fetched on the calling thread).
+ *
+ * Example:
+ *   drip::CustomerIterator it(client);
+ *   drip::CustomerResult customer;
+ *   while (it.next(customer)) {
+ *       sync(customer);
+ *   }
+ */
+class CustomerIterator {
+public:
+    explicit CustomerIterator(Client& client,
+                              const CustomerIteratorOptions& options = CustomerIteratorOptions(),
+                              const RequestOptions& request_options = RequestOptions());
+
+    /** Stops the prefetch thread, aborting a page request in flight. */
+    ~CustomerIterator();
+
+    /**
+     * Fill @p out with the next customer. Returns false after the last.
+     *
+     * @throws DripError if a page request failed; the iterator is then
+     *         exhausted.
+     */
+    bool next(CustomerResult& out);
+
+    /** Matching customers as reported by the last page (0 before the first). */
+    int total() const;
+
+    /** Page requests completed so far. */
+    int pagesFetched() const;
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    CustomerIterator(const CustomerIterator&);
+    CustomerIterator& operator=(const CustomerIterator&);
+
     struct Impl;
     Impl* impl_;  /* C++03: raw pointer instead of unique_ptr */
 };
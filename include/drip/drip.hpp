@@ -53,6 +53,10 @@
 
 #include "types.hpp"
 #include "errors.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
+#include "cancellation.hpp"
+#include "transport.hpp"
 #include "client.hpp"
 
 /**
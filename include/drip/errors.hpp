@@ -81,6 +81,28 @@ public:
     {}
 };
 
+/**
+ * Thrown when RequestOptions::cancellation is cancelled before or during
+ * the call.
+ */
+class CancelledError : public DripError {
+public:
+    explicit CancelledError(const std::string& message = "Request cancelled")
+        : DripError(message, 0, "CANCELLED")
+    {}
+};
+
+/**
+ * Thrown without sending a request while the endpoint's circuit breaker
+ * is open (see CircuitBreakerConfig).
+ */
+class CircuitOpenError : public DripError {
+public:
+    explicit CircuitOpenError(const std::string& message = "Circuit breaker open")
+        : DripError(message, 503, "CIRCUIT_OPEN")
+    {}
+};
+
 } // namespace drip
 
 #endif // DRIP_ERRORS_HPP
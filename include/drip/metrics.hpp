@@ -0,0 +1,300 @@
+#ifndef DRIP_METRICS_HPP
+#define DRIP_METRICS_HPP
+
+#include <vector>
+#include <cstddef>
+
+/* C++03: use <stdint.h> instead of <cstdint> */
+#include <stdint.h>
+
+namespace drip {
+
+// =============================================================================
+// Endpoints
+// =============================================================================
+
+/**
+ * API endpoint families that metrics are broken down by.
+ * Sub-paths fold into their family (/runs/{id} counts as ENDPOINT_RUNS,
+ * /customers/{id}/balance as ENDPOINT_CUSTOMERS).
+ */
+enum Endpoint {
+    ENDPOINT_USAGE,             // /usage/internal
+    ENDPOINT_RUNS,              // /runs
+    ENDPOINT_RUN_EVENTS,        // /run-events
+    ENDPOINT_RUN_EVENTS_BATCH,  // /run-events/batch
+    ENDPOINT_WORKFLOWS,         // /workflows
+    ENDPOINT_CUSTOMERS,         // /customers
+    ENDPOINT_HEALTH,            // /health
+    ENDPOINT_OTHER,
+    ENDPOINT_COUNT
+};
+
+inline const char* endpoint_to_string(Endpoint e) {
+    switch (e) {
+        case ENDPOINT_USAGE:            return "/usage/internal";
+        case ENDPOINT_RUNS:             return "/runs";
+        case ENDPOINT_RUN_EVENTS:       return "/run-events";
+        case ENDPOINT_RUN_EVENTS_BATCH: return "/run-events/batch";
+        case ENDPOINT_WORKFLOWS:        return "/workflows";
+        case ENDPOINT_CUSTOMERS:        return "/customers";
+        case ENDPOINT_HEALTH:           return "/health";
+        default:                        return "other";
+    }
+}
+
+// =============================================================================
+// Error kinds
+// =============================================================================
+
+/**
+ * Failure classes counted per endpoint. Mirrors the exception hierarchy
+ * in errors.hpp, with other 4xx/5xx statuses split out.
+ */
+enum ErrorKind {
+    ERROR_NETWORK,       // NetworkError
+    ERROR_TIMEOUT,       // TimeoutError
+    ERROR_AUTH,          // AuthenticationError (401)
+    ERROR_NOT_FOUND,     // NotFoundError (404)
+    ERROR_RATE_LIMITED,  // RateLimitError (429)
+    ERROR_CLIENT,        // any other 4xx
+    ERROR_SERVER,        // 5xx
+    ERROR_PARSE,         // malformed response body
+    ERROR_CANCELLED,     // CancelledError (transfer aborted)
+    ERROR_KIND_COUNT
+};
+
+inline const char* error_kind_to_string(ErrorKind k) {
+    switch (k) {
+        case ERROR_NETWORK:      return "network";
+        case ERROR_TIMEOUT:      return "timeout";
+        case ERROR_AUTH:         return "auth";
+        case ERROR_NOT_FOUND:    return "not_found";
+        case ERROR_RATE_LIMITED: return "rate_limited";
+        case ERROR_CLIENT:       return "client";
+        case ERROR_SERVER:       return "server";
+        case ERROR_PARSE:        return "parse";
+        case ERROR_CANCELLED:    return "cancelled";
+        default:                 return "unknown";
+    }
+}
+
+// =============================================================================
+// Transfer phases
+// =============================================================================
+
+/**
+ * Where the time of an HTTP request went, derived from curl's cumulative
+ * timers (see RequestInfo).
+ */
+enum TransferPhase {
+    PHASE_DNS,       // Name resolution
+    PHASE_CONNECT,   // TCP connect
+    PHASE_TLS,       // TLS handshake
+    PHASE_SERVER,    // Request sent until first response byte
+    PHASE_DOWNLOAD,  // First until last response byte
+    TRANSFER_PHASE_COUNT
+};
+
+inline const char* transfer_phase_to_string(TransferPhase p) {
+    switch (p) {
+        case PHASE_DNS:      return "dns";
+        case PHASE_CONNECT:  return "connect";
+        case PHASE_TLS:      return "tls";
+        case PHASE_SERVER:   return "server";
+        case PHASE_DOWNLOAD: return "download";
+        default:             return "unknown";
+    }
+}
+
+// =============================================================================
+// Circuit breaker
+// =============================================================================
+
+/** Per-endpoint circuit breaker state (see CircuitBreakerConfig). */
+enum CircuitState {
+    CIRCUIT_CLOSED,      // Requests flow; outcomes are tracked
+    CIRCUIT_OPEN,        // Requests fail fast with CircuitOpenError
+    CIRCUIT_HALF_OPEN    // A few probe requests decide whether to close
+};
+
+inline const char* circuit_state_to_string(CircuitState s) {
+    switch (s) {
+        case CIRCUIT_CLOSED:    return "closed";
+        case CIRCUIT_OPEN:      return "open";
+        case CIRCUIT_HALF_OPEN: return "half_open";
+        default:                return "unknown";
+    }
+}
+
+// =============================================================================
+// Caches
+// =============================================================================
+
+/** In-process caches that report hit rates. */
+enum CacheKind {
+    CACHE_CUSTOMER,         // Config::customer_cache
+    CACHE_CUSTOMER_INDEX,   // Client::resolveCustomer()
+    CACHE_BALANCE,          // Config::balance_cache
+    CACHE_CONDITIONAL,      // Config::conditional_gets (hits are 304s)
+    CACHE_ID_CACHE,         // Config::id_cache (workflow and customer lookups)
+    CACHE_KIND_COUNT
+};
+
+inline const char* cache_kind_to_string(CacheKind k) {
+    switch (k) {
+        case CACHE_CUSTOMER:       return "customer";
+        case CACHE_CUSTOMER_INDEX: return "customer_index";
+        case CACHE_BALANCE:        return "balance";
+        case CACHE_CONDITIONAL:    return "conditional";
+        case CACHE_ID_CACHE:       return "id_cache";
+        default:                   return "unknown";
+    }
+}
+
+/** Lookup counters for one cache; all zero while it is disabled. */
+struct CacheMetrics {
+    uint64_t hits;            // Answered from the cache, negative hits included
+    uint64_t negative_hits;   // Answered with a cached "not found"
+    uint64_t misses;          // Absent or expired; went to the API
+    uint64_t evictions;       // Dropped to stay within capacity
+    uint64_t entries;         // Current size
+
+    CacheMetrics()
+        : hits(0)
+        , negative_hits(0)
+        , misses(0)
+        , evictions(0)
+        , entries(0)
+    {}
+
+    /** hits / (hits + misses), 0 before the first lookup. */
+    double hitRate() const {
+        uint64_t lookups = hits + misses;
+        return lookups > 0 ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0;
+    }
+};
+
+// =============================================================================
+// Histogram snapshot
+// =============================================================================
+
+/**
+ * Point-in-time copy of a log-linear (HDR-style) histogram of durations
+ * in nanoseconds.
+ *
+ * Each power of two is split into 16 linear sub-buckets, so any recorded
+ * value is reported within ~6% of its true value. counts[i] holds the
+ * number of samples in [bucketLowerBound(i), bucketUpperBound(i)).
+ */
+struct HistogramSnapshot {
+    std::vector<uint64_t> counts;
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+
+    HistogramSnapshot()
+        : count(0)
+        , sum_ns(0)
+        , min_ns(0)
+        , max_ns(0)
+    {}
+
+    /** Value at the given percentile (0-100), e.g. percentile(99.9). */
+    uint64_t percentile(double p) const;
+
+    /** Arithmetic mean, 0 when empty. */
+    double mean() const;
+
+    /** Number of buckets in every histogram. */
+    static size_t bucketCount();
+
+    /** Inclusive lower bound of bucket i, in nanoseconds. */
+    static uint64_t bucketLowerBound(size_t i);
+
+    /** Exclusive upper bound of bucket i, in nanoseconds. */
+    static uint64_t bucketUpperBound(size_t i);
+};
+
+// =============================================================================
+// Metrics snapshot
+// =============================================================================
+
+/**
+ * Counters for one endpoint family. Every HTTP request is counted,
+ * including failed ones; latency covers the transfer only.
+ */
+struct EndpointMetrics {
+    uint64_t requests;
+    uint64_t errors[ERROR_KIND_COUNT];
+    uint64_t retries;          // Requests re-sent after a retryable failure
+    uint64_t failovers;        // Requests re-sent to another base URL
+    uint64_t bytes_sent;       // Request headers + body
+    uint64_t bytes_received;   // Response headers + body
+    uint64_t serialize_ns;     // Total time spent serializing request bodies
+    uint64_t parse_ns;         // Total time spent parsing response bodies
+    uint64_t phase_ns[TRANSFER_PHASE_COUNT];  // Total time per transfer phase
+    uint64_t connections_reused;
+    uint64_t connections_opened;
+    CircuitState circuit_state;
+    uint64_t circuit_opens;        // Transitions to CIRCUIT_OPEN
+    uint64_t circuit_rejections;   // Calls failed fast while open
+    uint64_t hedges;               // Hedge requests sent (see HedgeConfig)
+    uint64_t hedge_wins;           // Hedges that answered before the original
+    uint64_t coalesced;            // GETs answered by another call's identical request
+    HistogramSnapshot latency;
+
+    EndpointMetrics()
+        : requests(0)
+        , retries(0)
+        , failovers(0)
+        , bytes_sent(0)
+        , bytes_received(0)
+        , serialize_ns(0)
+        , parse_ns(0)
+        , connections_reused(0)
+        , connections_opened(0)
+        , circuit_state(CIRCUIT_CLOSED)
+        , circuit_opens(0)
+        , circuit_rejections(0)
+        , hedges(0)
+        , hedge_wins(0)
+        , coalesced(0)
+    {
+        for (int i = 0; i < ERROR_KIND_COUNT; ++i) errors[i] = 0;
+        for (int i = 0; i < TRANSFER_PHASE_COUNT; ++i) phase_ns[i] = 0;
+    }
+
+    /** Sum of errors across all kinds. */
+    uint64_t totalErrors() const {
+        uint64_t n = 0;
+        for (int i = 0; i < ERROR_KIND_COUNT; ++i) n += errors[i];
+        return n;
+    }
+};
+
+/**
+ * Everything the client has recorded since construction.
+ *
+ * Counters are read individually without locking, so a snapshot taken
+ * while requests are in flight may be off by the in-flight requests.
+ */
+struct MetricsSnapshot {
+    EndpointMetrics endpoints[ENDPOINT_COUNT];
+    HistogramSnapshot serialize;   // Per-request body serialization time
+    HistogramSnapshot parse;       // Per-request response parse time
+    CacheMetrics caches[CACHE_KIND_COUNT];
+
+    const EndpointMetrics& endpoint(Endpoint e) const {
+        return endpoints[e];
+    }
+
+    const CacheMetrics& cache(CacheKind k) const {
+        return caches[k];
+    }
+};
+
+} // namespace drip
+
+#endif // DRIP_METRICS_HPP
@@ -0,0 +1,102 @@
+#ifndef DRIP_TRACING_HPP
+#define DRIP_TRACING_HPP
+
+#include "types.hpp"
+#include "metrics.hpp"
+
+#include <string>
+
+namespace drip {
+
+// =============================================================================
+// Spans
+// =============================================================================
+
+/**
+ * One logical SDK operation: a public Client method, or a sub-step of
+ * recordRun() ("recordRun.resolveWorkflow", "recordRun.startRun",
+ * "recordRun.emitEvents", "recordRun.endRun").
+ *
+ * trace_id is inherited from the parent (or RequestOptions::trace_id)
+ * before onOperationStart() runs; a hook may overwrite it there. If it is
+ * still empty for a top-level operation, the SDK generates one. It is
+ * sent on every HTTP attempt of the operation in Config::trace_header.
+ */
+struct OperationSpan {
+    const char* name;
+    const OperationSpan* parent;   // Enclosing operation, NULL at top level
+    std::string trace_id;
+    void* user_data;               // Free for the hook, e.g. its own span handle
+
+    /* Set before onOperationEnd() */
+    int64_t duration_ns;
+    bool ok;
+    std::string error;             // Message of the failure that ended it
+
+    OperationSpan()
+        : name("")
+        , parent(NULL)
+        , user_data(NULL)
+        , duration_ns(0)
+        , ok(false)
+    {}
+};
+
+/**
+ * One HTTP request made on behalf of an operation. Retried requests get
+ * one span per attempt.
+ */
+struct AttemptSpan {
+    const OperationSpan* operation;
+    Endpoint endpoint;
+    const char* method;
+    std::string path;
+    int attempt;                   // 1-based
+    void* user_data;
+
+    /* Set before onAttemptEnd() */
+    int http_status;               // 0 if no response was received
+    int64_t duration_ns;
+    RequestInfo timing;            // Bytes and curl phase timers
+    bool ok;
+    std::string error;
+
+    AttemptSpan()
+        : operation(NULL)
+        , endpoint(ENDPOINT_OTHER)
+        , method("")
+        , attempt(1)
+        , user_data(NULL)
+        , http_status(0)
+        , duration_ns(0)
+        , ok(false)
+    {}
+};
+
+// =============================================================================
+// Hook interface
+// =============================================================================
+
+/**
+ * Receives span start/end callbacks. Install via Config::trace_hooks.
+ *
+ * Callbacks run synchronously on the thread making the request, so keep
+ * them cheap: the calling thread, or a worker thread for the items of
+ * bulk calls such as createCustomers(), which report as children of the
+ * bulk call's span. They may be invoked concurrently. They must not
+ * throw. Every start is paired with exactly one
+ * end on the same span object.
+ */
+class TraceHooks {
+public:
+    virtual ~TraceHooks() {}
+
+    virtual void onOperationStart(OperationSpan& /*span*/) {}
+    virtual void onOperationEnd(OperationSpan& /*span*/) {}
+    virtual void onAttemptStart(AttemptSpan& /*span*/) {}
+    virtual void onAttemptEnd(AttemptSpan& /*span*/) {}
+};
+
+} // namespace drip
+
+#endif // DRIP_TRACING_HPP
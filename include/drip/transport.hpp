@@ -0,0 +1,100 @@
+#ifndef DRIP_TRANSPORT_HPP
+#define DRIP_TRANSPORT_HPP
+
+#include "types.hpp"
+#include "cancellation.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+
+namespace drip {
+
+// =============================================================================
+// HTTP exchange
+// =============================================================================
+
+/** One HTTP request as handed to a Transport. */
+struct HttpRequest {
+    std::string method;                 // GET, POST or PATCH
+    std::string url;                    // Absolute, including query string
+    std::vector<std::string> headers;   // "Name: value" lines
+    std::string body;                   // Serialized JSON; empty for GET
+    int timeout_ms;                     // Whole-exchange limit
+    int connect_timeout_ms;             // Connection setup limit; 0 = none
+    bool discard_success_body;          // Ack-only: 2xx bodies may be dropped
+    const CancellationToken* cancellation;  // Abort promptly once cancelled; may be NULL
+
+    HttpRequest()
+        : timeout_ms(30000)
+        , connect_timeout_ms(0)
+        , discard_success_body(false)
+        , cancellation(NULL)
+    {}
+};
+
+/** Outcome of the transfer itself, independent of the HTTP status. */
+enum TransportStatus {
+    TRANSPORT_OK,               // A response was received (any HTTP status)
+    TRANSPORT_TIMEOUT,          // timeout_ms elapsed first
+    TRANSPORT_NETWORK_ERROR,    // DNS, connect, reset, TLS, ...
+    TRANSPORT_CANCELLED         // HttpRequest::cancellation fired
+};
+
+struct HttpResponse {
+    TransportStatus status;
+    std::string error;          // Description when status != TRANSPORT_OK
+    int http_status;            // 0 when no response was received
+    std::map<std::string, std::string> headers;  // Lower-cased names
+    std::string body;
+    RequestInfo info;           // Timers and byte counts, where the transport has them
+
+    HttpResponse()
+        : status(TRANSPORT_OK)
+        , http_status(0)
+    {}
+};
+
+// =============================================================================
+// Transport interface
+// =============================================================================
+
+/**
+ * Moves an HttpRequest over the wire. Install via Config::transport to
+ * add fault injection, recording, or an alternative HTTP stack.
+ *
+ * perform() is called concurrently when the Client is shared between
+ * threads. It reports transfer failures through HttpResponse::status
+ * rather than by throwing; the Client maps them to NetworkError,
+ * TimeoutError and CancelledError and applies its retry policy.
+ */
+class Transport {
+public:
+    virtual ~Transport() {}
+
+    virtual void perform(const HttpRequest& request, HttpResponse& response) = 0;
+};
+
+/**
+ * The default libcurl transport. Pools easy handles so connections are
+ * kept alive and reused across calls and threads.
+ */
+class CurlTransport : public Transport {
+public:
+    CurlTransport();
+    ~CurlTransport();
+
+    void perform(const HttpRequest& request, HttpResponse& response);
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    CurlTransport(const CurlTransport&);
+    CurlTransport& operator=(const CurlTransport&);
+
+    struct Impl;
+    Impl* impl_;
+};
+
+} // namespace drip
+
+#endif // DRIP_TRANSPORT_HPP
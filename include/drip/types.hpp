@@ -4,16 +4,171 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <cstddef>
 
 /* C++03: use <stdint.h> instead of <cstdint> */
 #include <stdint.h>
 
 namespace drip {
 
+class TraceHooks;
+class Transport;
+class CancellationToken;
+
 // =============================================================================
 // Configuration
 // =============================================================================
 
+/**
+ * Per-endpoint circuit breaker. While closed, the outcomes of the last
+ * `window` requests to an endpoint are tracked; once the window is full
+ * and the share of failures (network errors, timeouts, 5xx) reaches
+ * failure_rate, or the share of requests slower than slow_call_ms reaches
+ * slow_call_rate, the breaker opens. Calls to that endpoint then throw
+ * CircuitOpenError immediately for open_ms, after which half_open_probes
+ * requests are let through: if all succeed the breaker closes, and any
+ * failure reopens it.
+ */
+struct CircuitBreakerConfig {
+    bool enabled;            // Default: false
+    int window;              // Default: 20
+    double failure_rate;     // Default: 0.5
+    int slow_call_ms;        // Default: 0 (latency not considered)
+    double slow_call_rate;   // Default: 0.5
+    int open_ms;             // Default: 5000
+    int half_open_probes;    // Default: 1
+
+    CircuitBreakerConfig()
+        : enabled(false)
+        , window(20)
+        , failure_rate(0.5)
+        , slow_call_ms(0)
+        , slow_call_rate(0.5)
+        , open_ms(5000)
+        , half_open_probes(1)
+    {}
+};
+
+/**
+ * Hedged reads for getCustomer(), getBalance() and ping(). When a request
+ * has not answered after delay_ms, an identical second request is sent;
+ * the first usable answer (not a network error or 5xx) is used and the
+ * other request is cancelled. An error is returned only if both fail.
+ * With delay_ms 0 the delay tracks the endpoint's live latency at
+ * `percentile` (no hedging until min_samples requests have been measured).
+ *
+ * Hedges are capped at budget_percent of hedgeable requests, so a slow
+ * backend sees at most that much extra load. The original request runs
+ * on the calling thread; only a hedge that is sent gets its own thread.
+ */
+struct HedgeConfig {
+    bool enabled;            // Default: false
+    int delay_ms;            // Default: 0 (use the live percentile)
+    double percentile;       // Default: 95
+    int min_samples;         // Default: 20
+    double budget_percent;   // Default: 5
+
+    HedgeConfig()
+        : enabled(false)
+        , delay_ms(0)
+        , percentile(95.0)
+        , min_samples(20)
+        , budget_percent(5.0)
+    {}
+};
+
+/**
+ * In-process cache of getCustomer() results, keyed by customer id. Hits
+ * are answered without a request for ttl_ms after the customer was last
+ * fetched, so status changes made elsewhere show up within ttl_ms.
+ * NotFoundError is remembered for negative_ttl_ms (0: not cached). At
+ * most `capacity` customers are kept; the least recently used is evicted
+ * first. createCustomer() and listCustomers() refresh entries too.
+ */
+struct CustomerCacheConfig {
+    bool enabled;            // Default: false
+    int capacity;            // Default: 10000
+    int ttl_ms;              // Default: 30000
+    int negative_ttl_ms;     // Default: 5000
+
+    CustomerCacheConfig()
+        : enabled(false)
+        , capacity(10000)
+        , ttl_ms(30000)
+        , negative_ttl_ms(5000)
+    {}
+};
+
+/**
+ * In-process balance estimates for getBalance(). A fetched balance is
+ * reused for up to max_staleness_ms (timed from when the fetch was sent),
+ * minus the usage this client has tracked for the customer since, priced
+ * per meter with unit_price_usdc. getBalance() fetches again once the
+ * entry is older than that, once the estimate is at or below
+ * refresh_below_usdc, or after usage that cannot be priced (unpriced
+ * meter, negative or non-finite quantity). Usage that other clients
+ * report only shows up on a fetch, so max_staleness_ms bounds how far off
+ * an estimate can be. At most `capacity` customers are tracked; the least
+ * recently fetched is dropped first.
+ */
+struct BalanceCacheConfig {
+    bool enabled;                                  // Default: false
+    int capacity;                                  // Default: 10000
+    int max_staleness_ms;                          // Default: 5000
+    double refresh_below_usdc;                     // Default: 0
+    std::map<std::string, double> unit_price_usdc; // Meter -> USDC per unit
+
+    BalanceCacheConfig()
+        : enabled(false)
+        , capacity(10000)
+        , max_staleness_ms(5000)
+        , refresh_below_usdc(0)
+    {}
+};
+
+/**
+ * Conditional GETs for getCustomer() and the workflow list recordRun()
+ * reads. The ETag / Last-Modified of the last full response is sent back
+ * as If-None-Match / If-Modified-Since, and a 304 Not Modified reuses the
+ * parsed body kept in memory, so nothing is transferred or parsed. Up to
+ * `capacity` responses are kept; the least recently used is dropped
+ * first. Servers that send neither header are unaffected.
+ */
+struct ConditionalGetConfig {
+    bool enabled;            // Default: false
+    int capacity;            // Default: 1024
+
+    ConditionalGetConfig()
+        : enabled(false)
+        , capacity(1024)
+    {}
+};
+
+/**
+ * Persistent cache of workflow slug -> workflow id and
+ * external_customer_id -> customer id mappings, shared by the processes
+ * on a host. The file at `path` is memory-mapped read-only when the
+ * client is constructed and looked up in place, without parsing, so a
+ * fresh process resolves recordRun() workflow slugs and resolveCustomer()
+ * ids without a request. A client is a reader unless refresh_interval_ms
+ * is set: it then rewrites the file on a background thread (at once, then
+ * every refresh_interval_ms) from GET /workflows and the customers created
+ * since the last write, renaming the new file over the old. Readers
+ * notice a replaced file within reload_check_ms. Run one refreshing client
+ * per host. Mappings of deleted workflows or customers are served until
+ * the next write.
+ */
+struct IdCacheConfig {
+    std::string path;          // Default: empty (disabled)
+    int refresh_interval_ms;   // Default: 0 (read only)
+    int reload_check_ms;       // Default: 5000 (0 = never remap)
+
+    IdCacheConfig()
+        : refresh_interval_ms(0)
+        , reload_check_ms(5000)
+    {}
+};
+
 /**
  * Configuration for the Drip SDK client.
  *
@@ -21,17 +176,170 @@ namespace drip {
  *             Falls back to DRIP_API_KEY environment variable.
  * base_url:   API base URL. Defaults to production.
  *             Falls back to DRIP_BASE_URL environment variable.
- * timeout_ms: Request timeout in milliseconds. Default: 30000.
+ * base_urls:  Several equivalent API base URLs (e.g. regional endpoints or
+ *             a local relay), up to 64; replaces base_url when non-empty.
+ *             Each request goes to the one with the best recent latency
+ *             and error record, and an idempotent request that fails with
+ *             a transport error or 5xx is re-sent at once to the next best
+ *             (not counted against max_retries). Default: empty.
+ * probe_interval_ms: Probe each base URL's /health this often on a
+ *             background thread. Feeds Client::health(), and with several
+ *             base_urls keeps idle endpoints measured so recovered ones
+ *             come back. 0 (the default) disables the monitor.
+ * timeout_ms: Limit on each HTTP request, connect to last byte, in
+ *             milliseconds. Default: 30000. See RequestOptions::timeout_ms
+ *             for a budget covering a whole call.
+ * connect_timeout_ms: Limit on establishing a connection (DNS, TCP, TLS),
+ *             so an unreachable host fails fast. Default: 10000.
+ * coalesce_gets: Concurrent identical GETs (same path) share one request:
+ *             calls that arrive while it is in flight wait for it and get
+ *             a copy of its result or exception. Only the call that sent
+ *             it sees RequestInfo and attempt spans. Default: true.
+ * ack_only:   When true, trackUsage() and emitEvent() only check the HTTP
+ *             status and discard the response body unparsed. The body is
+ *             still parsed on error to build the exception message.
+ *             Default: false.
+ * trace_hooks:  Optional span callbacks around every operation and HTTP
+ *             attempt (see tracing.hpp). Not owned; must outlive the
+ *             client. NULL (the default) disables tracing entirely.
+ * trace_header: Header carrying the trace/request id. Default: X-Request-Id.
+ * transport:  Optional HTTP transport (see transport.hpp). Not owned; must
+ *             outlive the client. NULL (the default) uses libcurl.
+ * max_retries: Extra attempts after a retryable failure: network errors,
+ *             timeouts, 429 and 5xx. Only requests that are safe to repeat
+ *             are retried (GETs, PATCH, and POSTs that carry an idempotency
+ *             key); other POSTs are retried on 429 only. Default: 0.
+ * retry_backoff_ms: Base delay for exponential backoff with full jitter.
+ *             A Retry-After header on 429/503 replaces it. Default: 100.
+ * retry_max_backoff_ms: Cap on any single retry delay. Default: 5000.
+ * circuit_breaker: Fail fast per endpoint during outages. Off by default.
+ * hedge:      Hedged requests for latency-sensitive reads. Off by default.
+ * customer_cache: Cache getCustomer() results in memory. Off by default.
+ * balance_cache: Estimate getBalance() locally between fetches. Off by default.
+ * conditional_gets: Revalidate customer and workflow reads with ETags. On
+ *             by default.
+ * id_cache:   Share workflow and customer id mappings through a file. Off
+ *             by default.
  */
 struct Config {
     std::string api_key;
     std::string base_url;
+    std::vector<std::string> base_urls;
+    int probe_interval_ms;
     int timeout_ms;
+    int connect_timeout_ms;
+    bool coalesce_gets;
+    bool ack_only;
+    TraceHooks* trace_hooks;
+    std::string trace_header;
+    Transport* transport;
+    int max_retries;
+    int retry_backoff_ms;
+    int retry_max_backoff_ms;
+    CircuitBreakerConfig circuit_breaker;
+    HedgeConfig hedge;
+    CustomerCacheConfig customer_cache;
+    BalanceCacheConfig balance_cache;
+    ConditionalGetConfig conditional_gets;
+    IdCacheConfig id_cache;
 
     Config()
         : api_key("")
         , base_url("")
+        , probe_interval_ms(0)
         , timeout_ms(30000)
+        , connect_timeout_ms(10000)
+        , coalesce_gets(true)
+        , ack_only(false)
+        , trace_hooks(NULL)
+        , trace_header("X-Request-Id")
+        , transport(NULL)
+        , max_retries(0)
+        , retry_backoff_ms(100)
+        , retry_max_backoff_ms(5000)
+    {}
+};
+
+// =============================================================================
+// Per-call Options
+// =============================================================================
+
+/**
+ * Transfer details for one SDK call, filled in when RequestOptions::info
+ * is set.
+ *
+ * Phase times are microseconds from the start of the transfer, as curl
+ * reports them, so they are cumulative:
+ *   namelookup <= connect <= appconnect <= pretransfer <= starttransfer <= total
+ * appconnect is 0 for plain HTTP. On a reused connection the DNS and
+ * connect phases are (near) zero.
+ *
+ * Calls that make several HTTP requests (recordRun) sum the phase times
+ * and byte counts; connection_reused is then true only if every request
+ * reused a connection, and http_status is that of the last response.
+ */
+struct RequestInfo {
+    int requests;
+    int http_status;
+    int64_t namelookup_us;
+    int64_t connect_us;
+    int64_t appconnect_us;
+    int64_t pretransfer_us;
+    int64_t starttransfer_us;
+    int64_t total_us;
+    bool connection_reused;
+    int64_t bytes_sent;
+    int64_t bytes_received;
+
+    RequestInfo()
+        : requests(0)
+        , http_status(0)
+        , namelookup_us(0)
+        , connect_us(0)
+        , appconnect_us(0)
+        , pretransfer_us(0)
+        , starttransfer_us(0)
+        , total_us(0)
+        , connection_reused(false)
+        , bytes_sent(0)
+        , bytes_received(0)
+    {}
+};
+
+/**
+ * Options that apply to a single SDK call.
+ *
+ * ack_only: Fire-and-forget mode for this call (see Config::ack_only).
+ *           Results only echo the request parameters; server-assigned
+ *           fields such as usage_event_id are left empty.
+ * info:     Optional out-parameter receiving the transfer timing
+ *           breakdown. Reset at the start of the call and filled even
+ *           when the call throws. Not owned.
+ * trace_id: Request id sent in Config::trace_header on every HTTP request
+ *           of this call, e.g. to correlate with your own logs. Sent even
+ *           without trace hooks.
+ * timeout_ms: Deadline for the whole call in milliseconds, counted from
+ *           entry and shared by retries, backoff sleeps and every request
+ *           of multi-step calls such as recordRun(). Each request is
+ *           limited to the smaller of Config::timeout_ms and the time
+ *           left; once it runs out the call throws TimeoutError. 0 (the
+ *           default) means no deadline beyond Config::timeout_ms per
+ *           request.
+ * cancellation: Optional token; cancelling it aborts the call with
+ *           CancelledError (see cancellation.hpp). Not owned.
+ */
+struct RequestOptions {
+    bool ack_only;
+    RequestInfo* info;
+    std::string trace_id;
+    int timeout_ms;
+    const CancellationToken* cancellation;
+
+    RequestOptions()
+        : ack_only(false)
+        , info(NULL)
+        , timeout_ms(0)
+        , cancellation(NULL)
     {}
 };
 
@@ -83,9 +391,11 @@ struct CustomerResult {
 
 struct ListCustomersOptions {
     int limit;            // 1-100, default 100
+    int offset;           // Customers to skip (in creation order), default 0
     std::string status;   // Optional: ACTIVE, LOW_BALANCE, PAUSED
+    std::string external_customer_id;  // Optional: only the customer with this external id
 
-    ListCustomersOptions() : limit(100) {}
+    ListCustomersOptions() : limit(100), offset(0) {}
 };
 
 struct ListCustomersResult {
@@ -95,9 +405,164 @@ struct ListCustomersResult {
     ListCustomersResult() : total(0) {}
 };
 
+/**
+ * Options for CustomerIterator. At most prefetch_pages + 1 pages of
+ * page_size customers are held at once, whatever the total.
+ */
+struct CustomerIteratorOptions {
+    int page_size;        // 1-100, default 100
+    int prefetch_pages;   // Pages fetched ahead on a background thread, default 2 (0 = none)
+    int offset;           // Customers to skip first, default 0
+    std::string status;   // Optional: ACTIVE, LOW_BALANCE, PAUSED
+
+    CustomerIteratorOptions()
+        : page_size(100)
+        , prefetch_pages(2)
+        , offset(0)
+    {}
+};
+
+/**
+ * Options for Client::exportCustomers(). At most 2 * concurrency pages of
+ * page_size customers are held at once, whatever the total.
+ */
+struct ExportCustomersOptions {
+    int concurrency;      // Page requests in flight, 1-16, default 4
+    int page_size;        // 1-100, default 100
+    std::vector<std::string> statuses;   // One pass per status filter; empty = one unfiltered pass
+
+    ExportCustomersOptions()
+        : concurrency(4)
+        , page_size(100)
+    {}
+};
+
+struct ExportCustomersResult {
+    int64_t customers;    // Records handed to the sink
+    int pages;            // Page requests made
+    int64_t elapsed_ms;
+    double pages_per_second;
+    double customers_per_second;
+
+    ExportCustomersResult()
+        : customers(0)
+        , pages(0)
+        , elapsed_ms(0)
+        , pages_per_second(0)
+        , customers_per_second(0)
+    {}
+};
+
+/**
+ * Receives the records of Client::exportCustomers(), one at a time, on
+ * the calling thread and in creation order within each status pass.
+ * Throwing aborts the export and propagates out of exportCustomers().
+ */
+class CustomerSink {
+public:
+    virtual ~CustomerSink() {}
+
+    virtual void onCustomer(const CustomerResult& customer) = 0;
+};
+
+/** Outcome of one input of Client::createCustomers(). */
+struct CreateCustomerItem {
+    bool ok;
+    bool existed;              // external_customer_id was already taken; customer is that one
+    CustomerResult customer;   // ok only
+    std::string error;         // !ok: the failure's message
+    std::string error_code;    // !ok: DripError::code()
+    int status_code;           // !ok: HTTP status, 0 if none
+
+    CreateCustomerItem()
+        : ok(false)
+        , existed(false)
+        , status_code(0)
+    {}
+};
+
+/**
+ * Progress of Client::createCustomers(). Called on the thread that called
+ * createCustomers(), once per input in completion order. Throwing stops
+ * new requests and propagates out of createCustomers().
+ */
+class CreateCustomersProgress {
+public:
+    virtual ~CreateCustomersProgress() {}
+
+    /** @p index is the input's position; @p completed of @p total are done. */
+    virtual void onItem(size_t index, const CreateCustomerItem& item, size_t completed, size_t total) = 0;
+};
+
+struct CreateCustomersOptions {
+    int concurrency;                     // Requests in flight, 1-16, default 8
+    CreateCustomersProgress* progress;   // Optional, not owned
+
+    CreateCustomersOptions()
+        : concurrency(8)
+        , progress(NULL)
+    {}
+};
+
+struct CreateCustomersResult {
+    std::vector<CreateCustomerItem> items;   // Same order as the input
+    size_t created;
+    size_t existed;
+    size_t failed;
+
+    CreateCustomersResult()
+        : created(0)
+        , existed(0)
+        , failed(0)
+    {}
+};
+
 struct BalanceResult {
     std::string customer_id;
     std::string balance_usdc;
+    bool estimated;       // From Config::balance_cache, not fetched by this call
+    int64_t age_ms;       // Estimated only: time since the balance was fetched
+
+    BalanceResult()
+        : estimated(false)
+        , age_ms(0)
+    {}
+};
+
+struct MultiGetOptions {
+    int concurrency;      // Requests in flight, 1-16, default 8
+
+    MultiGetOptions() : concurrency(8) {}
+};
+
+/** One input of Client::getCustomers(). */
+struct CustomerLookup {
+    std::string customer_id;   // As requested
+    bool ok;
+    CustomerResult customer;   // ok only
+    std::string error;         // !ok: the failure's message
+    std::string error_code;    // !ok: DripError::code()
+    int status_code;           // !ok: HTTP status, 0 if none
+
+    CustomerLookup()
+        : ok(false)
+        , status_code(0)
+    {}
+};
+
+/** One input of Client::getBalances(). */
+struct BalanceLookup {
+    std::string customer_id;   // As requested
+    bool ok;
+    BalanceResult balance;     // ok only
+    std::string error;         // !ok: the failure's message
+    std::string error_code;    // !ok: DripError::code()
+    int status_code;           // !ok: HTTP status, 0 if none
+
+    BalanceLookup()
+        : ok(false)
+        , status_code(0)
+    {}
 };
 
 // =============================================================================
@@ -117,6 +582,37 @@ struct PingResult {
     {}
 };
 
+/**
+ * Latest result of the background health monitor (Config::probe_interval_ms)
+ * for the base URL requests currently go to. checks == 0 until the first
+ * probe completes, or always when the monitor is off.
+ *
+ * ok and status come from the last probe alone; latency_ns is an EWMA over
+ * successful probes, so one slow answer does not swing it.
+ */
+struct HealthSnapshot {
+    bool ok;
+    std::string status;           // As reported by /health; empty on failure
+    std::string error;            // Why the last probe failed, if it did
+    std::string base_url;
+    int64_t latency_ns;           // EWMA of probe round trips
+    int64_t last_latency_ns;
+    int64_t age_ns;               // Time since the last probe completed
+    uint64_t checks;
+    uint64_t failures;
+    int consecutive_failures;
+
+    HealthSnapshot()
+        : ok(false)
+        , latency_ns(0)
+        , last_latency_ns(0)
+        , age_ns(0)
+        , checks(0)
+        , failures(0)
+        , consecutive_failures(0)
+    {}
+};
+
 // =============================================================================
 // Usage Tracking
 // =============================================================================
@@ -0,0 +1,83 @@
+#ifndef DRIP_ATOMIC_HPP
+#define DRIP_ATOMIC_HPP
+
+/*
+ * Minimal relaxed atomics for counters (C++03 has no <atomic>).
+ *
+ * GCC and Clang expose the __atomic builtins in every language mode;
+ * MSVC gets the equivalent Interlocked intrinsics. Internal header —
+ * not installed.
+ */
+
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace drip {
+namespace detail {
+
+#ifdef _MSC_VER
+
+inline uint64_t atomic_load(const volatile uint64_t* p) {
+    return static_cast<uint64_t>(_InterlockedCompareExchange64(
+        reinterpret_cast<volatile __int64*>(const_cast<volatile uint64_t*>(p)), 0, 0));
+}
+
+inline void atomic_store(volatile uint64_t* p, uint64_t v) {
+    _InterlockedExchange64(reinterpret_cast<volatile __int64*>(p), static_cast<__int64>(v));
+}
+
+inline uint64_t atomic_add(volatile uint64_t* p, uint64_t v) {
+    return static_cast<uint64_t>(_InterlockedExchangeAdd64(
+        reinterpret_cast<volatile __int64*>(p), static_cast<__int64>(v))) + v;
+}
+
+inline bool atomic_cas(volatile uint64_t* p, uint64_t expected, uint64_t desired) {
+    return static_cast<uint64_t>(_InterlockedCompareExchange64(
+        reinterpret_cast<volatile __int64*>(p),
+        static_cast<__int64>(desired), static_cast<__int64>(expected))) == expected;
+}
+
+#else
+
+inline uint64_t atomic_load(const volatile uint64_t* p) {
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+inline void atomic_store(volatile uint64_t* p, uint64_t v) {
+    __atomic_store_n(p, v, __ATOMIC_RELAXED);
+}
+
+inline uint64_t atomic_add(volatile uint64_t* p, uint64_t v) {
+    return __atomic_add_fetch(p, v, __ATOMIC_RELAXED);
+}
+
+inline bool atomic_cas(volatile uint64_t* p, uint64_t expected, uint64_t desired) {
+    return __atomic_compare_exchange_n(p, &expected, desired, false,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+#endif
+
+/** Raise *p to v if v is larger. */
+inline void atomic_max(volatile uint64_t* p, uint64_t v) {
+    uint64_t cur = atomic_load(p);
+    while (v > cur && !atomic_cas(p, cur, v)) {
+        cur = atomic_load(p);
+    }
+}
+
+/** Lower *p to v if v is smaller. */
+inline void atomic_min(volatile uint64_t* p, uint64_t v) {
+    uint64_t cur = atomic_load(p);
+    while (v < cur && !atomic_cas(p, cur, v)) {
+        cur = atomic_load(p);
+    }
+}
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_ATOMIC_HPP
@@ -0,0 +1,166 @@
+#include "balance_cache.hpp"
+#include "atomic.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+namespace drip {
+namespace detail {
+
+/* C++03: INT64_MAX needs __STDC_LIMIT_MACROS before <stdint.h>; spelled out instead */
+static const int64_t MAX_MICROS = 9223372036854775807LL;
+
+/* Largest whole USDC amount whose micros, plus six fraction digits, fit in int64_t */
+static const int64_t MAX_WHOLE_USDC = (MAX_MICROS - 999999) / 1000000;
+
+/* Largest single debit estimated locally (1e9 USDC); anything else forces a fetch */
+static const double MAX_DEBIT_MICROS = 1e15;
+
+static int64_t saturating_add(int64_t a, int64_t b) {
+    if (b > 0 && a > MAX_MICROS - b) return MAX_MICROS;
+    if (b < 0 && a < -MAX_MICROS - b) return -MAX_MICROS;
+    return a + b;
+}
+
+bool parse_usdc_micros(const std::string& text, int64_t& micros) {
+    size_t i = 0;
+    bool negative = false;
+    if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+        negative = text[i] == '-';
+        ++i;
+    }
+    int64_t whole = 0;
+    int64_t fraction = 0;
+    int fraction_digits = 0;
+    bool digits = false;
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+        int digit = text[i] - '0';
+        if (whole > (MAX_WHOLE_USDC - digit) / 10) return false;
+        whole = whole * 10 + digit;
+        digits = true;
+    }
+    if (i < text.size() && text[i] == '.') {
+        for (++i; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+            /* Sub-micro digits are truncated */
+            if (fraction_digits < 6) {
+                fraction = fraction * 10 + (text[i] - '0');
+                ++fraction_digits;
+            }
+            digits = true;
+        }
+    }
+    if (!digits || i != text.size()) return false;
+    for (; fraction_digits < 6; ++fraction_digits) fraction *= 10;
+    if (whole > MAX_WHOLE_USDC) return false;
+    micros = whole * 1000000 + fraction;
+    if (negative) micros = -micros;
+    return true;
+}
+
+std::string format_usdc_micros(int64_t micros) {
+    /* Magnitude as unsigned so INT64_MIN does not overflow */
+    uint64_t magnitude = micros < 0 ? 0 - static_cast<uint64_t>(micros) : static_cast<uint64_t>(micros);
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%s%llu.%06llu", micros < 0 ? "-" : "",
+                  static_cast<unsigned long long>(magnitude / 1000000),
+                  static_cast<unsigned long long>(magnitude % 1000000));
+    return buf;
+}
+
+BalanceCache::BalanceCache()
+    : enabled_(false)
+    , capacity_(0)
+    , max_staleness_ns_(0)
+    , refresh_below_micros_(0)
+    , counters_(NULL)
+{}
+
+void BalanceCache::configure(const BalanceCacheConfig& config, MetricsRegistry& metrics) {
+    ScopedLock lock(mutex_);
+    enabled_ = config.enabled && config.capacity > 0 && config.max_staleness_ms > 0;
+    capacity_ = config.capacity > 0 ? static_cast<size_t>(config.capacity) : 0;
+    max_staleness_ns_ = config.max_staleness_ms > 0
+                      ? static_cast<uint64_t>(config.max_staleness_ms) * 1000000ULL : 0;
+    refresh_below_micros_ = static_cast<int64_t>(std::floor(config.refresh_below_usdc * 1e6 + 0.5));
+    unit_price_usdc_ = config.unit_price_usdc;
+    counters_ = &metrics.cache(CACHE_BALANCE);
+    lru_.clear();
+    index_.clear();
+}
+
+bool BalanceCache::get(const std::string& customer_id, uint64_t now_ns,
+                       int64_t& micros, uint64_t& age_ns) {
+    ScopedLock lock(mutex_);
+    Index::const_iterator it = index_.find(customer_id);
+    if (it != index_.end() && it->second->fetched) {
+        const Entry& e = *it->second;
+        uint64_t age = now_ns > e.fetch_mark.sent_ns ? now_ns - e.fetch_mark.sent_ns : 0;
+        /* Debits only grow and saturate, so the difference cannot overflow */
+        int64_t estimate = saturating_add(e.balance_micros, -(e.debited_micros - e.fetch_mark.debited_micros));
+        if (age < max_staleness_ns_ && e.unpriced == e.fetch_mark.unpriced &&
+            estimate > refresh_below_micros_) {
+            micros = estimate;
+            age_ns = age;
+            atomic_add(&counters_->hits, 1);
+            return true;
+        }
+    }
+    atomic_add(&counters_->misses, 1);
+    return false;
+}
+
+BalanceCache::Mark BalanceCache::beginFetch(const std::string& customer_id, uint64_t now_ns) {
+    ScopedLock lock(mutex_);
+    Index::iterator it = index_.find(customer_id);
+    if (it != index_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+    } else {
+        /* The least recently fetched entry is also the stalest */
+        while (index_.size() >= capacity_ && !lru_.empty()) {
+            index_.erase(lru_.back().customer_id);
+            lru_.pop_back();
+            atomic_add(&counters_->evictions, 1);
+        }
+        lru_.push_front(Entry());
+        lru_.front().customer_id = customer_id;
+        it = index_.insert(std::make_pair(customer_id, lru_.begin())).first;
+        atomic_store(&counters_->entries, index_.size());
+    }
+    const Entry& e = *it->second;
+    Mark mark;
+    mark.debited_micros = e.debited_micros;
+    mark.unpriced = e.unpriced;
+    mark.sent_ns = now_ns;
+    return mark;
+}
+
+void BalanceCache::put(const std::string& customer_id, int64_t balance_micros, const Mark& mark) {
+    ScopedLock lock(mutex_);
+    Index::iterator it = index_.find(customer_id);
+    if (it == index_.end()) return;
+    Entry& e = *it->second;
+    /* An older fetch finishing late must not replace a newer one */
+    if (e.fetched && e.fetch_mark.sent_ns > mark.sent_ns) return;
+    e.fetched = true;
+    e.balance_micros = balance_micros;
+    e.fetch_mark = mark;
+}
+
+void BalanceCache::debit(const std::string& customer_id, const std::string& meter, double quantity) {
+    ScopedLock lock(mutex_);
+    Index::iterator it = index_.find(customer_id);
+    if (it == index_.end()) return;
+    Entry& e = *it->second;
+    std::map<std::string, double>::const_iterator price = unit_price_usdc_.find(meter);
+    double amount = price != unit_price_usdc_.end() ? price->second * quantity * 1e6 : -1;
+    /* Unpriced, negative, non-finite (NaN fails both tests) or huge: fetch instead of estimating */
+    if (!(amount >= 0 && amount <= MAX_DEBIT_MICROS)) {
+        ++e.unpriced;
+        return;
+    }
+    /* Round up: overestimating usage only refreshes sooner */
+    e.debited_micros = saturating_add(e.debited_micros, static_cast<int64_t>(std::ceil(amount)));
+}
+
+} // namespace detail
+} // namespace drip
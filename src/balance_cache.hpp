@@ -0,0 +1,103 @@
+#ifndef DRIP_BALANCE_CACHE_HPP
+#define DRIP_BALANCE_CACHE_HPP
+
+/*
+ * getBalance() estimates behind BalanceCacheConfig. Internal header — not
+ * installed.
+ */
+
+#include "drip/types.hpp"
+#include "metrics_registry.hpp"
+#include "sync.hpp"
+
+#include <list>
+#include <map>
+#include <string>
+
+namespace drip {
+namespace detail {
+
+/** Parse a decimal USDC amount ("12.5", "-0.000001") into micro-USDC. */
+bool parse_usdc_micros(const std::string& text, int64_t& micros);
+
+/** Format micro-USDC with six decimals, as the API does. */
+std::string format_usdc_micros(int64_t micros);
+
+/**
+ * Last fetched balance per customer plus the usage this client has
+ * tracked since. Debits are cumulative counters per entry; a fetch
+ * remembers the counter value at the time it was sent (a Mark), so
+ * usage that races a fetch is subtracted again rather than lost. That
+ * errs towards a low estimate, which only makes a refresh come sooner.
+ */
+class BalanceCache {
+public:
+    /** Debit counters when a fetch was sent; pass back to put(). */
+    struct Mark {
+        int64_t debited_micros;
+        uint64_t unpriced;
+        uint64_t sent_ns;
+
+        Mark() : debited_micros(0), unpriced(0), sent_ns(0) {}
+    };
+
+    BalanceCache();
+
+    /** Counters are published to @p metrics under CACHE_BALANCE. */
+    void configure(const BalanceCacheConfig& config, MetricsRegistry& metrics);
+
+    bool enabled() const { return enabled_; }
+
+    /**
+     * Estimated balance if the entry is within max_staleness_ms, no
+     * unpriced usage was tracked since, and the estimate is above
+     * refresh_below_usdc. Counts a hit or miss.
+     */
+    bool get(const std::string& customer_id, uint64_t now_ns, int64_t& micros, uint64_t& age_ns);
+
+    /** Call before fetching; starts tracking debits for the customer. */
+    Mark beginFetch(const std::string& customer_id, uint64_t now_ns);
+
+    void put(const std::string& customer_id, int64_t balance_micros, const Mark& mark);
+
+    /**
+     * Usage about to be reported for the customer. No-op if not tracked.
+     * Usage that cannot be priced (unknown meter, negative, non-finite or
+     * over 1e9 USDC) counts as unpriced, so the next get() fetches.
+     */
+    void debit(const std::string& customer_id, const std::string& meter, double quantity);
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    BalanceCache(const BalanceCache&);
+    BalanceCache& operator=(const BalanceCache&);
+
+    struct Entry {
+        std::string customer_id;
+        bool fetched;
+        int64_t balance_micros;   /* As of fetch_mark */
+        Mark fetch_mark;
+        int64_t debited_micros;   /* Cumulative since the entry was created */
+        uint64_t unpriced;        /* Usage events that could not be priced */
+
+        Entry() : fetched(false), balance_micros(0), debited_micros(0), unpriced(0) {}
+    };
+
+    typedef std::list<Entry> LruList;   /* Front = most recently fetched */
+    typedef std::map<std::string, LruList::iterator> Index;
+
+    Mutex mutex_;
+    bool enabled_;
+    size_t capacity_;
+    uint64_t max_staleness_ns_;
+    int64_t refresh_below_micros_;
+    std::map<std::string, double> unit_price_usdc_;
+    CacheCounters* counters_;
+    LruList lru_;
+    Index index_;
+};
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_BALANCE_CACHE_HPP
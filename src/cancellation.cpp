@@ -0,0 +1,18 @@
+#include "drip/cancellation.hpp"
+#include "atomic.hpp"
+
+namespace drip {
+
+CancellationToken::CancellationToken()
+    : cancelled_(0)
+{}
+
+void CancellationToken::cancel() {
+    detail::atomic_store(&cancelled_, 1);
+}
+
+bool CancellationToken::isCancelled() const {
+    return detail::atomic_load(&cancelled_) != 0;
+}
+
+} // namespace drip
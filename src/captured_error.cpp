@@ -0,0 +1,64 @@
+#include "captured_error.hpp"
+#include "drip/errors.hpp"
+
+namespace drip {
+namespace detail {
+
+void CapturedError::captureCurrent() {
+    status_code = 0;
+    code.clear();
+    /* Classify the exception by rethrowing it; most derived types first */
+    try {
+        throw;
+    } catch (const AuthenticationError& e) {
+        kind = AUTHENTICATION;
+        message = e.what();
+    } catch (const NotFoundError& e) {
+        kind = NOT_FOUND;
+        message = e.what();
+    } catch (const RateLimitError& e) {
+        kind = RATE_LIMIT;
+        message = e.what();
+    } catch (const TimeoutError& e) {
+        kind = TIMEOUT;
+        message = e.what();
+    } catch (const NetworkError& e) {
+        kind = NETWORK;
+        message = e.what();
+    } catch (const CancelledError& e) {
+        kind = CANCELLED;
+        message = e.what();
+    } catch (const CircuitOpenError& e) {
+        kind = CIRCUIT_OPEN;
+        message = e.what();
+    } catch (const DripError& e) {
+        kind = DRIP_ERROR;
+        message = e.what();
+        status_code = e.status_code();
+        code = e.code();
+    } catch (const std::exception& e) {
+        kind = OTHER;
+        message = e.what();
+    } catch (...) {
+        kind = OTHER;
+        message = "Unknown error";
+    }
+}
+
+void CapturedError::raise() const {
+    switch (kind) {
+        case NONE:           return;
+        case AUTHENTICATION: throw AuthenticationError(message);
+        case NOT_FOUND:      throw NotFoundError(message);
+        case RATE_LIMIT:     throw RateLimitError(message);
+        case TIMEOUT:        throw TimeoutError(message);
+        case NETWORK:        throw NetworkError(message);
+        case CANCELLED:      throw CancelledError(message);
+        case CIRCUIT_OPEN:   throw CircuitOpenError(message);
+        case OTHER:          throw DripError(message, 0, "INTERNAL_ERROR");
+        default:             throw DripError(message, status_code, code);
+    }
+}
+
+} // namespace detail
+} // namespace drip
@@ -0,0 +1,49 @@
+#ifndef DRIP_CAPTURED_ERROR_HPP
+#define DRIP_CAPTURED_ERROR_HPP
+
+/*
+ * Exceptions carried between threads. Internal header — not installed.
+ */
+
+#include <string>
+
+namespace drip {
+namespace detail {
+
+/**
+ * A DripError (or subclass) held by value, so a worker thread can hand
+ * its failure to the caller, which rethrows it as the same type.
+ * C++03 has no std::exception_ptr.
+ */
+struct CapturedError {
+    enum Kind {
+        NONE,
+        DRIP_ERROR,
+        AUTHENTICATION,
+        NOT_FOUND,
+        RATE_LIMIT,
+        TIMEOUT,
+        NETWORK,
+        CANCELLED,
+        CIRCUIT_OPEN,
+        OTHER            /* Not a DripError; rethrown as DripError */
+    };
+
+    Kind kind;
+    std::string message;
+    int status_code;
+    std::string code;
+
+    CapturedError() : kind(NONE), status_code(0) {}
+
+    /** Inside a catch block: record the exception being handled. */
+    void captureCurrent();
+
+    /** Throw the recorded exception again. No-op when kind is NONE. */
+    void raise() const;
+};
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_CAPTURED_ERROR_HPP
@@ -0,0 +1,122 @@
+#include "circuit_breaker.hpp"
+
+namespace drip {
+namespace detail {
+
+CircuitBreaker::CircuitBreaker()
+    : metrics_(NULL)
+    , endpoint_(ENDPOINT_OTHER)
+    , slow_ns_(0)
+    , state_(CIRCUIT_CLOSED)
+    , generation_(0)
+    , open_until_ns_(0)
+    , next_(0)
+    , filled_(0)
+    , failures_(0)
+    , slow_(0)
+    , probes_admitted_(0)
+    , probes_succeeded_(0)
+{}
+
+void CircuitBreaker::configure(const CircuitBreakerConfig& config, MetricsRegistry& metrics,
+                               Endpoint endpoint) {
+    ScopedLock lock(mutex_);
+    config_ = config;
+    metrics_ = &metrics;
+    endpoint_ = endpoint;
+    if (config_.window < 1) config_.window = 1;
+    if (config_.half_open_probes < 1) config_.half_open_probes = 1;
+    if (config_.open_ms < 0) config_.open_ms = 0;
+    slow_ns_ = config_.slow_call_ms > 0 ? static_cast<uint64_t>(config_.slow_call_ms) * 1000000ULL : 0;
+    outcomes_.assign(static_cast<size_t>(config_.window), 0);
+    transition(CIRCUIT_CLOSED, 0);
+}
+
+void CircuitBreaker::transition(CircuitState next, uint64_t now_ns) {
+    state_ = next;
+    ++generation_;
+    if (metrics_) metrics_->recordCircuitState(endpoint_, next);
+    if (next == CIRCUIT_OPEN) {
+        open_until_ns_ = now_ns + static_cast<uint64_t>(config_.open_ms) * 1000000ULL;
+    } else if (next == CIRCUIT_HALF_OPEN) {
+        probes_admitted_ = 0;
+        probes_succeeded_ = 0;
+    } else {
+        for (size_t i = 0; i < outcomes_.size(); ++i) outcomes_[i] = 0;
+        next_ = 0;
+        filled_ = 0;
+        failures_ = 0;
+        slow_ = 0;
+    }
+}
+
+bool CircuitBreaker::allow(uint64_t now_ns, uint64_t& ticket) {
+    ScopedLock lock(mutex_);
+    if (state_ == CIRCUIT_OPEN) {
+        if (now_ns < open_until_ns_) return false;
+        transition(CIRCUIT_HALF_OPEN, now_ns);
+    }
+    if (state_ == CIRCUIT_HALF_OPEN) {
+        if (probes_admitted_ >= config_.half_open_probes) return false;
+        ++probes_admitted_;
+    }
+    ticket = generation_;
+    return true;
+}
+
+bool CircuitBreaker::record(uint64_t ticket, bool failed, uint64_t latency_ns, uint64_t now_ns) {
+    ScopedLock lock(mutex_);
+    if (ticket != generation_) return false;
+
+    bool slow = slow_ns_ > 0 && latency_ns >= slow_ns_;
+
+    if (state_ == CIRCUIT_HALF_OPEN) {
+        if (failed || slow) {
+            transition(CIRCUIT_OPEN, now_ns);
+            return true;
+        }
+        if (++probes_succeeded_ >= config_.half_open_probes) {
+            transition(CIRCUIT_CLOSED, now_ns);
+        }
+        return false;
+    }
+    if (state_ != CIRCUIT_CLOSED) return false;
+
+    /* Evict the oldest outcome once the ring is full */
+    unsigned char& slot = outcomes_[next_];
+    if (filled_ == outcomes_.size()) {
+        if (slot & OUTCOME_FAILED) --failures_;
+        if (slot & OUTCOME_SLOW) --slow_;
+    } else {
+        ++filled_;
+    }
+    slot = static_cast<unsigned char>((failed ? OUTCOME_FAILED : 0) | (slow ? OUTCOME_SLOW : 0));
+    if (failed) ++failures_;
+    if (slow) ++slow_;
+    next_ = (next_ + 1) % outcomes_.size();
+
+    if (filled_ < outcomes_.size()) return false;
+    double n = static_cast<double>(filled_);
+    bool trip = (failures_ > 0 && static_cast<double>(failures_) >= config_.failure_rate * n) ||
+                (slow_ > 0 && static_cast<double>(slow_) >= config_.slow_call_rate * n);
+    if (trip) {
+        transition(CIRCUIT_OPEN, now_ns);
+        return true;
+    }
+    return false;
+}
+
+void CircuitBreaker::abandon(uint64_t ticket) {
+    ScopedLock lock(mutex_);
+    if (ticket == generation_ && state_ == CIRCUIT_HALF_OPEN && probes_admitted_ > 0) {
+        --probes_admitted_;
+    }
+}
+
+CircuitState CircuitBreaker::state() const {
+    ScopedLock lock(mutex_);
+    return state_;
+}
+
+} // namespace detail
+} // namespace drip
@@ -0,0 +1,82 @@
+#ifndef DRIP_CIRCUIT_BREAKER_HPP
+#define DRIP_CIRCUIT_BREAKER_HPP
+
+/*
+ * Per-endpoint circuit breaker behind CircuitBreakerConfig. Internal
+ * header — not installed.
+ */
+
+#include "drip/types.hpp"
+#include "drip/metrics.hpp"
+#include "metrics_registry.hpp"
+#include "sync.hpp"
+
+#include <vector>
+
+namespace drip {
+namespace detail {
+
+/**
+ * Count-based sliding window breaker. One mutex per endpoint; allow()
+ * and record() are a handful of comparisons under it.
+ *
+ * allow() hands out a ticket naming the breaker generation it was
+ * admitted under. Every state change starts a new generation, so outcomes
+ * of requests that were already in flight when the breaker tripped (or
+ * recovered) are ignored instead of being mistaken for probe results.
+ */
+class CircuitBreaker {
+public:
+    CircuitBreaker();
+
+    /** State changes are published to @p metrics under @p endpoint. */
+    void configure(const CircuitBreakerConfig& config, MetricsRegistry& metrics, Endpoint endpoint);
+
+    /** Whether a request may be sent now; fills ticket for record(). */
+    bool allow(uint64_t now_ns, uint64_t& ticket);
+
+    /**
+     * Record the outcome of an admitted request.
+     * @return true if this outcome opened the breaker.
+     */
+    bool record(uint64_t ticket, bool failed, uint64_t latency_ns, uint64_t now_ns);
+
+    /** Return an admission whose request ended without an outcome (cancelled). */
+    void abandon(uint64_t ticket);
+
+    CircuitState state() const;
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    CircuitBreaker(const CircuitBreaker&);
+    CircuitBreaker& operator=(const CircuitBreaker&);
+
+    enum { OUTCOME_FAILED = 1, OUTCOME_SLOW = 2 };
+
+    void transition(CircuitState next, uint64_t now_ns);
+
+    mutable Mutex mutex_;
+    CircuitBreakerConfig config_;
+    MetricsRegistry* metrics_;
+    Endpoint endpoint_;
+    uint64_t slow_ns_;
+    CircuitState state_;
+    uint64_t generation_;
+    uint64_t open_until_ns_;
+
+    /* Closed: ring of the last config_.window outcomes */
+    std::vector<unsigned char> outcomes_;
+    size_t next_;
+    size_t filled_;
+    size_t failures_;
+    size_t slow_;
+
+    /* Half-open */
+    int probes_admitted_;
+    int probes_succeeded_;
+};
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_CIRCUIT_BREAKER_HPP
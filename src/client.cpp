@@ -1,9 +1,31 @@
 #include "drip/client.hpp"
+#include "drip/tracing.hpp"
+#include "drip/transport.hpp"
+#include "codec.hpp"
+#include "metrics_registry.hpp"
+#include "circuit_breaker.hpp"
+#include "conditional_cache.hpp"
+#include "balance_cache.hpp"
+#include "captured_error.hpp"
+#include "customer_cache.hpp"
+#include "customer_index.hpp"
+#include "fan_out.hpp"
+#include "hedge.hpp"
+#include "id_cache_file.hpp"
+#include "single_flight.hpp"
+#include "upstream_pool.hpp"
+#include "atomic.hpp"
+#include "clock.hpp"
+#include "sync.hpp"
 
 #include <picojson/picojson.h>
-#include <curl/curl.h>
 
+#include <deque>
+#include <map>
 #include <sstream>
+#include <vector>
+#include <cerrno>
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
 #include <cstring>
@@ -17,10 +39,23 @@
 
 namespace drip {
 
-/* Convenience typedefs for picojson */
-typedef picojson::value  JsonVal;
-typedef picojson::object JsonObj;
-typedef picojson::array  JsonArr;
+using detail::JsonVal;
+using detail::JsonObj;
+using detail::JsonArr;
+using detail::jstr;
+using detail::jnum;
+using detail::jbool;
+using detail::metadata_to_json;
+using detail::json_string;
+using detail::json_int;
+using detail::json_double;
+using detail::json_bool;
+using detail::json_arr;
+using detail::track_usage_body;
+using detail::emit_event_body;
+using detail::run_events_batch_body;
+using detail::parse_customer;
+using detail::url_encode;
 
 // =============================================================================
 // Helpers
@@ -44,38 +79,6 @@ static long long now_ms() {
 #endif
 }
 
-/**
- * Generate a deterministic idempotency key from components.
- */
-static std::string make_idempotency_key(
-    const std::string& prefix,
-    const std::string& a,
-    const std::string& b,
-    double c
-) {
-    std::ostringstream oss;
-    oss << prefix << ":" << a << ":" << b << ":" << c;
-
-    std::string input = oss.str();
-    unsigned long hash = 5381;
-    for (size_t i = 0; i < input.size(); ++i) {
-        hash = ((hash << 5) + hash) + static_cast<unsigned char>(input[i]);
-    }
-
-    std::ostringstream hex;
-    hex << prefix << "_" << std::hex << hash;
-    return hex.str();
-}
-
-static std::string make_idempotency_key_int(
-    const std::string& prefix,
-    const std::string& a,
-    const std::string& b,
-    int c
-) {
-    return make_idempotency_key(prefix, a, b, static_cast<double>(c));
-}
-
 /**
  * Get environment variable or fallback.
  */
@@ -87,106 +90,304 @@ static std::string env_or(const char* name, const std::string& fallback) {
     return fallback;
 }
 
+/* Upper bound on the bulk methods' concurrency: the transport keeps 16 idle connections */
+static const int MAX_PARALLEL_REQUESTS = 16;
+
+static int clamp_concurrency(int requested) {
+    if (requested < 1) return 1;
+    return requested > MAX_PARALLEL_REQUESTS ? MAX_PARALLEL_REQUESTS : requested;
+}
+
+/** Map a non-2xx HTTP status to the metrics error class. */
+static ErrorKind error_kind_for_status(long http_code) {
+    if (http_code == 401) return ERROR_AUTH;
+    if (http_code == 404) return ERROR_NOT_FOUND;
+    if (http_code == 429) return ERROR_RATE_LIMITED;
+    if (http_code >= 500) return ERROR_SERVER;
+    return ERROR_CLIENT;
+}
+
 // =============================================================================
-// picojson helpers — build & read JSON safely
+// Transfer timing
 // =============================================================================
 
-/** Create a JSON string value. */
-static JsonVal jstr(const std::string& s) {
-    return JsonVal(s);
+/** Split curl's cumulative timers into per-phase durations (ns). */
+static void transfer_phases(const RequestInfo& info, uint64_t (&phase_ns)[TRANSFER_PHASE_COUNT]) {
+    int64_t connected = info.appconnect_us > 0 ? info.appconnect_us : info.connect_us;
+    int64_t us[TRANSFER_PHASE_COUNT];
+    us[PHASE_DNS] = info.namelookup_us;
+    us[PHASE_CONNECT] = info.connect_us - info.namelookup_us;
+    us[PHASE_TLS] = info.appconnect_us > 0 ? info.appconnect_us - info.connect_us : 0;
+    us[PHASE_SERVER] = info.starttransfer_us - (info.pretransfer_us > connected ? info.pretransfer_us : connected);
+    us[PHASE_DOWNLOAD] = info.total_us - info.starttransfer_us;
+    for (int i = 0; i < TRANSFER_PHASE_COUNT; ++i) {
+        phase_ns[i] = us[i] > 0 ? static_cast<uint64_t>(us[i]) * 1000ULL : 0;
+    }
 }
 
-/** Create a JSON number value. */
-static JsonVal jnum(double n) {
-    return JsonVal(n);
+/** Fold one request's info into the per-call total (see RequestInfo). */
+static void accumulate_info(RequestInfo& total, const RequestInfo& one) {
+    total.connection_reused = (total.requests == 0 || total.connection_reused) && one.connection_reused;
+    total.requests += 1;
+    total.http_status = one.http_status;
+    total.namelookup_us += one.namelookup_us;
+    total.connect_us += one.connect_us;
+    total.appconnect_us += one.appconnect_us;
+    total.pretransfer_us += one.pretransfer_us;
+    total.starttransfer_us += one.starttransfer_us;
+    total.total_us += one.total_us;
+    total.bytes_sent += one.bytes_sent;
+    total.bytes_received += one.bytes_received;
 }
 
-/** Create a JSON bool value. */
-static JsonVal jbool(bool b) {
-    return JsonVal(b);
+// =============================================================================
+// Trace ids
+// =============================================================================
+
+static volatile uint64_t trace_id_counter = 0;
+
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
 }
 
-/** Convert Metadata map to a JSON object value. */
-static JsonVal metadata_to_json(const Metadata& m) {
-    JsonObj obj;
-    for (Metadata::const_iterator it = m.begin(); it != m.end(); ++it) {
-        obj[it->first] = jstr(it->second);
+/** 128-bit random-looking id as 32 hex chars (W3C trace-id shaped). */
+static std::string generate_trace_id() {
+    uint64_t seq = detail::atomic_add(&trace_id_counter, 1);
+    uint64_t hi = splitmix64(detail::monotonic_ns() ^ (seq << 32));
+    uint64_t lo = splitmix64(hi ^ seq ^ static_cast<uint64_t>(now_ms()));
+
+    static const char* HEX = "0123456789abcdef";
+    char buf[32];
+    for (int i = 0; i < 16; ++i) {
+        buf[i] = HEX[(hi >> (60 - 4 * i)) & 0xF];
+        buf[16 + i] = HEX[(lo >> (60 - 4 * i)) & 0xF];
     }
-    return JsonVal(obj);
+    return std::string(buf, sizeof(buf));
 }
 
-/** Parse Metadata from a JSON object value. */
-static Metadata metadata_from_json(const JsonVal& v) {
-    Metadata m;
-    if (v.is<JsonObj>()) {
-        const JsonObj& obj = v.get<JsonObj>();
-        for (JsonObj::const_iterator it = obj.begin(); it != obj.end(); ++it) {
-            if (it->second.is<std::string>()) {
-                m[it->first] = it->second.get<std::string>();
-            } else {
-                m[it->first] = it->second.serialize();
-            }
+// =============================================================================
+// CallContext
+// =============================================================================
+
+struct CallContext;
+
+/**
+ * RAII operation span. Does nothing unless trace hooks are installed.
+ * Call done() on success; a scope destroyed without it (an exception is
+ * unwinding) reports failure with the last attempt error.
+ */
+class OperationScope {
+public:
+    OperationScope(CallContext& ctx, const char* name);
+    ~OperationScope();
+
+    void done() { ok_ = true; }
+
+private:
+    OperationScope(const OperationScope&);
+    OperationScope& operator=(const OperationScope&);
+
+    CallContext& ctx_;
+    OperationSpan span_;
+    OperationSpan* saved_current_;
+    std::string saved_trace_id_;
+    uint64_t start_ns_;
+    bool ok_;
+};
+
+/**
+ * Per-call state shared by every HTTP request a public method makes,
+ * so multi-request operations like recordRun() report as one call.
+ */
+struct CallContext {
+    const RequestOptions& options;
+    TraceHooks* hooks;
+    OperationSpan* current;   /* Innermost open operation (hooks only) */
+    std::string trace_id;     /* Sent on each attempt; empty = no header */
+    std::string last_error;
+    uint64_t deadline_ns;     /* monotonic_ns() limit for the call; 0 = none */
+    OperationScope root;
+
+    CallContext(const RequestOptions& opts, TraceHooks* trace_hooks, const char* name)
+        : options(opts)
+        , hooks(trace_hooks)
+        , current(NULL)
+        , trace_id(opts.trace_id)
+        , deadline_ns(opts.timeout_ms > 0
+                      ? detail::monotonic_ns() + static_cast<uint64_t>(opts.timeout_ms) * 1000000ULL
+                      : 0)
+        , root(*this, name)
+    {
+        if (options.info) {
+            *options.info = RequestInfo();
         }
     }
-    return m;
-}
 
-/** Safely get a string from a JSON object. */
-static std::string json_string(const JsonObj& obj, const char* key) {
-    JsonObj::const_iterator it = obj.find(key);
-    if (it != obj.end() && it->second.is<std::string>()) {
-        return it->second.get<std::string>();
+    /**
+     * One item of a fan-out operation such as createCustomers(), possibly
+     * on another thread: its span is a child of @p parent's, and it shares
+     * the parent's trace id and deadline. @p parent must stay open (and
+     * unchanged) until the item is done.
+     */
+    CallContext(const CallContext& parent, const char* name)
+        : options(parent.options)
+        , hooks(parent.hooks)
+        , current(parent.current)
+        , trace_id(parent.trace_id)
+        , deadline_ns(parent.deadline_ns)
+        , root(*this, name)
+    {}
+
+    /** Mark the call successful and pass its result through. */
+    template <typename T>
+    const T& done(const T& result) {
+        root.done();
+        return result;
     }
-    return "";
-}
+};
 
-static int json_int(const JsonObj& obj, const char* key, int def = 0) {
-    JsonObj::const_iterator it = obj.find(key);
-    if (it != obj.end() && it->second.is<double>()) {
-        return static_cast<int>(it->second.get<double>());
+OperationScope::OperationScope(CallContext& ctx, const char* name)
+    : ctx_(ctx)
+    , saved_current_(NULL)
+    , start_ns_(0)
+    , ok_(false)
+{
+    if (!ctx_.hooks) return;
+
+    span_.name = name;
+    span_.parent = ctx_.current;
+    span_.trace_id = ctx_.trace_id;
+    ctx_.hooks->onOperationStart(span_);
+    if (span_.trace_id.empty()) {
+        span_.trace_id = generate_trace_id();
     }
-    return def;
+
+    saved_current_ = ctx_.current;
+    saved_trace_id_ = ctx_.trace_id;
+    ctx_.current = &span_;
+    ctx_.trace_id = span_.trace_id;
+    start_ns_ = detail::monotonic_ns();
 }
 
-static double json_double(const JsonObj& obj, const char* key, double def = 0.0) {
-    JsonObj::const_iterator it = obj.find(key);
-    if (it != obj.end() && it->second.is<double>()) {
-        return it->second.get<double>();
+OperationScope::~OperationScope() {
+    if (!ctx_.hooks) return;
+
+    span_.duration_ns = static_cast<int64_t>(detail::monotonic_ns() - start_ns_);
+    span_.ok = ok_;
+    if (!ok_) {
+        span_.error = ctx_.last_error;
     }
-    return def;
+    ctx_.current = saved_current_;
+    ctx_.trace_id = saved_trace_id_;
+    ctx_.hooks->onOperationEnd(span_);
 }
 
-static bool json_bool(const JsonObj& obj, const char* key, bool def = false) {
-    JsonObj::const_iterator it = obj.find(key);
-    if (it != obj.end() && it->second.is<bool>()) {
-        return it->second.get<bool>();
+/**
+ * RAII attempt span around one HTTP request. Does nothing unless trace
+ * hooks are installed.
+ */
+class AttemptScope {
+public:
+    AttemptScope(CallContext& ctx, Endpoint endpoint, const std::string& method,
+                 const std::string& path, int attempt)
+        : ctx_(ctx)
+        , start_ns_(0)
+    {
+        if (!ctx_.hooks) return;
+        span_.operation = ctx_.current;
+        span_.endpoint = endpoint;
+        span_.method = method.c_str();
+        span_.path = path;
+        span_.attempt = attempt;
+        ctx_.hooks->onAttemptStart(span_);
+        start_ns_ = detail::monotonic_ns();
+    }
+
+    ~AttemptScope() {
+        if (!ctx_.hooks) return;
+        span_.duration_ns = static_cast<int64_t>(detail::monotonic_ns() - start_ns_);
+        ctx_.hooks->onAttemptEnd(span_);
     }
-    return def;
-}
 
-/** Check if a key exists in a JSON object. */
-static bool json_has(const JsonObj& obj, const char* key) {
-    return obj.find(key) != obj.end();
-}
+    void setTiming(const RequestInfo& info) {
+        if (!ctx_.hooks) return;
+        span_.timing = info;
+        span_.http_status = info.http_status;
+    }
 
-/** Get a nested array. Returns empty array if missing. */
-static JsonArr json_arr(const JsonObj& obj, const char* key) {
-    JsonObj::const_iterator it = obj.find(key);
-    if (it != obj.end() && it->second.is<JsonArr>()) {
-        return it->second.get<JsonArr>();
+    void succeed() {
+        span_.ok = true;
     }
-    return JsonArr();
-}
+
+    /** Record the failure about to be thrown. */
+    void fail(const std::string& message) {
+        if (!ctx_.hooks) return;
+        span_.error = message;
+        ctx_.last_error = message;
+    }
+
+private:
+    AttemptScope(const AttemptScope&);
+    AttemptScope& operator=(const AttemptScope&);
+
+    CallContext& ctx_;
+    AttemptSpan span_;
+    uint64_t start_ns_;
+};
 
 // =============================================================================
-// CURL write callback
+// Retry policy
 // =============================================================================
 
-static size_t curl_write_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
-    std::string* buf = static_cast<std::string*>(userdata);
-    size_t total = size * nmemb;
-    buf->append(ptr, total);
-    return total;
+/** Parse a delta-seconds Retry-After header; -1 if absent or an HTTP date. */
+static int retry_after_ms(const HttpResponse& response) {
+    std::map<std::string, std::string>::const_iterator it = response.headers.find("retry-after");
+    if (it == response.headers.end() || it->second.empty()) return -1;
+    char* end = NULL;
+    long secs = std::strtol(it->second.c_str(), &end, 10);
+    if (end == it->second.c_str() || *end != '\0' || secs < 0) return -1;
+    return secs > 3600 ? 3600000 : static_cast<int>(secs * 1000);
+}
+
+/**
+ * Whether a failed attempt may be repeated. Requests that are not safe to
+ * repeat are only retried on 429, which the API returns before doing work.
+ */
+static bool is_retryable(const HttpResponse& response, bool idempotent) {
+    if (response.status == TRANSPORT_CANCELLED) return false;
+    if (response.status != TRANSPORT_OK) return idempotent;
+    int code = response.http_status;
+    if (code == 429) return true;
+    return idempotent && (code == 500 || code == 502 || code == 503 || code == 504);
+}
+
+/** GET /workflows and GET /customers/{id} are sent conditionally (ConditionalGetConfig). */
+static bool is_conditional_path(const std::string& path) {
+    if (path == "/workflows") return true;
+    static const std::string customers = "/customers/";
+    return path.size() > customers.size() && path.compare(0, customers.size(), customers) == 0 &&
+           path.find_first_of("/?", customers.size()) == std::string::npos;
+}
+
+/** GETs, PATCH and POSTs carrying an idempotency key are safe to repeat. */
+static bool is_idempotent(const std::string& method, Endpoint endpoint) {
+    if (method != "POST") return true;
+    return endpoint == ENDPOINT_USAGE || endpoint == ENDPOINT_RUN_EVENTS ||
+           endpoint == ENDPOINT_RUN_EVENTS_BATCH;
+}
+
+static volatile uint64_t backoff_counter = 0;
+
+/** Full-jitter exponential backoff: uniform in [0, min(cap, base * 2^(retry-1))]. */
+static int backoff_ms(int retry, int base_ms, int cap_ms) {
+    uint64_t ceiling = static_cast<uint64_t>(base_ms > 0 ? base_ms : 1);
+    for (int i = 1; i < retry && ceiling < static_cast<uint64_t>(cap_ms); ++i) ceiling *= 2;
+    if (ceiling > static_cast<uint64_t>(cap_ms)) ceiling = static_cast<uint64_t>(cap_ms);
+    uint64_t r = splitmix64(detail::monotonic_ns() ^ detail::atomic_add(&backoff_counter, 1));
+    return static_cast<int>(r % (ceiling + 1));
 }
 
 // =============================================================================
@@ -195,11 +396,49 @@ static size_t curl_write_cb(char* ptr, size_t size, size_t nmemb, void* userdata
 
 struct Client::Impl {
     std::string api_key;
-    std::string base_url;
+    std::string auth_header;
+    std::string trace_header_prefix;
+    TraceHooks* trace_hooks;
     int timeout_ms;
+    int connect_timeout_ms;
+    bool coalesce_gets;
+    bool ack_only;
+    int max_retries;
+    int retry_backoff_ms;
+    int retry_max_backoff_ms;
     KeyType key_type;
-
-    Impl(const Config& config) {
+    detail::MetricsRegistry metrics;
+    bool breaker_enabled;
+    detail::CircuitBreaker breakers[ENDPOINT_COUNT];
+    detail::Hedger hedger;
+    detail::UpstreamPool upstreams;
+    detail::CustomerCache customer_cache;
+    detail::CustomerIndex customer_index;
+    detail::BalanceCache balance_cache;
+    detail::SingleFlight single_flight;
+    detail::ConditionalCache conditional_cache;
+    detail::IdCacheFile id_cache;
+
+    /* Config::id_cache refresh thread */
+    int id_cache_refresh_ms;
+    detail::Mutex id_cache_mutex;
+    detail::CondVar id_cache_cv;
+    CancellationToken id_cache_cancel;
+    bool id_cache_stop;
+    bool id_cache_running;
+    bool id_cache_seeded;   /* customer_index holds the file's customers; under its refreshMutex() */
+
+    Transport* transport;
+    CurlTransport* owned_transport;   /* Set when Config::transport is NULL */
+
+    Impl(const Config& config)
+        : id_cache_refresh_ms(0)
+        , id_cache_stop(false)
+        , id_cache_running(false)
+        , id_cache_seeded(false)
+        , transport(NULL)
+        , owned_transport(NULL)
+    {
         /* Resolve API key */
         api_key = config.api_key;
         if (api_key.empty()) {
@@ -211,17 +450,26 @@ struct Client::Impl {
                 0, "NO_API_KEY"
             );
         }
+        auth_header = "Authorization: Bearer " + api_key;
 
-        /* Resolve base URL */
-        base_url = config.base_url;
-        if (base_url.empty()) {
-            base_url = env_or("DRIP_BASE_URL", DEFAULT_BASE_URL);
-        }
-        while (!base_url.empty() && base_url[base_url.size() - 1] == '/') {
-            base_url.erase(base_url.size() - 1);
+        /* Resolve base URLs */
+        std::vector<std::string> base_urls = config.base_urls;
+        if (base_urls.empty()) {
+            base_urls.push_back(config.base_url.empty() ? env_or("DRIP_BASE_URL", DEFAULT_BASE_URL)
+                                                        : config.base_url);
         }
+        upstreams.configure(base_urls);
 
         timeout_ms = config.timeout_ms > 0 ? config.timeout_ms : 30000;
+        connect_timeout_ms = config.connect_timeout_ms > 0 ? config.connect_timeout_ms : timeout_ms;
+        coalesce_gets = config.coalesce_gets;
+        ack_only = config.ack_only;
+        max_retries = config.max_retries > 0 ? config.max_retries : 0;
+        retry_backoff_ms = config.retry_backoff_ms > 0 ? config.retry_backoff_ms : 100;
+        retry_max_backoff_ms = config.retry_max_backoff_ms > 0 ? config.retry_max_backoff_ms : 5000;
+        trace_hooks = config.trace_hooks;
+        trace_header_prefix = (config.trace_header.empty() ? std::string("X-Request-Id")
+                                                           : config.trace_header) + ": ";
 
         /* Detect key type */
         if (api_key.size() >= 3 && api_key.substr(0, 3) == "sk_") {
@@ -231,70 +479,308 @@ struct Client::Impl {
         } else {
             key_type = KEY_UNKNOWN;
         }
+
+        breaker_enabled = config.circuit_breaker.enabled;
+        if (breaker_enabled) {
+            for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+                breakers[e].configure(config.circuit_breaker, metrics, static_cast<Endpoint>(e));
+            }
+        }
+
+        hedger.configure(config.hedge, metrics);
+        customer_cache.configure(config.customer_cache, metrics);
+        customer_index.configure(metrics);
+        balance_cache.configure(config.balance_cache, metrics);
+        conditional_cache.configure(config.conditional_gets, metrics);
+        id_cache.configure(config.id_cache, metrics);
+
+        transport = config.transport;
+        if (!transport) {
+            owned_transport = new CurlTransport();
+            transport = owned_transport;
+        }
+
+        if (config.probe_interval_ms > 0) {
+            upstreams.startProbes(*transport, auth_header, config.probe_interval_ms, connect_timeout_ms);
+        }
+        if (id_cache.enabled() && config.id_cache.refresh_interval_ms > 0) {
+            id_cache_refresh_ms = config.id_cache.refresh_interval_ms;
+            id_cache_running = detail::start_detached_thread(&Impl::id_cache_main, this);
+        }
+    }
+
+    ~Impl() {
+        /* Probes, the id cache refresh and cancelled hedge losers may still be using the transport */
+        upstreams.stopProbes();
+        stop_id_cache_refresh();
+        hedger.drain();
+        delete owned_transport;
     }
 
     /**
      * Make an HTTP request. Returns parsed JSON object.
+     *
+     * With ack_only set, a 2xx response is returned as an empty object
+     * without buffering or parsing the body.
      */
-    JsonObj request(const std::string& method, const std::string& path, const JsonObj& body) {
-        CURL* curl = curl_easy_init();
-        if (!curl) {
-            throw NetworkError("Failed to initialize CURL");
-        }
-
-        std::string url = base_url + path;
-        std::string response_buf;
-        long http_code = 0;
-
-        struct curl_slist* headers = NULL;
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-        std::string auth_header = "Authorization: Bearer " + api_key;
-        headers = curl_slist_append(headers, auth_header.c_str());
-
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_write_cb);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_buf);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, static_cast<long>(timeout_ms));
-        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
-
-        std::string body_str;
-        if (method == "POST" || method == "PATCH") {
-            body_str = JsonVal(body).serialize();
-            if (method == "PATCH") {
-                curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PATCH");
-            } else {
-                curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    JsonObj request(CallContext& ctx, const std::string& method, const std::string& path,
+                    const JsonObj& body, bool ack_only = false) {
+        return request_at(ctx, false, method, path, body, ack_only);
+    }
+
+    /**
+     * request() with the path relative to the base URL, or with at_root to
+     * the unversioned API root (ping()). Serializes once, then sends with
+     * failover and retries per Config. With hedge set, each attempt may be
+     * hedged per Config::hedge; only pass it for reads.
+     */
+    JsonObj request_at(CallContext& ctx, bool at_root, const std::string& method,
+                       const std::string& path, const JsonObj& body, bool ack_only,
+                       bool hedge = false) {
+        Endpoint endpoint = detail::MetricsRegistry::classify(path);
+
+        HttpRequest req;
+        req.method = method;
+        req.discard_success_body = ack_only;
+        req.cancellation = ctx.options.cancellation;
+        req.headers.push_back("Content-Type: application/json");
+        req.headers.push_back(auth_header);
+        if (!ctx.trace_id.empty()) {
+            req.headers.push_back(trace_header_prefix + ctx.trace_id);
+        }
+        if (method != "GET") {
+            uint64_t ser_start = detail::monotonic_ns();
+            req.body = JsonVal(body).serialize();
+            metrics.recordSerialize(endpoint, detail::monotonic_ns() - ser_start);
+        }
+
+        /* Validators from the last full response; a 304 reuses its body */
+        std::string etag;
+        std::string last_modified;
+        size_t plain_headers = req.headers.size();
+        bool conditional = method == "GET" && conditional_cache.enabled() && is_conditional_path(path) &&
+                           conditional_cache.validators(path, etag, last_modified);
+        if (conditional) {
+            if (!etag.empty()) req.headers.push_back("If-None-Match: " + etag);
+            if (!last_modified.empty()) req.headers.push_back("If-Modified-Since: " + last_modified);
+        }
+
+        bool idempotent = is_idempotent(method, endpoint);
+        int retries = 0;
+        uint64_t tried = 0;   /* Upstreams already failed over from, by bit */
+        size_t tried_count = 0;
+        for (int attempt_no = 1; ; ++attempt_no) {
+            throw_if_cancelled(ctx);
+            size_t upstream = upstreams.pick(tried, detail::monotonic_ns());
+            req.url = (at_root ? upstreams.rootUrl(upstream) : upstreams.baseUrl(upstream)) + path;
+            req.timeout_ms = attempt_timeout_ms(ctx);
+            req.connect_timeout_ms = connect_timeout_ms < req.timeout_ms ? connect_timeout_ms : req.timeout_ms;
+
+            uint64_t ticket = 0;
+            if (breaker_enabled && !breakers[endpoint].allow(detail::monotonic_ns(), ticket)) {
+                metrics.recordCircuitRejection(endpoint);
+                ctx.last_error = std::string("Circuit breaker open for ") + endpoint_to_string(endpoint);
+                throw CircuitOpenError(ctx.last_error);
+            }
+
+            int delay_ms = 0;
+            {
+                AttemptScope attempt(ctx, endpoint, method, path, attempt_no);
+                HttpResponse resp;
+                send(ctx, endpoint, req, resp, attempt, ticket, hedge && hedger.enabled(), upstream);
+
+                /* Another base URL may answer where this one did not; no backoff */
+                tried |= static_cast<uint64_t>(1) << upstream;
+                bool failover = idempotent && upstream_failed(resp) && ++tried_count < upstreams.size();
+                bool retry = !failover && retries < max_retries && is_retryable(resp, idempotent);
+                if (retry) {
+                    tried = 0;
+                    tried_count = 0;
+                    delay_ms = retry_after_ms(resp);
+                    if (delay_ms < 0) delay_ms = backoff_ms(retries + 1, retry_backoff_ms, retry_max_backoff_ms);
+                    if (delay_ms > retry_max_backoff_ms) delay_ms = retry_max_backoff_ms;
+                    /* No point sleeping past the deadline; report this failure instead */
+                    if (ctx.deadline_ns != 0 &&
+                        detail::monotonic_ns() + static_cast<uint64_t>(delay_ms) * 1000000ULL >= ctx.deadline_ns) {
+                        retry = false;
+                    }
+                }
+                if (!retry && !failover) {
+                    if (conditional && resp.status == TRANSPORT_OK && resp.http_status == 304) {
+                        JsonObj cached;
+                        if (conditional_cache.reuse(path, etag, last_modified, cached)) {
+                            attempt.succeed();
+                            return cached;
+                        }
+                        /* Evicted or replaced meanwhile: ask again for the full body */
+                        attempt.fail("Cached response for 304 no longer available");
+                        conditional = false;
+                        req.headers.resize(plain_headers);
+                        tried = 0;
+                        tried_count = 0;
+                        continue;
+                    }
+                    JsonObj data = interpret(endpoint, resp, ack_only, attempt);
+                    if (method == "GET" && conditional_cache.enabled() && is_conditional_path(path)) {
+                        conditional_cache.store(path, resp.headers, data);
+                    }
+                    return data;
+                }
+
+                std::ostringstream msg;
+                if (resp.status != TRANSPORT_OK) msg << resp.error;
+                else msg << "Request failed with status " << resp.http_status;
+                attempt.fail(msg.str());
+                if (failover) {
+                    metrics.recordFailover(endpoint);
+                    continue;
+                }
             }
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body_str.c_str());
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(body_str.size()));
+            ++retries;
+            metrics.recordRetry(endpoint);
+            backoff_sleep(ctx, delay_ms);
+        }
+    }
+
+    /** The upstream did not answer usefully: a transport error or a 5xx. */
+    static bool upstream_failed(const HttpResponse& resp) {
+        if (resp.status == TRANSPORT_CANCELLED) return false;
+        return resp.status != TRANSPORT_OK || resp.http_status >= 500;
+    }
+
+    void throw_if_cancelled(CallContext& ctx) {
+        if (ctx.options.cancellation && ctx.options.cancellation->isCancelled()) {
+            ctx.last_error = "Request cancelled";
+            throw CancelledError(ctx.last_error);
+        }
+    }
+
+    /** Retry backoff that ends early (and throws) if the call is cancelled. */
+    void backoff_sleep(CallContext& ctx, int delay_ms) {
+        if (!ctx.options.cancellation) {
+            detail::sleep_ms(delay_ms);
+            return;
+        }
+        static const int SLICE_MS = 10;
+        for (int slept = 0; slept < delay_ms; slept += SLICE_MS) {
+            throw_if_cancelled(ctx);
+            detail::sleep_ms(delay_ms - slept < SLICE_MS ? delay_ms - slept : SLICE_MS);
+        }
+    }
+
+    /**
+     * Timeout for the next request: Config::timeout_ms, cut to what is left
+     * of the call's deadline. Throws TimeoutError once the deadline passed.
+     */
+    int attempt_timeout_ms(CallContext& ctx) {
+        if (ctx.deadline_ns == 0) return timeout_ms;
+        uint64_t now = detail::monotonic_ns();
+        /* Less than 1 ms left is as good as none: curl treats 0 as no limit */
+        if (now + 1000000ULL > ctx.deadline_ns) {
+            std::ostringstream msg;
+            msg << "Call deadline of " << ctx.options.timeout_ms << " ms exceeded";
+            ctx.last_error = msg.str();
+            throw TimeoutError(ctx.last_error);
+        }
+        uint64_t left_ms = (ctx.deadline_ns - now) / 1000000ULL;
+        return left_ms < static_cast<uint64_t>(timeout_ms) ? static_cast<int>(left_ms) : timeout_ms;
+    }
+
+    /**
+     * One attempt over the transport, hedged if asked; records transfer
+     * metrics, timing and the outcome for the endpoint's circuit breaker.
+     */
+    void send(CallContext& ctx, Endpoint endpoint, const HttpRequest& req, HttpResponse& resp,
+              AttemptScope& attempt, uint64_t breaker_ticket, bool hedge, size_t upstream) {
+        uint64_t xfer_start = detail::monotonic_ns();
+        if (hedge) {
+            hedger.perform(*transport, endpoint, req, resp);
         } else {
-            curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+            transport->perform(req, resp);
+        }
+        uint64_t xfer_end = detail::monotonic_ns();
+        uint64_t xfer_ns = xfer_end - xfer_start;
+
+        if (resp.status != TRANSPORT_CANCELLED) {
+            upstreams.record(upstream, upstream_failed(resp), xfer_ns, xfer_end);
+        }
+        if (breaker_enabled) {
+            if (resp.status == TRANSPORT_CANCELLED) {
+                breakers[endpoint].abandon(breaker_ticket);
+            } else {
+                breakers[endpoint].record(breaker_ticket, upstream_failed(resp), xfer_ns, xfer_end);
+            }
         }
 
-        CURLcode res = curl_easy_perform(curl);
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+        RequestInfo& info = resp.info;
+        info.requests = 1;
+        info.http_status = resp.http_status;
+        if (ctx.options.info) {
+            accumulate_info(*ctx.options.info, info);
+        }
+        attempt.setTiming(info);
+
+        metrics.recordRequest(endpoint, xfer_ns,
+                              static_cast<uint64_t>(info.bytes_sent),
+                              static_cast<uint64_t>(info.bytes_received));
 
-        if (res == CURLE_OPERATION_TIMEDOUT) {
-            throw TimeoutError("Request timed out");
+        if (resp.status == TRANSPORT_TIMEOUT) {
+            metrics.recordError(endpoint, ERROR_TIMEOUT);
+            return;
+        }
+        if (resp.status == TRANSPORT_CANCELLED) {
+            metrics.recordError(endpoint, ERROR_CANCELLED);
+            return;
         }
-        if (res != CURLE_OK) {
-            throw NetworkError(std::string("CURL error: ") + curl_easy_strerror(res));
+        if (resp.status != TRANSPORT_OK) {
+            metrics.recordError(endpoint, ERROR_NETWORK);
+            return;
         }
 
-        /* 204 No Content */
-        if (http_code == 204) {
+        uint64_t phase_ns[TRANSFER_PHASE_COUNT];
+        transfer_phases(info, phase_ns);
+        metrics.recordPhases(endpoint, phase_ns, info.connection_reused);
+
+        /* 304 only answers a conditional GET (see ConditionalCache) */
+        if ((resp.http_status < 200 || resp.http_status >= 300) && resp.http_status != 304) {
+            metrics.recordError(endpoint, error_kind_for_status(resp.http_status));
+        }
+    }
+
+    /** Turn the final attempt's response into a result or an exception. */
+    JsonObj interpret(Endpoint endpoint, const HttpResponse& resp, bool ack_only, AttemptScope& attempt) {
+        if (resp.status == TRANSPORT_TIMEOUT) {
+            attempt.fail(resp.error);
+            throw TimeoutError(resp.error);
+        }
+        if (resp.status == TRANSPORT_CANCELLED) {
+            attempt.fail(resp.error);
+            throw CancelledError(resp.error);
+        }
+        if (resp.status != TRANSPORT_OK) {
+            attempt.fail(resp.error);
+            throw NetworkError(resp.error);
+        }
+
+        long http_code = resp.http_status;
+        bool http_ok = http_code >= 200 && http_code < 300;
+
+        /* 204 No Content, or a 2xx whose body was discarded */
+        if (http_code == 204 || (ack_only && http_ok)) {
+            attempt.succeed();
             JsonObj result;
             result["success"] = jbool(true);
             return result;
         }
 
         /* Parse response */
+        uint64_t parse_start = detail::monotonic_ns();
         JsonVal parsed;
-        std::string parse_err = picojson::parse(parsed, response_buf);
+        std::string parse_err = picojson::parse(parsed, resp.body);
+        metrics.recordParse(endpoint, detail::monotonic_ns() - parse_start);
         if (!parse_err.empty()) {
+            if (http_ok) metrics.recordError(endpoint, ERROR_PARSE);
+            attempt.fail("Failed to parse API response: " + parse_err);
             throw DripError(
                 std::string("Failed to parse API response: ") + parse_err,
                 static_cast<int>(http_code),
@@ -303,6 +789,8 @@ struct Client::Impl {
         }
 
         if (!parsed.is<JsonObj>()) {
+            if (http_ok) metrics.recordError(endpoint, ERROR_PARSE);
+            attempt.fail("API response is not a JSON object");
             throw DripError(
                 "API response is not a JSON object",
                 static_cast<int>(http_code),
@@ -313,7 +801,7 @@ struct Client::Impl {
         JsonObj data = parsed.get<JsonObj>();
 
         /* Check for HTTP errors */
-        if (http_code < 200 || http_code >= 300) {
+        if (!http_ok) {
             std::string msg = json_string(data, "message");
             if (msg.empty()) {
                 msg = json_string(data, "error");
@@ -324,6 +812,7 @@ struct Client::Impl {
                 msg = oss.str();
             }
             std::string code = json_string(data, "code");
+            attempt.fail(msg);
 
             if (http_code == 401) throw AuthenticationError(msg);
             if (http_code == 404) throw NotFoundError(msg);
@@ -331,25 +820,123 @@ struct Client::Impl {
             throw DripError(msg, static_cast<int>(http_code), code);
         }
 
+        attempt.succeed();
         return data;
     }
 
-    /* Overload for GET (no body) */
-    JsonObj request(const std::string& method, const std::string& path) {
-        return request(method, path, JsonObj());
+    JsonObj get(CallContext& ctx, const std::string& path) {
+        return get_coalesced(ctx, path, false);
     }
 
-    JsonObj get(const std::string& path) {
-        return request("GET", path);
+    /** get() for latency-sensitive reads that may be hedged. */
+    JsonObj get_hedged(CallContext& ctx, const std::string& path) {
+        return get_coalesced(ctx, path, true);
     }
 
-    JsonObj post(const std::string& path, const JsonObj& body) {
-        return request("POST", path, body);
+    /** GET that shares an identical request already in flight (Config::coalesce_gets). */
+    JsonObj get_coalesced(CallContext& ctx, const std::string& path, bool hedge) {
+        if (!coalesce_gets) {
+            return request_at(ctx, false, "GET", path, JsonObj(), false, hedge);
+        }
+
+        bool leader = false;
+        detail::Flight* flight = single_flight.join(path, leader);
+        if (leader) {
+            JsonObj data;
+            try {
+                data = request_at(ctx, false, "GET", path, JsonObj(), false, hedge);
+            } catch (...) {
+                /* Our own deadline is no reason for the followers to fail */
+                bool own_deadline = ctx.deadline_ns != 0 &&
+                                    detail::monotonic_ns() + 1000000ULL > ctx.deadline_ns;
+                single_flight.landCurrentException(flight, own_deadline);
+                throw;
+            }
+            single_flight.land(flight, data);
+            return data;
+        }
+
+        metrics.recordCoalesced(detail::MetricsRegistry::classify(path));
+        detail::SingleFlight::Outcome outcome;
+        bool landed = single_flight.wait(flight, ctx.options.cancellation, ctx.deadline_ns, outcome);
+        single_flight.leave(flight);
+        if (!landed) {
+            throw_if_cancelled(ctx);
+            attempt_timeout_ms(ctx);   /* Throws: the deadline has passed */
+        }
+        if (outcome.ok) {
+            return outcome.data;
+        }
+        if (outcome.abandoned()) {
+            return request_at(ctx, false, "GET", path, JsonObj(), false, hedge);
+        }
+        ctx.last_error = outcome.error.message;
+        outcome.error.raise();
+        return JsonObj();   /* Not reached */
+    }
+
+    JsonObj post(CallContext& ctx, const std::string& path, const JsonObj& body, bool ack = false) {
+        return request(ctx, "POST", path, body, ack);
+    }
+
+    JsonObj patch(CallContext& ctx, const std::string& path, const JsonObj& body) {
+        return request(ctx, "PATCH", path, body);
+    }
+
+    /** Feed a fetched customer to the customer cache and external id index. */
+    void remember_customer(const CustomerResult& customer, uint64_t now_ns) {
+        if (customer_cache.enabled()) customer_cache.put(customer, now_ns);
+        if (customer_index.active()) customer_index.insert(customer.external_customer_id, customer.id);
+    }
+
+    /* Defined below. */
+    CustomerResult create_customer(CallContext& ctx, const CreateCustomerParams& params);
+    struct CreateCustomersRun;
+    ListCustomersResult list_customers(CallContext& ctx, const ListCustomersOptions& options);
+    size_t refresh_customer_index(CallContext& ctx, bool from_start, bool& rescanned);
+    struct ExportPass;   /* One status pass of exportCustomers() */
+    CustomerResult fetch_customer(CallContext& ctx, const std::string& customer_id);
+    bool cached_balance(const std::string& customer_id, uint64_t now_ns, BalanceResult& out);
+    BalanceResult fetch_balance(CallContext& ctx, const std::string& customer_id);
+    struct MultiGet;     /* getCustomers() / getBalances() */
+    void refresh_id_cache(CallContext& ctx);
+
+    static void id_cache_main(void* arg) {
+        static_cast<Impl*>(arg)->id_cache_loop();
+    }
+
+    void id_cache_loop() {
+        RequestOptions options;
+        options.cancellation = &id_cache_cancel;
+        for (;;) {
+            try {
+                CallContext ctx(options, trace_hooks, "refreshIdCache");
+                refresh_id_cache(ctx);
+                ctx.root.done();
+            } catch (...) {
+                /* Readers keep the previous file; try again next interval */
+            }
+            detail::ScopedLock lock(id_cache_mutex);
+            if (!id_cache_stop) id_cache_cv.waitFor(id_cache_mutex, id_cache_refresh_ms);
+            if (id_cache_stop) {
+                id_cache_running = false;
+                id_cache_cv.notifyAll();
+                return;
+            }
+        }
     }
 
-    JsonObj patch(const std::string& path, const JsonObj& body) {
-        return request("PATCH", path, body);
+    void stop_id_cache_refresh() {
+        detail::ScopedLock lock(id_cache_mutex);
+        id_cache_stop = true;
+        id_cache_cancel.cancel();
+        id_cache_cv.notifyAll();
+        while (id_cache_running) id_cache_cv.wait(id_cache_mutex);
     }
+
+    /* Shared by the public methods and recordRun(); defined below. */
+    RunResult start_run(CallContext& ctx, const StartRunParams& params);
+    EndRunResult end_run(CallContext& ctx, const std::string& run_id, const EndRunParams& params);
 };
 
 // =============================================================================
@@ -368,55 +955,214 @@ KeyType Client::key_type() const {
     return impl_->key_type;
 }
 
+MetricsSnapshot Client::metrics() const {
+    MetricsSnapshot snap;
+    impl_->metrics.snapshot(snap);
+    return snap;
+}
+
+std::string Client::metricsText() const {
+    std::string out;
+    impl_->metrics.renderPrometheus(out);
+    return out;
+}
+
+void Client::appendMetricsText(std::string& out) const {
+    impl_->metrics.renderPrometheus(out);
+}
+
 // =============================================================================
 // createCustomer()
 // =============================================================================
 
-static CustomerResult parse_customer(const JsonObj& data) {
-    CustomerResult r;
-    r.id = json_string(data, "id");
-    r.external_customer_id = json_string(data, "externalCustomerId");
-    r.onchain_address = json_string(data, "onchainAddress");
-    r.status = json_string(data, "status");
-    r.is_internal = json_bool(data, "isInternal", false);
-    if (json_has(data, "metadata")) {
-        JsonObj::const_iterator it = data.find("metadata");
-        if (it != data.end()) {
-            r.metadata = metadata_from_json(it->second);
-        }
-    }
-    r.created_at = json_string(data, "createdAt");
-    r.updated_at = json_string(data, "updatedAt");
-    return r;
+CustomerResult Client::createCustomer(const CreateCustomerParams& params, const RequestOptions& options) {
+    CallContext ctx(options, impl_->trace_hooks, "createCustomer");
+    return ctx.done(impl_->create_customer(ctx, params));
 }
 
-CustomerResult Client::createCustomer(const CreateCustomerParams& params) {
+CustomerResult Client::Impl::create_customer(CallContext& ctx, const CreateCustomerParams& params) {
     JsonObj body;
     if (!params.external_customer_id.empty()) body["externalCustomerId"] = jstr(params.external_customer_id);
     if (!params.onchain_address.empty()) body["onchainAddress"] = jstr(params.onchain_address);
     if (!params.metadata.empty()) body["metadata"] = metadata_to_json(params.metadata);
 
-    return parse_customer(impl_->post("/customers", body));
+    CustomerResult result = parse_customer(post(ctx, "/customers", body));
+    remember_customer(result, detail::monotonic_ns());
+    return result;
+}
+
+// =============================================================================
+// createCustomers()
+// =============================================================================
+
+/* Inside a catch block: describe the exception on a per-item result. */
+template <typename Item>
+static void record_item_error(Item& item) {
+    try {
+        throw;
+    } catch (const DripError& e) {
+        item.error = e.what();
+        item.error_code = e.code();
+        item.status_code = e.status_code();
+    } catch (const std::exception& e) {
+        item.error = e.what();
+        item.error_code = "INTERNAL_ERROR";
+    } catch (...) {
+        item.error = "Unknown error";
+        item.error_code = "INTERNAL_ERROR";
+    }
+}
+
+/*
+ * Shared by the createCustomers() workers; each writes only its own item.
+ * Every item reports as a child of the createCustomers() call.
+ */
+struct Client::Impl::CreateCustomersRun {
+    Client::Impl* impl;
+    CallContext* parent;
+    const std::vector<CreateCustomerParams>* params;
+    std::vector<CreateCustomerItem>* items;
+
+    static void task(void* arg, size_t index) {
+        CreateCustomersRun& run = *static_cast<CreateCustomersRun*>(arg);
+        const CreateCustomerParams& params = (*run.params)[index];
+        CreateCustomerItem& item = (*run.items)[index];
+        try {
+            CallContext ctx(*run.parent, "createCustomer");
+            item.customer = ctx.done(run.impl->create_customer(ctx, params));
+            item.ok = true;
+            return;
+        } catch (const DripError& e) {
+            record_item_error(item);
+            if (e.status_code() != 409 || params.external_customer_id.empty()) return;
+        } catch (...) {
+            record_item_error(item);
+            return;
+        }
+        /*
+         * 409: the external id is taken, so look up the customer that holds
+         * it. One filtered list request rather than resolveCustomer(), whose
+         * index would page in every customer on a miss.
+         */
+        try {
+            CallContext ctx(*run.parent, "listCustomers");
+            ListCustomersOptions lookup;
+            lookup.external_customer_id = params.external_customer_id;
+            ListCustomersResult found = ctx.done(run.impl->list_customers(ctx, lookup));
+            for (size_t i = 0; i < found.customers.size(); ++i) {
+                if (found.customers[i].external_customer_id != params.external_customer_id) continue;
+                item = CreateCustomerItem();
+                item.customer = found.customers[i];
+                item.ok = true;
+                item.existed = true;
+                return;
+            }
+            /* Not matched (filter unsupported, or the customer is gone): the 409 stands */
+        } catch (...) {
+            record_item_error(item);
+        }
+    }
+};
+
+CreateCustomersResult Client::createCustomers(const std::vector<CreateCustomerParams>& params,
+                                              const CreateCustomersOptions& options,
+                                              const RequestOptions& request_options) {
+    RequestOptions item_options = request_options;
+    item_options.info = NULL;
+    CallContext ctx(item_options, impl_->trace_hooks, "createCustomers");
+
+    CreateCustomersResult result;
+    result.items.resize(params.size());
+    Impl::CreateCustomersRun run;
+    run.impl = impl_;
+    run.parent = &ctx;
+    run.params = &params;
+    run.items = &result.items;
+
+    detail::FanOut fan(&Impl::CreateCustomersRun::task, &run, params.size());
+    fan.start(clamp_concurrency(options.concurrency));
+    size_t index;
+    size_t completed = 0;
+    try {
+        while (fan.next(index)) {
+            const CreateCustomerItem& item = result.items[index];
+            if (!item.ok) {
+                ++result.failed;
+            } else if (item.existed) {
+                ++result.existed;
+            } else {
+                ++result.created;
+            }
+            ++completed;
+            if (options.progress) options.progress->onItem(index, item, completed, params.size());
+        }
+    } catch (const std::exception& e) {
+        ctx.last_error = e.what();
+        throw;
+    }
+    return ctx.done(result);
 }
 
 // =============================================================================
 // getCustomer()
 // =============================================================================
 
-CustomerResult Client::getCustomer(const std::string& customer_id) {
-    return parse_customer(impl_->get("/customers/" + customer_id));
+CustomerResult Client::getCustomer(const std::string& customer_id, const RequestOptions& options) {
+    CallContext ctx(options, impl_->trace_hooks, "getCustomer");
+    detail::CustomerCache& cache = impl_->customer_cache;
+    if (cache.enabled()) {
+        CustomerResult result;
+        std::string message;
+        switch (cache.get(customer_id, detail::monotonic_ns(), result, message)) {
+            case detail::CustomerCache::CACHE_HIT:
+                return ctx.done(result);
+            case detail::CustomerCache::CACHE_NOT_FOUND:
+                ctx.last_error = message;
+                throw NotFoundError(message);
+            default:
+                break;
+        }
+    }
+    return ctx.done(impl_->fetch_customer(ctx, customer_id));
+}
+
+/* getCustomer() past the cache lookup. */
+CustomerResult Client::Impl::fetch_customer(CallContext& ctx, const std::string& customer_id) {
+    CustomerResult result;
+    try {
+        result = parse_customer(get_hedged(ctx, "/customers/" + customer_id));
+    } catch (const NotFoundError& e) {
+        if (customer_cache.enabled()) customer_cache.putNotFound(customer_id, e.what(), detail::monotonic_ns());
+        throw;
+    }
+    remember_customer(result, detail::monotonic_ns());
+    return result;
+}
+
+void Client::invalidateCustomer(const std::string& customer_id) {
+    impl_->customer_cache.erase(customer_id);
 }
 
 // =============================================================================
 // listCustomers()
 // =============================================================================
 
-ListCustomersResult Client::listCustomers(const ListCustomersOptions& options) {
+ListCustomersResult Client::listCustomers(const ListCustomersOptions& options,
+                                          const RequestOptions& request_options) {
+    CallContext ctx(request_options, impl_->trace_hooks, "listCustomers");
+    return ctx.done(impl_->list_customers(ctx, options));
+}
+
+ListCustomersResult Client::Impl::list_customers(CallContext& ctx, const ListCustomersOptions& options) {
     std::ostringstream path;
     path << "/customers?limit=" << options.limit;
+    if (options.offset > 0) path << "&offset=" << options.offset;
     if (!options.status.empty()) path << "&status=" << options.status;
+    if (!options.external_customer_id.empty()) {
+        path << "&externalCustomerId=" << url_encode(options.external_customer_id);
+    }
 
-    JsonObj data = impl_->get(path.str());
+    JsonObj data = get(ctx, path.str());
 
     ListCustomersResult result;
     result.total = json_int(data, "count", 0);
@@ -427,84 +1173,817 @@ ListCustomersResult Client::listCustomers(const ListCustomersOptions& options) {
             result.customers.push_back(parse_customer(arr[i].get<JsonObj>()));
         }
     }
+    uint64_t now = detail::monotonic_ns();
+    for (size_t i = 0; i < result.customers.size(); ++i) {
+        remember_customer(result.customers[i], now);
+    }
+    return result;
+}
+
+// =============================================================================
+// CustomerIterator
+// =============================================================================
+
+struct CustomerIterator::Impl {
+    Client::Impl* client;
+    CustomerIteratorOptions options;
+    RequestOptions request_options;   /* As given; used on the calling thread */
+    RequestOptions worker_options;    /* No info; cancelled by `stop` */
+    CancellationToken stop;
+
+    detail::Mutex mutex;
+    detail::CondVar changed;
+    std::deque<std::vector<CustomerResult> > ready;   /* Prefetched pages */
+    int next_offset;         /* Offset of the next page to request */
+    bool exhausted;          /* A short page was read: nothing left to request */
+    bool worker_running;
+    bool worker_started;
+    detail::CapturedError error;   /* Failure of the last page request */
+    int total;
+    int pages;
+
+    std::vector<CustomerResult> current;
+    size_t position;
+
+    Impl(Client::Impl* c, const CustomerIteratorOptions& opts, const RequestOptions& ropts)
+        : client(c)
+        , options(opts)
+        , request_options(ropts)
+        , worker_options(ropts)
+        , next_offset(opts.offset > 0 ? opts.offset : 0)
+        , exhausted(false)
+        , worker_running(false)
+        , worker_started(false)
+        , total(0)
+        , pages(0)
+        , position(0)
+    {
+        if (options.page_size < 1 || options.page_size > 100) options.page_size = 100;
+        if (options.prefetch_pages < 0) options.prefetch_pages = 0;
+        worker_options.info = NULL;
+        worker_options.cancellation = &stop;
+    }
+
+    /* One page at `offset`; stores nothing. */
+    ListCustomersResult fetch(const RequestOptions& ropts, int offset) {
+        CallContext ctx(ropts, client->trace_hooks, "listCustomers");
+        ListCustomersOptions page;
+        page.limit = options.page_size;
+        page.offset = offset;
+        page.status = options.status;
+        return ctx.done(client->list_customers(ctx, page));
+    }
+
+    /* Record a fetched page; mutex held. */
+    void accept(const ListCustomersResult& page) {
+        next_offset += static_cast<int>(page.customers.size());
+        total = page.total;
+        ++pages;
+        /* The total also ends the walk should the API not honour the offset */
+        if (page.customers.size() < static_cast<size_t>(options.page_size) || next_offset >= total) {
+            exhausted = true;
+        }
+    }
+
+    static void workerMain(void* arg) {
+        static_cast<CustomerIterator::Impl*>(arg)->workerLoop();
+    }
+
+    void workerLoop() {
+        detail::ScopedLock lock(mutex);
+        while (!exhausted && !stop.isCancelled()) {
+            if (ready.size() >= static_cast<size_t>(options.prefetch_pages)) {
+                changed.wait(mutex);
+                continue;
+            }
+            int offset = next_offset;
+            ListCustomersResult page;
+            mutex.unlock();
+            try {
+                page = fetch(worker_options, offset);
+            } catch (...) {
+                mutex.lock();
+                if (!stop.isCancelled()) error.captureCurrent();
+                exhausted = true;
+                break;
+            }
+            mutex.lock();
+            accept(page);
+            ready.push_back(std::vector<CustomerResult>());
+            ready.back().swap(page.customers);
+            changed.notifyAll();
+        }
+        worker_running = false;
+        changed.notifyAll();
+    }
+
+    /* Refill `current` from the prefetch queue; false at the end. Throws a page failure. */
+    bool takePrefetched() {
+        static const int CANCEL_POLL_MS = 20;
+        detail::CapturedError failure;
+        {
+            detail::ScopedLock lock(mutex);
+            if (!worker_started) {
+                worker_started = true;
+                worker_running = detail::start_detached_thread(&Impl::workerMain, this);
+            }
+            while (ready.empty() && worker_running) {
+                if (request_options.cancellation && request_options.cancellation->isCancelled()) {
+                    throw CancelledError("Request cancelled");
+                }
+                if (request_options.cancellation) {
+                    changed.waitFor(mutex, CANCEL_POLL_MS);
+                } else {
+                    changed.wait(mutex);
+                }
+            }
+            if (!ready.empty()) {
+                current.swap(ready.front());
+                ready.pop_front();
+                position = 0;
+                changed.notifyAll();
+                return true;
+            }
+            if (!exhausted) {
+                /* No thread could be started: carry on without prefetching */
+                options.prefetch_pages = 0;
+            }
+            failure = error;
+            error = detail::CapturedError();
+        }
+        if (options.prefetch_pages == 0) return fetchInline();
+        failure.raise();
+        return false;
+    }
+
+    /* Synchronous refill, used without prefetching or when no thread could be started. */
+    bool fetchInline() {
+        if (exhausted) return false;
+        ListCustomersResult page;
+        try {
+            page = fetch(request_options, next_offset);
+        } catch (...) {
+            exhausted = true;
+            throw;
+        }
+        detail::ScopedLock lock(mutex);
+        accept(page);
+        current.swap(page.customers);
+        position = 0;
+        return !current.empty();
+    }
+};
+
+CustomerIterator::CustomerIterator(Client& client, const CustomerIteratorOptions& options,
+                                   const RequestOptions& request_options)
+    : impl_(new Impl(client.impl_, options, request_options))
+{}
+
+CustomerIterator::~CustomerIterator() {
+    {
+        detail::ScopedLock lock(impl_->mutex);
+        impl_->stop.cancel();
+        impl_->changed.notifyAll();
+        while (impl_->worker_running) impl_->changed.wait(impl_->mutex);
+    }
+    delete impl_;
+}
+
+bool CustomerIterator::next(CustomerResult& out) {
+    Impl& it = *impl_;
+    while (it.position >= it.current.size()) {
+        bool more = it.options.prefetch_pages > 0 ? it.takePrefetched() : it.fetchInline();
+        if (!more) return false;
+    }
+    out = it.current[it.position++];
+    return true;
+}
+
+int CustomerIterator::total() const {
+    detail::ScopedLock lock(impl_->mutex);
+    return impl_->total;
+}
+
+int CustomerIterator::pagesFetched() const {
+    detail::ScopedLock lock(impl_->mutex);
+    return impl_->pages;
+}
+
+// =============================================================================
+// exportCustomers()
+// =============================================================================
+
+/*
+ * One status pass of exportCustomers(). Page 0 is read on the calling
+ * thread to learn the total; worker threads then claim pages 1..last_page
+ * by index, at most `window` pages past the one the sink needs next, and
+ * the calling thread hands finished pages to the sink in order.
+ */
+struct Client::Impl::ExportPass {
+    Client::Impl* client;
+    const RequestOptions& request_options;   /* Used on the calling thread */
+    RequestOptions worker_options;           /* Cancelled by `stop` */
+    CancellationToken stop;
+    int page_size;
+    std::string status;
+    int last_page;           /* Per the first page's count */
+    int window;
+
+    detail::Mutex mutex;
+    detail::CondVar changed;
+    int next_page;           /* Next page index for a worker to claim */
+    int wanted;              /* Page index the sink needs next */
+    int running;             /* Worker threads alive */
+    int worker_pages;        /* Requests made by workers */
+    std::map<int, std::vector<CustomerResult> > fetched;
+    detail::CapturedError failure;   /* First worker failure */
+
+    ExportPass(Client::Impl* c, const RequestOptions& ropts, int size, const std::string& s)
+        : client(c)
+        , request_options(ropts)
+        , worker_options(ropts)
+        , page_size(size)
+        , status(s)
+        , last_page(0)
+        , window(1)
+        , next_page(1)
+        , wanted(1)
+        , running(0)
+        , worker_pages(0)
+    {
+        worker_options.cancellation = &stop;
+    }
+
+    ListCustomersResult fetch(const RequestOptions& ropts, int index) {
+        CallContext ctx(ropts, client->trace_hooks, "listCustomers");
+        ListCustomersOptions page;
+        page.limit = page_size;
+        page.offset = index * page_size;
+        page.status = status;
+        return ctx.done(client->list_customers(ctx, page));
+    }
+
+    static void workerMain(void* arg) {
+        static_cast<ExportPass*>(arg)->workerLoop();
+    }
+
+    void workerLoop() {
+        detail::ScopedLock lock(mutex);
+        while (!stop.isCancelled() && next_page <= last_page) {
+            if (next_page >= wanted + window) {
+                changed.wait(mutex);
+                continue;
+            }
+            int index = next_page++;
+            ListCustomersResult page;
+            mutex.unlock();
+            try {
+                page = fetch(worker_options, index);
+            } catch (...) {
+                mutex.lock();
+                if (!stop.isCancelled()) failure.captureCurrent();
+                stop.cancel();
+                break;
+            }
+            mutex.lock();
+            ++worker_pages;
+            fetched[index].swap(page.customers);
+            changed.notifyAll();
+        }
+        --running;
+        changed.notifyAll();
+    }
+
+    /* Stream the pass to @p sink; always stops the workers before returning. */
+    void run(CustomerSink& sink, int concurrency, ExportCustomersResult& result) {
+        ListCustomersResult first = fetch(request_options, 0);
+        ++result.pages;
+        last_page = first.total > 0 ? (first.total - 1) / page_size : 0;
+        window = 2 * concurrency;
+        {
+            detail::ScopedLock lock(mutex);
+            int threads = last_page < concurrency ? last_page : concurrency;
+            for (int i = 0; i < threads; ++i) {
+                /* Fewer threads than asked for only means less overlap */
+                if (!detail::start_detached_thread(&ExportPass::workerMain, this)) break;
+                ++running;
+            }
+        }
+        try {
+            std::vector<CustomerResult> page;
+            page.swap(first.customers);
+            for (int index = 1; ; ++index) {
+                for (size_t i = 0; i < page.size(); ++i) sink.onCustomer(page[i]);
+                result.customers += static_cast<int64_t>(page.size());
+                if (page.size() < static_cast<size_t>(page_size)) break;
+                if (index <= last_page) {
+                    take(index, page, result);
+                } else {
+                    /* Created since the first page: read on until a short page */
+                    ListCustomersResult more = fetch(request_options, index);
+                    ++result.pages;
+                    page.swap(more.customers);
+                }
+            }
+        } catch (...) {
+            finish(result);
+            throw;
+        }
+        finish(result);
+    }
+
+    /* Wait for page @p index, or fetch it here if no worker is left to. Throws a page failure. */
+    void take(int index, std::vector<CustomerResult>& out, ExportCustomersResult& result) {
+        static const int CANCEL_POLL_MS = 20;
+        const CancellationToken* cancellation = request_options.cancellation;
+        detail::ScopedLock lock(mutex);
+        wanted = index;
+        changed.notifyAll();
+        for (;;) {
+            std::map<int, std::vector<CustomerResult> >::iterator it = fetched.find(index);
+            if (it != fetched.end()) {
+                out.swap(it->second);
+                fetched.erase(it);
+                return;
+            }
+            if (failure.kind != detail::CapturedError::NONE) failure.raise();
+            if (running == 0) break;
+            if (cancellation && cancellation->isCancelled()) {
+                throw CancelledError("Request cancelled");
+            }
+            if (cancellation) {
+                changed.waitFor(mutex, CANCEL_POLL_MS);
+            } else {
+                changed.wait(mutex);
+            }
+        }
+        /* Workers claim pages in order, so none holds a claim on this one */
+        if (next_page <= index) next_page = index + 1;
+        mutex.unlock();
+        ListCustomersResult page;
+        try {
+            page = fetch(request_options, index);
+        } catch (...) {
+            mutex.lock();
+            throw;
+        }
+        mutex.lock();
+        ++result.pages;
+        out.swap(page.customers);
+    }
+
+    void finish(ExportCustomersResult& result) {
+        detail::ScopedLock lock(mutex);
+        stop.cancel();
+        changed.notifyAll();
+        while (running > 0) changed.wait(mutex);
+        result.pages += worker_pages;
+        worker_pages = 0;
+        fetched.clear();
+    }
+};
+
+ExportCustomersResult Client::exportCustomers(CustomerSink& sink, const ExportCustomersOptions& options,
+                                              const RequestOptions& request_options) {
+    RequestOptions page_options = request_options;
+    page_options.info = NULL;
+    CallContext ctx(page_options, impl_->trace_hooks, "exportCustomers");
+
+    int page_size = options.page_size >= 1 && options.page_size <= 100 ? options.page_size : 100;
+    int concurrency = clamp_concurrency(options.concurrency);
+    std::vector<std::string> statuses = options.statuses;
+    if (statuses.empty()) statuses.push_back(std::string());
+
+    ExportCustomersResult result;
+    uint64_t start = detail::monotonic_ns();
+    try {
+        for (size_t i = 0; i < statuses.size(); ++i) {
+            Impl::ExportPass pass(impl_, page_options, page_size, statuses[i]);
+            pass.run(sink, concurrency, result);
+        }
+    } catch (const std::exception& e) {
+        ctx.last_error = e.what();
+        throw;
+    }
+
+    uint64_t elapsed_ns = detail::monotonic_ns() - start;
+    result.elapsed_ms = static_cast<int64_t>(elapsed_ns / 1000000ULL);
+    if (elapsed_ns > 0) {
+        double seconds = static_cast<double>(elapsed_ns) / 1e9;
+        result.pages_per_second = result.pages / seconds;
+        result.customers_per_second = static_cast<double>(result.customers) / seconds;
+    }
+    return ctx.done(result);
+}
+
+/* exportCustomersToFile(): one customer object per line */
+class NdjsonFileSink : public CustomerSink {
+public:
+    NdjsonFileSink(std::FILE* file, const std::string& path) : file_(file), path_(path) {}
+
+    void onCustomer(const CustomerResult& customer) {
+        std::string line = JsonVal(detail::customer_to_json(customer)).serialize();
+        line += '\n';
+        if (std::fwrite(line.data(), 1, line.size(), file_) != line.size()) {
+            throw DripError("Failed to write " + path_ + ": " + std::strerror(errno), 0, "IO_ERROR");
+        }
+    }
+
+private:
+    std::FILE* file_;
+    std::string path_;
+};
+
+ExportCustomersResult Client::exportCustomersToFile(const std::string& ndjson_path,
+                                                    const ExportCustomersOptions& options,
+                                                    const RequestOptions& request_options) {
+    std::FILE* file = std::fopen(ndjson_path.c_str(), "wb");
+    if (!file) {
+        throw DripError("Failed to open " + ndjson_path + ": " + std::strerror(errno), 0, "IO_ERROR");
+    }
+    NdjsonFileSink sink(file, ndjson_path);
+    ExportCustomersResult result;
+    try {
+        result = exportCustomers(sink, options, request_options);
+    } catch (...) {
+        std::fclose(file);
+        throw;
+    }
+    if (std::fclose(file) != 0) {
+        throw DripError("Failed to write " + ndjson_path + ": " + std::strerror(errno), 0, "IO_ERROR");
+    }
     return result;
 }
 
+// =============================================================================
+// resolveCustomer() / warmCustomerIndex()
+// =============================================================================
+
+/*
+ * Page the unfiltered customer list from where the last refresh stopped
+ * (or from the start) until the reported total. Where the API lists
+ * customers in creation order, the pages past listOffset() hold exactly
+ * the customers created since. If the total does not match the offset
+ * reached (customers were removed, or the offset was not honoured), the
+ * list is read again from the start. Caller holds
+ * customer_index.refreshMutex(). Returns customers read; @p rescanned is
+ * set if the whole list was read.
+ */
+size_t Client::Impl::refresh_customer_index(CallContext& ctx, bool from_start, bool& rescanned) {
+    ListCustomersOptions page;
+    page.offset = from_start ? 0 : customer_index.listOffset();
+    rescanned = page.offset == 0;
+    size_t read = 0;
+    for (;;) {
+        ListCustomersResult result = list_customers(ctx, page);
+        size_t n = result.customers.size();
+        read += n;
+        page.offset += static_cast<int>(n);
+        if (n == static_cast<size_t>(page.limit) && page.offset < result.total) {
+            customer_index.setListOffset(page.offset);
+            continue;
+        }
+        if (page.offset == result.total || rescanned) {
+            customer_index.setListOffset(result.total);
+            return read;
+        }
+        page.offset = 0;
+        rescanned = true;
+    }
+}
+
+std::string Client::resolveCustomer(const std::string& external_customer_id,
+                                    const RequestOptions& options) {
+    CallContext ctx(options, impl_->trace_hooks, "resolveCustomer");
+    detail::CustomerIndex& index = impl_->customer_index;
+    index.activate();
+
+    std::string customer_id;
+    if (index.find(external_customer_id, customer_id)) {
+        return ctx.done(customer_id);
+    }
+    detail::IdCacheFile& file = impl_->id_cache;
+    if (file.enabled() && file.findCustomer(external_customer_id, customer_id)) {
+        return ctx.done(customer_id);
+    }
+
+    detail::ScopedLock lock(index.refreshMutex());
+    /* A concurrent miss may have refreshed while we waited for the lock. */
+    if (!index.peek(external_customer_id, customer_id)) {
+        /* Customers listed before the file was written are in the file */
+        if (file.enabled() && file.listOffset() > index.listOffset()) index.setListOffset(file.listOffset());
+        bool rescanned;
+        size_t read = impl_->refresh_customer_index(ctx, false, rescanned);
+        /*
+         * New customers that did not include this one: if the list is not
+         * in creation order they may have been the wrong ones, so look
+         * through all of it before giving up.
+         */
+        if (!index.peek(external_customer_id, customer_id) && read > 0 && !rescanned) {
+            impl_->refresh_customer_index(ctx, true, rescanned);
+        }
+        if (!index.peek(external_customer_id, customer_id)) {
+            ctx.last_error = "No customer with external id " + external_customer_id;
+            throw NotFoundError(ctx.last_error);
+        }
+    }
+    return ctx.done(customer_id);
+}
+
+size_t Client::warmCustomerIndex(const RequestOptions& options) {
+    CallContext ctx(options, impl_->trace_hooks, "warmCustomerIndex");
+    detail::CustomerIndex& index = impl_->customer_index;
+    index.activate();
+
+    detail::ScopedLock lock(index.refreshMutex());
+    bool rescanned;
+    impl_->refresh_customer_index(ctx, false, rescanned);
+    return ctx.done(index.size());
+}
+
+// =============================================================================
+// refreshIdCache()
+// =============================================================================
+
+/*
+ * Rewrite the Config::id_cache file: every workflow from GET /workflows,
+ * and the customer index after reading the customers created since the
+ * file was last written (seeded from the file on the first refresh).
+ */
+void Client::Impl::refresh_id_cache(CallContext& ctx) {
+    detail::IdCacheFile::Entries workflows;
+    JsonArr arr = json_arr(get(ctx, "/workflows"), "data");
+    for (size_t i = 0; i < arr.size(); ++i) {
+        if (!arr[i].is<JsonObj>()) continue;
+        const JsonObj& w = arr[i].get<JsonObj>();
+        std::string slug = json_string(w, "slug");
+        if (slug.empty()) continue;
+        workflows.push_back(std::make_pair(slug, json_string(w, "id") + "\t" + json_string(w, "name")));
+    }
+
+    detail::IdCacheFile::Entries customers;
+    int list_offset;
+    {
+        detail::ScopedLock lock(customer_index.refreshMutex());
+        customer_index.activate();
+        if (!id_cache_seeded) {
+            detail::IdCacheFile::Entries known;
+            id_cache.customers(known);
+            for (size_t i = 0; i < known.size(); ++i) customer_index.insert(known[i].first, known[i].second);
+            if (id_cache.listOffset() > customer_index.listOffset()) {
+                customer_index.setListOffset(id_cache.listOffset());
+            }
+            id_cache_seeded = true;
+        }
+        bool rescanned;
+        refresh_customer_index(ctx, false, rescanned);
+        customer_index.entries(customers);
+        list_offset = customer_index.listOffset();
+    }
+
+    std::string error;
+    if (!id_cache.write(workflows, customers, list_offset, error)) {
+        ctx.last_error = error;
+        throw DripError(error, 0, "IO_ERROR");
+    }
+}
+
+void Client::refreshIdCache(const RequestOptions& options) {
+    if (!impl_->id_cache.enabled()) return;
+    CallContext ctx(options, impl_->trace_hooks, "refreshIdCache");
+    impl_->refresh_id_cache(ctx);
+    ctx.root.done();
+}
+
 // =============================================================================
 // getBalance()
 // =============================================================================
 
-BalanceResult Client::getBalance(const std::string& customer_id) {
-    JsonObj data = impl_->get("/customers/" + customer_id + "/balance");
+BalanceResult Client::getBalance(const std::string& customer_id, const RequestOptions& options) {
+    CallContext ctx(options, impl_->trace_hooks, "getBalance");
+    BalanceResult cached;
+    if (impl_->cached_balance(customer_id, detail::monotonic_ns(), cached)) return ctx.done(cached);
+    return ctx.done(impl_->fetch_balance(ctx, customer_id));
+}
+
+/* An estimate from Config::balance_cache; false on a miss or without the cache. */
+bool Client::Impl::cached_balance(const std::string& customer_id, uint64_t now_ns, BalanceResult& out) {
+    int64_t micros = 0;
+    uint64_t age_ns = 0;
+    if (!balance_cache.enabled() || !balance_cache.get(customer_id, now_ns, micros, age_ns)) return false;
+    out.customer_id = customer_id;
+    out.balance_usdc = detail::format_usdc_micros(micros);
+    out.estimated = true;
+    out.age_ms = static_cast<int64_t>(age_ns / 1000000ULL);
+    return true;
+}
+
+/* getBalance() past the cache lookup. */
+BalanceResult Client::Impl::fetch_balance(CallContext& ctx, const std::string& customer_id) {
+    detail::BalanceCache::Mark mark;
+    if (balance_cache.enabled()) mark = balance_cache.beginFetch(customer_id, detail::monotonic_ns());
+
+    JsonObj data = get_hedged(ctx, "/customers/" + customer_id + "/balance");
 
     BalanceResult r;
     r.customer_id = json_string(data, "customerId");
     r.balance_usdc = json_string(data, "balanceUsdc");
+    int64_t micros = 0;
+    if (balance_cache.enabled() && detail::parse_usdc_micros(r.balance_usdc, micros)) {
+        balance_cache.put(customer_id, micros, mark);
+    }
     return r;
 }
 
 // =============================================================================
-// ping()
+// getCustomers() / getBalances()
 // =============================================================================
 
-PingResult Client::ping() {
-    std::string health_url = impl_->base_url;
+/*
+ * One multi-get. Repeated ids are looked up once; the calling thread
+ * answers what it can from the caches and the rest is fetched on a
+ * FanOut, each worker writing only its own lookup. Every fetch reports
+ * as a child of the getCustomers() / getBalances() call.
+ */
+struct Client::Impl::MultiGet {
+    Client::Impl* impl;
+    CallContext& parent;
+    std::vector<std::string> ids;    /* Unique, in first-seen order */
+    std::vector<size_t> slots;       /* Input position -> index into ids */
+    std::vector<size_t> pending;     /* Indices into ids still to fetch */
+    std::vector<CustomerLookup> customers;
+    std::vector<BalanceLookup> balances;
+
+    MultiGet(Client::Impl* i, CallContext& p, const std::vector<std::string>& input)
+        : impl(i)
+        , parent(p)
+    {
+        std::map<std::string, size_t> seen;
+        slots.reserve(input.size());
+        for (size_t n = 0; n < input.size(); ++n) {
+            std::pair<std::map<std::string, size_t>::iterator, bool> ins =
+                seen.insert(std::make_pair(input[n], ids.size()));
+            if (ins.second) ids.push_back(input[n]);
+            slots.push_back(ins.first->second);
+        }
+    }
+
+    static void customerTask(void* arg, size_t index) {
+        MultiGet& run = *static_cast<MultiGet*>(arg);
+        CustomerLookup& lookup = run.customers[run.pending[index]];
+        try {
+            CallContext ctx(run.parent, "getCustomer");
+            lookup.customer = ctx.done(run.impl->fetch_customer(ctx, lookup.customer_id));
+            lookup.ok = true;
+        } catch (...) {
+            record_item_error(lookup);
+        }
+    }
+
+    static void balanceTask(void* arg, size_t index) {
+        MultiGet& run = *static_cast<MultiGet*>(arg);
+        BalanceLookup& lookup = run.balances[run.pending[index]];
+        try {
+            CallContext ctx(run.parent, "getBalance");
+            lookup.balance = ctx.done(run.impl->fetch_balance(ctx, lookup.customer_id));
+            lookup.ok = true;
+        } catch (...) {
+            record_item_error(lookup);
+        }
+    }
 
-    std::string suffix = "/v1";
-    if (health_url.size() >= suffix.size() &&
-        health_url.compare(health_url.size() - suffix.size(), suffix.size(), suffix) == 0) {
-        health_url.erase(health_url.size() - suffix.size());
+    void fetchPending(detail::FanOut::Task task, int concurrency) {
+        detail::FanOut fan(task, this, pending.size());
+        /* A single fetch runs on the calling thread */
+        fan.start(pending.size() > 1 ? concurrency : 0);
+        size_t index;
+        while (fan.next(index)) {}
     }
 
+    /* Results by input position. */
+    template <typename Lookup>
+    std::vector<Lookup> inInputOrder(const std::vector<Lookup>& unique) const {
+        std::vector<Lookup> out;
+        out.reserve(slots.size());
+        for (size_t n = 0; n < slots.size(); ++n) out.push_back(unique[slots[n]]);
+        return out;
+    }
+};
+
+std::vector<CustomerLookup> Client::getCustomers(const std::vector<std::string>& customer_ids,
+                                                 const MultiGetOptions& options,
+                                                 const RequestOptions& request_options) {
+    RequestOptions item_options = request_options;
+    item_options.info = NULL;
+    CallContext ctx(item_options, impl_->trace_hooks, "getCustomers");
+
+    Impl::MultiGet run(impl_, ctx, customer_ids);
+    run.customers.resize(run.ids.size());
+    detail::CustomerCache& cache = impl_->customer_cache;
+    uint64_t now = detail::monotonic_ns();
+    for (size_t i = 0; i < run.ids.size(); ++i) {
+        CustomerLookup& lookup = run.customers[i];
+        lookup.customer_id = run.ids[i];
+        std::string message;
+        switch (cache.enabled() ? cache.get(lookup.customer_id, now, lookup.customer, message)
+                                : detail::CustomerCache::CACHE_MISS) {
+            case detail::CustomerCache::CACHE_HIT:
+                lookup.ok = true;
+                break;
+            case detail::CustomerCache::CACHE_NOT_FOUND:
+                lookup.error = message;
+                lookup.error_code = "NOT_FOUND";
+                lookup.status_code = 404;
+                break;
+            default:
+                run.pending.push_back(i);
+                break;
+        }
+    }
+    run.fetchPending(&Impl::MultiGet::customerTask, clamp_concurrency(options.concurrency));
+    return ctx.done(run.inInputOrder(run.customers));
+}
+
+std::vector<BalanceLookup> Client::getBalances(const std::vector<std::string>& customer_ids,
+                                               const MultiGetOptions& options,
+                                               const RequestOptions& request_options) {
+    RequestOptions item_options = request_options;
+    item_options.info = NULL;
+    CallContext ctx(item_options, impl_->trace_hooks, "getBalances");
+
+    Impl::MultiGet run(impl_, ctx, customer_ids);
+    run.balances.resize(run.ids.size());
+    uint64_t now = detail::monotonic_ns();
+    for (size_t i = 0; i < run.ids.size(); ++i) {
+        BalanceLookup& lookup = run.balances[i];
+        lookup.customer_id = run.ids[i];
+        if (impl_->cached_balance(lookup.customer_id, now, lookup.balance)) {
+            lookup.ok = true;
+        } else {
+            run.pending.push_back(i);
+        }
+    }
+    run.fetchPending(&Impl::MultiGet::balanceTask, clamp_concurrency(options.concurrency));
+    return ctx.done(run.inInputOrder(run.balances));
+}
+
+// =============================================================================
+// ping()
+// =============================================================================
+
+PingResult Client::ping(const RequestOptions& options) {
+    CallContext ctx(options, impl_->trace_hooks, "ping");
     long long start = now_ms();
 
-    std::string saved_base = impl_->base_url;
-    impl_->base_url = health_url;
+    JsonObj data = impl_->request_at(ctx, true, "GET", "/health", JsonObj(), false, true);
+    long long end = now_ms();
 
     PingResult result;
-    try {
-        JsonObj data = impl_->get("/health");
-        long long end = now_ms();
-
-        result.latency_ms = static_cast<int>(end - start);
-        result.status = json_string(data, "status");
-        if (result.status.empty()) result.status = "healthy";
-        result.ok = (result.status == "healthy");
-        result.timestamp = static_cast<int64_t>(
-            json_double(data, "timestamp", static_cast<double>(std::time(NULL) * 1000))
-        );
-    } catch (...) {
-        impl_->base_url = saved_base;
-        throw;
-    }
+    result.latency_ms = static_cast<int>(end - start);
+    result.status = json_string(data, "status");
+    if (result.status.empty()) result.status = "healthy";
+    result.ok = (result.status == "healthy");
+    result.timestamp = static_cast<int64_t>(
+        json_double(data, "timestamp", static_cast<double>(std::time(NULL) * 1000))
+    );
+    return ctx.done(result);
+}
 
-    impl_->base_url = saved_base;
-    return result;
+// =============================================================================
+// health()
+// =============================================================================
+
+HealthSnapshot Client::health() const {
+    uint64_t now = detail::monotonic_ns();
+    HealthSnapshot snap;
+    impl_->upstreams.health(impl_->upstreams.pick(0, now), now, snap);
+    return snap;
 }
 
 // =============================================================================
 // trackUsage()
 // =============================================================================
 
-TrackUsageResult Client::trackUsage(const TrackUsageParams& params) {
-    std::string idem_key = params.idempotency_key;
-    if (idem_key.empty()) {
-        idem_key = make_idempotency_key("track", params.customer_id, params.meter, params.quantity);
+TrackUsageResult Client::trackUsage(const TrackUsageParams& params, const RequestOptions& options) {
+    CallContext ctx(options, impl_->trace_hooks, "trackUsage");
+    JsonObj body = track_usage_body(params);
+    /* Debited before sending: a failed call only makes the estimate low */
+    if (impl_->balance_cache.enabled()) {
+        impl_->balance_cache.debit(params.customer_id, params.meter, params.quantity);
     }
 
-    JsonObj body;
-    body["customerId"] = jstr(params.customer_id);
-    body["usageType"] = jstr(params.meter);
-    body["quantity"] = jnum(params.quantity);
-    body["idempotencyKey"] = jstr(idem_key);
-
-    if (!params.units.empty()) body["units"] = jstr(params.units);
-    if (!params.description.empty()) body["description"] = jstr(params.description);
-    if (!params.metadata.empty()) body["metadata"] = metadata_to_json(params.metadata);
-
-    JsonObj data = impl_->post("/usage/internal", body);
+    bool ack = impl_->ack_only || options.ack_only;
+    JsonObj data = impl_->post(ctx, "/usage/internal", body, ack);
 
     TrackUsageResult r;
+    if (ack) {
+        r.success = true;
+        r.customer_id = params.customer_id;
+        r.usage_type = params.meter;
+        r.quantity = params.quantity;
+        return ctx.done(r);
+    }
+
     r.success = json_bool(data, "success", true);
     r.usage_event_id = json_string(data, "usageEventId");
     r.customer_id = json_string(data, "customerId");
@@ -512,14 +1991,19 @@ TrackUsageResult Client::trackUsage(const TrackUsageParams& params) {
     r.quantity = json_double(data, "quantity", params.quantity);
     r.is_internal = json_bool(data, "isInternal", false);
     r.message = json_string(data, "message");
-    return r;
+    return ctx.done(r);
 }
 
 // =============================================================================
 // Run methods
 // =============================================================================
 
-RunResult Client::startRun(const StartRunParams& params) {
+RunResult Client::startRun(const StartRunParams& params, const RequestOptions& options) {
+    CallContext ctx(options, impl_->trace_hooks, "startRun");
+    return ctx.done(impl_->start_run(ctx, params));
+}
+
+RunResult Client::Impl::start_run(CallContext& ctx, const StartRunParams& params) {
     JsonObj body;
     body["customerId"] = jstr(params.customer_id);
     body["workflowId"] = jstr(params.workflow_id);
@@ -529,7 +2013,7 @@ RunResult Client::startRun(const StartRunParams& params) {
     if (!params.parent_run_id.empty()) body["parentRunId"] = jstr(params.parent_run_id);
     if (!params.metadata.empty()) body["metadata"] = metadata_to_json(params.metadata);
 
-    JsonObj data = impl_->post("/runs", body);
+    JsonObj data = post(ctx, "/runs", body);
 
     RunResult r;
     r.id = json_string(data, "id");
@@ -542,7 +2026,13 @@ RunResult Client::startRun(const StartRunParams& params) {
     return r;
 }
 
-EndRunResult Client::endRun(const std::string& run_id, const EndRunParams& params) {
+EndRunResult Client::endRun(const std::string& run_id, const EndRunParams& params,
+                            const RequestOptions& options) {
+    CallContext ctx(options, impl_->trace_hooks, "endRun");
+    return ctx.done(impl_->end_run(ctx, run_id, params));
+}
+
+EndRunResult Client::Impl::end_run(CallContext& ctx, const std::string& run_id, const EndRunParams& params) {
     JsonObj body;
     body["status"] = jstr(run_status_to_string(params.status));
 
@@ -550,7 +2040,7 @@ EndRunResult Client::endRun(const std::string& run_id, const EndRunParams& param
     if (!params.error_code.empty()) body["errorCode"] = jstr(params.error_code);
     if (!params.metadata.empty()) body["metadata"] = metadata_to_json(params.metadata);
 
-    JsonObj data = impl_->patch("/runs/" + run_id, body);
+    JsonObj data = patch(ctx, "/runs/" + run_id, body);
 
     EndRunResult r;
     r.id = json_string(data, "id");
@@ -562,26 +2052,22 @@ EndRunResult Client::endRun(const std::string& run_id, const EndRunParams& param
     return r;
 }
 
-EventResult Client::emitEvent(const EmitEventParams& params) {
-    std::string idem_key = params.idempotency_key;
-    if (idem_key.empty()) {
-        idem_key = make_idempotency_key("evt", params.run_id, params.event_type, params.quantity);
-    }
-
-    JsonObj body;
-    body["runId"] = jstr(params.run_id);
-    body["eventType"] = jstr(params.event_type);
-    body["idempotencyKey"] = jstr(idem_key);
-
-    if (params.quantity != 0) body["quantity"] = jnum(params.quantity);
-    if (!params.units.empty()) body["units"] = jstr(params.units);
-    if (!params.description.empty()) body["description"] = jstr(params.description);
-    if (params.cost_units != 0) body["costUnits"] = jnum(params.cost_units);
-    if (!params.metadata.empty()) body["metadata"] = metadata_to_json(params.metadata);
+EventResult Client::emitEvent(const EmitEventParams& params, const RequestOptions& options) {
+    CallContext ctx(options, impl_->trace_hooks, "emitEvent");
+    JsonObj body = emit_event_body(params);
 
-    JsonObj data = impl_->post("/run-events", body);
+    bool ack = impl_->ack_only || options.ack_only;
+    JsonObj data = impl_->post(ctx, "/run-events", body, ack);
 
     EventResult r;
+    if (ack) {
+        r.run_id = params.run_id;
+        r.event_type = params.event_type;
+        r.quantity = params.quantity;
+        r.cost_units = params.cost_units;
+        return ctx.done(r);
+    }
+
     r.id = json_string(data, "id");
     r.run_id = json_string(data, "runId");
     r.event_type = json_string(data, "eventType");
@@ -589,23 +2075,28 @@ EventResult Client::emitEvent(const EmitEventParams& params) {
     r.cost_units = json_double(data, "costUnits", 0);
     r.is_duplicate = json_bool(data, "isDuplicate", false);
     r.timestamp = json_string(data, "timestamp");
-    return r;
+    return ctx.done(r);
 }
 
 // =============================================================================
 // recordRun() - all-in-one
 // =============================================================================
 
-RecordRunResult Client::recordRun(const RecordRunParams& params) {
+RecordRunResult Client::recordRun(const RecordRunParams& params, const RequestOptions& options) {
+    CallContext ctx(options, impl_->trace_hooks, "recordRun");
     long long start_time = now_ms();
 
     /* Step 1: Resolve workflow (find or create) */
     std::string workflow_id = params.workflow;
     std::string workflow_name = params.workflow;
 
-    if (params.workflow.substr(0, 3) != "wf_") {
+    /* Config::id_cache answers known slugs without listing workflows */
+    detail::IdCacheFile& id_cache = impl_->id_cache;
+    if (params.workflow.substr(0, 3) != "wf_" &&
+        !(id_cache.enabled() && id_cache.findWorkflow(params.workflow, workflow_id, workflow_name))) {
+        OperationScope step(ctx, "recordRun.resolveWorkflow");
         try {
-            JsonObj workflows = impl_->get("/workflows");
+            JsonObj workflows = impl_->get(ctx, "/workflows");
             bool found = false;
 
             JsonArr arr = json_arr(workflows, "data");
@@ -642,10 +2133,11 @@ RecordRunResult Client::recordRun(const RecordRunParams& params) {
                 create_body["slug"] = jstr(params.workflow);
                 create_body["productSurface"] = jstr("CUSTOM");
 
-                JsonObj created = impl_->post("/workflows", create_body);
+                JsonObj created = impl_->post(ctx, "/workflows", create_body);
                 workflow_id = json_string(created, "id");
                 workflow_name = json_string(created, "name");
             }
+            step.done();
         } catch (...) {
             workflow_id = params.workflow;
         }
@@ -659,45 +2151,25 @@ RecordRunResult Client::recordRun(const RecordRunParams& params) {
     run_params.correlation_id = params.correlation_id;
     run_params.metadata = params.metadata;
 
-    RunResult run = startRun(run_params);
+    RunResult run;
+    {
+        OperationScope step(ctx, "recordRun.startRun");
+        run = impl_->start_run(ctx, run_params);
+        step.done();
+    }
 
     /* Step 3: Emit events in batch */
     int events_created = 0;
     int events_duplicates = 0;
 
     if (!params.events.empty()) {
-        JsonArr batch_events;
-        for (size_t i = 0; i < params.events.size(); ++i) {
-            const RecordRunEvent& evt = params.events[i];
-            JsonObj event_json;
-            event_json["runId"] = jstr(run.id);
-            event_json["eventType"] = jstr(evt.event_type);
-
-            if (evt.quantity != 0) event_json["quantity"] = jnum(evt.quantity);
-            if (!evt.units.empty()) event_json["units"] = jstr(evt.units);
-            if (!evt.description.empty()) event_json["description"] = jstr(evt.description);
-            if (evt.cost_units != 0) event_json["costUnits"] = jnum(evt.cost_units);
-            if (!evt.metadata.empty()) event_json["metadata"] = metadata_to_json(evt.metadata);
-
-            if (!params.external_run_id.empty()) {
-                std::ostringstream key;
-                key << params.external_run_id << ":" << evt.event_type << ":" << i;
-                event_json["idempotencyKey"] = jstr(key.str());
-            } else {
-                event_json["idempotencyKey"] = jstr(make_idempotency_key_int(
-                    "run", run.id, evt.event_type, static_cast<int>(i)
-                ));
-            }
-
-            batch_events.push_back(JsonVal(event_json));
-        }
+        OperationScope step(ctx, "recordRun.emitEvents");
+        JsonObj batch_body = run_events_batch_body(run.id, params.external_run_id, params.events);
 
-        JsonObj batch_body;
-        batch_body["events"] = JsonVal(batch_events);
-
-        JsonObj batch_result = impl_->post("/run-events/batch", batch_body);
+        JsonObj batch_result = impl_->post(ctx, "/run-events/batch", batch_body);
         events_created = json_int(batch_result, "created", 0);
         events_duplicates = json_int(batch_result, "duplicates", 0);
+        step.done();
     }
 
     /* Step 4: End the run */
@@ -706,7 +2178,12 @@ RecordRunResult Client::recordRun(const RecordRunParams& params) {
     end_params.error_message = params.error_message;
     end_params.error_code = params.error_code;
 
-    EndRunResult end_result = endRun(run.id, end_params);
+    EndRunResult end_result;
+    {
+        OperationScope step(ctx, "recordRun.endRun");
+        end_result = impl_->end_run(ctx, run.id, end_params);
+        step.done();
+    }
 
     long long end_time = now_ms();
     int total_ms = static_cast<int>(end_time - start_time);
@@ -732,7 +2209,7 @@ RecordRunResult Client::recordRun(const RecordRunParams& params) {
     result.total_cost_units = end_result.total_cost_units;
     result.summary = summary.str();
 
-    return result;
+    return ctx.done(result);
 }
 
 } /* namespace drip */
@@ -0,0 +1,51 @@
+#ifndef DRIP_CLOCK_HPP
+#define DRIP_CLOCK_HPP
+
+/*
+ * Monotonic clock and sleeping (C++03 has no <chrono> or <thread>).
+ * Internal header — not installed.
+ */
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace drip {
+namespace detail {
+
+/** Nanoseconds from an arbitrary fixed point; only differences are meaningful. */
+inline uint64_t monotonic_ns() {
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return static_cast<uint64_t>(
+        static_cast<double>(now.QuadPart) * 1e9 / static_cast<double>(freq.QuadPart));
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+/** Block the calling thread for at least ms milliseconds. */
+inline void sleep_ms(int ms) {
+    if (ms <= 0) return;
+#ifdef _WIN32
+    Sleep(static_cast<DWORD>(ms));
+#else
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = static_cast<long>(ms % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) != 0) {}
+#endif
+}
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_CLOCK_HPP
@@ -0,0 +1,246 @@
+#include "codec.hpp"
+
+#include <sstream>
+
+namespace drip {
+namespace detail {
+
+// =============================================================================
+// Value construction
+// =============================================================================
+
+JsonVal metadata_to_json(const Metadata& m) {
+    JsonObj obj;
+    for (Metadata::const_iterator it = m.begin(); it != m.end(); ++it) {
+        obj[it->first] = jstr(it->second);
+    }
+    return JsonVal(obj);
+}
+
+Metadata metadata_from_json(const JsonVal& v) {
+    Metadata m;
+    if (v.is<JsonObj>()) {
+        const JsonObj& obj = v.get<JsonObj>();
+        for (JsonObj::const_iterator it = obj.begin(); it != obj.end(); ++it) {
+            if (it->second.is<std::string>()) {
+                m[it->first] = it->second.get<std::string>();
+            } else {
+                m[it->first] = it->second.serialize();
+            }
+        }
+    }
+    return m;
+}
+
+// =============================================================================
+// Field access
+// =============================================================================
+
+std::string json_string(const JsonObj& obj, const char* key) {
+    JsonObj::const_iterator it = obj.find(key);
+    if (it != obj.end() && it->second.is<std::string>()) {
+        return it->second.get<std::string>();
+    }
+    return "";
+}
+
+int json_int(const JsonObj& obj, const char* key, int def) {
+    JsonObj::const_iterator it = obj.find(key);
+    if (it != obj.end() && it->second.is<double>()) {
+        return static_cast<int>(it->second.get<double>());
+    }
+    return def;
+}
+
+double json_double(const JsonObj& obj, const char* key, double def) {
+    JsonObj::const_iterator it = obj.find(key);
+    if (it != obj.end() && it->second.is<double>()) {
+        return it->second.get<double>();
+    }
+    return def;
+}
+
+bool json_bool(const JsonObj& obj, const char* key, bool def) {
+    JsonObj::const_iterator it = obj.find(key);
+    if (it != obj.end() && it->second.is<bool>()) {
+        return it->second.get<bool>();
+    }
+    return def;
+}
+
+bool json_has(const JsonObj& obj, const char* key) {
+    return obj.find(key) != obj.end();
+}
+
+JsonArr json_arr(const JsonObj& obj, const char* key) {
+    JsonObj::const_iterator it = obj.find(key);
+    if (it != obj.end() && it->second.is<JsonArr>()) {
+        return it->second.get<JsonArr>();
+    }
+    return JsonArr();
+}
+
+std::string url_encode(const std::string& s) {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+            c == '-' || c == '_' || c == '.' || c == '~') {
+            out += static_cast<char>(c);
+        } else {
+            out += '%';
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        }
+    }
+    return out;
+}
+
+// =============================================================================
+// Idempotency keys
+// =============================================================================
+
+std::string make_idempotency_key(
+    const std::string& prefix,
+    const std::string& a,
+    const std::string& b,
+    double c
+) {
+    std::ostringstream oss;
+    oss << prefix << ":" << a << ":" << b << ":" << c;
+
+    std::string input = oss.str();
+    unsigned long hash = 5381;
+    for (size_t i = 0; i < input.size(); ++i) {
+        hash = ((hash << 5) + hash) + static_cast<unsigned char>(input[i]);
+    }
+
+    std::ostringstream hex;
+    hex << prefix << "_" << std::hex << hash;
+    return hex.str();
+}
+
+std::string make_idempotency_key_int(
+    const std::string& prefix,
+    const std::string& a,
+    const std::string& b,
+    int c
+) {
+    return make_idempotency_key(prefix, a, b, static_cast<double>(c));
+}
+
+// =============================================================================
+// Request bodies
+// =============================================================================
+
+JsonObj track_usage_body(const TrackUsageParams& params) {
+    std::string idem_key = params.idempotency_key;
+    if (idem_key.empty()) {
+        idem_key = make_idempotency_key("track", params.customer_id, params.meter, params.quantity);
+    }
+
+    JsonObj body;
+    body["customerId"] = jstr(params.customer_id);
+    body["usageType"] = jstr(params.meter);
+    body["quantity"] = jnum(params.quantity);
+    body["idempotencyKey"] = jstr(idem_key);
+
+    if (!params.units.empty()) body["units"] = jstr(params.units);
+    if (!params.description.empty()) body["description"] = jstr(params.description);
+    if (!params.metadata.empty()) body["metadata"] = metadata_to_json(params.metadata);
+    return body;
+}
+
+JsonObj emit_event_body(const EmitEventParams& params) {
+    std::string idem_key = params.idempotency_key;
+    if (idem_key.empty()) {
+        idem_key = make_idempotency_key("evt", params.run_id, params.event_type, params.quantity);
+    }
+
+    JsonObj body;
+    body["runId"] = jstr(params.run_id);
+    body["eventType"] = jstr(params.event_type);
+    body["idempotencyKey"] = jstr(idem_key);
+
+    if (params.quantity != 0) body["quantity"] = jnum(params.quantity);
+    if (!params.units.empty()) body["units"] = jstr(params.units);
+    if (!params.description.empty()) body["description"] = jstr(params.description);
+    if (params.cost_units != 0) body["costUnits"] = jnum(params.cost_units);
+    if (!params.metadata.empty()) body["metadata"] = metadata_to_json(params.metadata);
+    return body;
+}
+
+JsonObj run_events_batch_body(const std::string& run_id, const std::string& external_run_id,
+                              const std::vector<RecordRunEvent>& events) {
+    JsonArr batch_events;
+    for (size_t i = 0; i < events.size(); ++i) {
+        const RecordRunEvent& evt = events[i];
+        JsonObj event_json;
+        event_json["runId"] = jstr(run_id);
+        event_json["eventType"] = jstr(evt.event_type);
+
+        if (evt.quantity != 0) event_json["quantity"] = jnum(evt.quantity);
+        if (!evt.units.empty()) event_json["units"] = jstr(evt.units);
+        if (!evt.description.empty()) event_json["description"] = jstr(evt.description);
+        if (evt.cost_units != 0) event_json["costUnits"] = jnum(evt.cost_units);
+        if (!evt.metadata.empty()) event_json["metadata"] = metadata_to_json(evt.metadata);
+
+        if (!external_run_id.empty()) {
+            std::ostringstream key;
+            key << external_run_id << ":" << evt.event_type << ":" << i;
+            event_json["idempotencyKey"] = jstr(key.str());
+        } else {
+            event_json["idempotencyKey"] = jstr(make_idempotency_key_int(
+                "run", run_id, evt.event_type, static_cast<int>(i)
+            ));
+        }
+
+        batch_events.push_back(JsonVal(event_json));
+    }
+
+    JsonObj batch_body;
+    batch_body["events"] = JsonVal(batch_events);
+    return batch_body;
+}
+
+// =============================================================================
+// Response decoding
+// =============================================================================
+
+CustomerResult parse_customer(const JsonObj& data) {
+    CustomerResult r;
+    r.id = json_string(data, "id");
+    r.external_customer_id = json_string(data, "externalCustomerId");
+    r.onchain_address = json_string(data, "onchainAddress");
+    r.status = json_string(data, "status");
+    r.is_internal = json_bool(data, "isInternal", false);
+    if (json_has(data, "metadata")) {
+        JsonObj::const_iterator it = data.find("metadata");
+        if (it != data.end()) {
+            r.metadata = metadata_from_json(it->second);
+        }
+    }
+    r.created_at = json_string(data, "createdAt");
+    r.updated_at = json_string(data, "updatedAt");
+    return r;
+}
+
+JsonObj customer_to_json(const CustomerResult& customer) {
+    JsonObj obj;
+    obj["id"] = jstr(customer.id);
+    if (!customer.external_customer_id.empty()) {
+        obj["externalCustomerId"] = jstr(customer.external_customer_id);
+    }
+    if (!customer.onchain_address.empty()) obj["onchainAddress"] = jstr(customer.onchain_address);
+    if (!customer.status.empty()) obj["status"] = jstr(customer.status);
+    obj["isInternal"] = jbool(customer.is_internal);
+    if (!customer.metadata.empty()) obj["metadata"] = metadata_to_json(customer.metadata);
+    if (!customer.created_at.empty()) obj["createdAt"] = jstr(customer.created_at);
+    if (!customer.updated_at.empty()) obj["updatedAt"] = jstr(customer.updated_at);
+    return obj;
+}
+
+} // namespace detail
+} // namespace drip
@@ -0,0 +1,108 @@
+#ifndef DRIP_CODEC_HPP
+#define DRIP_CODEC_HPP
+
+/*
+ * JSON request-body construction and response decoding used by Client.
+ * Pure CPU, no I/O, so it can be benchmarked in isolation
+ * (bench/microbench.cpp). Internal header — not installed.
+ */
+
+#include "drip/types.hpp"
+
+#include <picojson/picojson.h>
+
+#include <string>
+#include <vector>
+
+namespace drip {
+namespace detail {
+
+/* Convenience typedefs for picojson */
+typedef picojson::value  JsonVal;
+typedef picojson::object JsonObj;
+typedef picojson::array  JsonArr;
+
+// =============================================================================
+// Value construction
+// =============================================================================
+
+/** Create a JSON string value. */
+inline JsonVal jstr(const std::string& s) {
+    return JsonVal(s);
+}
+
+/** Create a JSON number value. */
+inline JsonVal jnum(double n) {
+    return JsonVal(n);
+}
+
+/** Create a JSON bool value. */
+inline JsonVal jbool(bool b) {
+    return JsonVal(b);
+}
+
+/** Convert Metadata map to a JSON object value. */
+JsonVal metadata_to_json(const Metadata& m);
+
+/** Parse Metadata from a JSON object value. Non-string values are kept serialized. */
+Metadata metadata_from_json(const JsonVal& v);
+
+// =============================================================================
+// Field access — missing or mistyped fields yield the default
+// =============================================================================
+
+std::string json_string(const JsonObj& obj, const char* key);
+int json_int(const JsonObj& obj, const char* key, int def = 0);
+double json_double(const JsonObj& obj, const char* key, double def = 0.0);
+bool json_bool(const JsonObj& obj, const char* key, bool def = false);
+
+/** Check if a key exists in a JSON object. */
+bool json_has(const JsonObj& obj, const char* key);
+
+/** Get a nested array. Returns empty array if missing. */
+JsonArr json_arr(const JsonObj& obj, const char* key);
+
+/** Percent-encode everything but RFC 3986 unreserved characters, for query values. */
+std::string url_encode(const std::string& s);
+
+// =============================================================================
+// Idempotency keys
+// =============================================================================
+
+/** Deterministic key "<prefix>_<hex djb2 of prefix:a:b:c>". */
+std::string make_idempotency_key(const std::string& prefix, const std::string& a,
+                                 const std::string& b, double c);
+
+std::string make_idempotency_key_int(const std::string& prefix, const std::string& a,
+                                     const std::string& b, int c);
+
+// =============================================================================
+// Request bodies
+// =============================================================================
+
+/** POST /usage/internal body; generates the idempotency key if unset. */
+JsonObj track_usage_body(const TrackUsageParams& params);
+
+/** POST /run-events body; generates the idempotency key if unset. */
+JsonObj emit_event_body(const EmitEventParams& params);
+
+/**
+ * POST /run-events/batch body for recordRun(). Event keys derive from
+ * external_run_id when set, so retried recordRun calls deduplicate.
+ */
+JsonObj run_events_batch_body(const std::string& run_id, const std::string& external_run_id,
+                              const std::vector<RecordRunEvent>& events);
+
+// =============================================================================
+// Response decoding
+// =============================================================================
+
+CustomerResult parse_customer(const JsonObj& data);
+
+/** Inverse of parse_customer(); empty string fields are omitted. */
+JsonObj customer_to_json(const CustomerResult& customer);
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_CODEC_HPP
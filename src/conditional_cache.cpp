@@ -0,0 +1,87 @@
+#include "conditional_cache.hpp"
+#include "atomic.hpp"
+
+namespace drip {
+namespace detail {
+
+ConditionalCache::ConditionalCache()
+    : enabled_(false)
+    , capacity_(0)
+    , counters_(NULL)
+{}
+
+void ConditionalCache::configure(const ConditionalGetConfig& config, MetricsRegistry& metrics) {
+    ScopedLock lock(mutex_);
+    enabled_ = config.enabled && config.capacity > 0;
+    capacity_ = config.capacity > 0 ? static_cast<size_t>(config.capacity) : 0;
+    counters_ = &metrics.cache(CACHE_CONDITIONAL);
+    lru_.clear();
+    index_.clear();
+}
+
+bool ConditionalCache::validators(const std::string& path, std::string& etag,
+                                  std::string& last_modified) {
+    ScopedLock lock(mutex_);
+    Index::iterator it = index_.find(path);
+    if (it == index_.end()) return false;
+    etag = it->second->etag;
+    last_modified = it->second->last_modified;
+    return true;
+}
+
+bool ConditionalCache::reuse(const std::string& path, const std::string& etag,
+                             const std::string& last_modified, JsonObj& out) {
+    ScopedLock lock(mutex_);
+    Index::iterator it = index_.find(path);
+    if (it == index_.end() || it->second->etag != etag || it->second->last_modified != last_modified) {
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    out = it->second->data;
+    atomic_add(&counters_->hits, 1);
+    return true;
+}
+
+void ConditionalCache::store(const std::string& path, const std::map<std::string, std::string>& headers,
+                             const JsonObj& data) {
+    std::map<std::string, std::string>::const_iterator etag = headers.find("etag");
+    std::map<std::string, std::string>::const_iterator last_modified = headers.find("last-modified");
+
+    ScopedLock lock(mutex_);
+    Index::iterator it = index_.find(path);
+    if (etag == headers.end() && last_modified == headers.end()) {
+        /* A server that never sends validators is not missing the cache */
+        if (it != index_.end()) {
+            eraseLocked(it);
+            atomic_add(&counters_->misses, 1);
+        }
+        return;
+    }
+    atomic_add(&counters_->misses, 1);
+    if (it == index_.end()) {
+        while (index_.size() >= capacity_ && !lru_.empty()) {
+            eraseLocked(index_.find(lru_.back().path));
+            atomic_add(&counters_->evictions, 1);
+        }
+        lru_.push_front(Entry());
+        lru_.front().path = path;
+        it = index_.insert(std::make_pair(path, lru_.begin())).first;
+        atomic_store(&counters_->entries, index_.size());
+    } else {
+        lru_.splice(lru_.begin(), lru_, it->second);
+    }
+    Entry& entry = *it->second;
+    entry.etag = etag != headers.end() ? etag->second : std::string();
+    entry.last_modified = last_modified != headers.end() ? last_modified->second : std::string();
+    entry.data = data;
+}
+
+/* mutex_ held */
+void ConditionalCache::eraseLocked(Index::iterator it) {
+    lru_.erase(it->second);
+    index_.erase(it);
+    atomic_store(&counters_->entries, index_.size());
+}
+
+} // namespace detail
+} // namespace drip
@@ -0,0 +1,82 @@
+#ifndef DRIP_CONDITIONAL_CACHE_HPP
+#define DRIP_CONDITIONAL_CACHE_HPP
+
+/*
+ * Validators and parsed bodies for conditional GETs (ConditionalGetConfig).
+ * Internal header — not installed.
+ */
+
+#include "drip/types.hpp"
+#include "codec.hpp"
+#include "metrics_registry.hpp"
+#include "sync.hpp"
+
+#include <list>
+#include <map>
+#include <string>
+
+namespace drip {
+namespace detail {
+
+/**
+ * Bounded LRU map from request path to the last 200 response's ETag /
+ * Last-Modified and parsed body. A 304 answer to a request that carried
+ * an entry's validators reuses its body.
+ */
+class ConditionalCache {
+public:
+    ConditionalCache();
+
+    /** Counters are published to @p metrics under CACHE_CONDITIONAL. */
+    void configure(const ConditionalGetConfig& config, MetricsRegistry& metrics);
+
+    bool enabled() const { return enabled_; }
+
+    /** Validators to send for @p path; false when nothing is cached. */
+    bool validators(const std::string& path, std::string& etag, std::string& last_modified);
+
+    /**
+     * After a 304: copy the cached body if the entry still carries the
+     * validators that were sent. Counts a hit.
+     */
+    bool reuse(const std::string& path, const std::string& etag, const std::string& last_modified,
+               JsonObj& out);
+
+    /**
+     * After a 2xx with a full body: remember it if the response carried
+     * an ETag or Last-Modified (lower-cased header names), else forget
+     * @p path. Counts a miss unless there was nothing to remember or
+     * forget.
+     */
+    void store(const std::string& path, const std::map<std::string, std::string>& headers,
+               const JsonObj& data);
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    ConditionalCache(const ConditionalCache&);
+    ConditionalCache& operator=(const ConditionalCache&);
+
+    struct Entry {
+        std::string path;
+        std::string etag;
+        std::string last_modified;
+        JsonObj data;
+    };
+
+    typedef std::list<Entry> LruList;   /* Front = most recently used */
+    typedef std::map<std::string, LruList::iterator> Index;
+
+    void eraseLocked(Index::iterator it);
+
+    Mutex mutex_;
+    bool enabled_;
+    size_t capacity_;
+    CacheCounters* counters_;
+    LruList lru_;
+    Index index_;
+};
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_CONDITIONAL_CACHE_HPP
@@ -0,0 +1,360 @@
+#include "drip/transport.hpp"
+#include "sync.hpp"
+
+#include <curl/curl.h>
+
+#include <vector>
+
+namespace drip {
+
+// =============================================================================
+// CURL callbacks
+// =============================================================================
+
+/**
+ * Response body accumulator. In ack-only mode a 2xx body is dropped as it
+ * arrives, so the transfer never buffers it.
+ */
+struct ResponseSink {
+    HttpResponse& response;
+    CURL* curl;
+    bool discard_success;
+
+    ResponseSink(HttpResponse& r, CURL* c, bool discard)
+        : response(r)
+        , curl(c)
+        , discard_success(discard)
+    {}
+};
+
+static size_t curl_write_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    ResponseSink* sink = static_cast<ResponseSink*>(userdata);
+    size_t total = size * nmemb;
+    if (sink->discard_success) {
+        long http_code = 0;
+        curl_easy_getinfo(sink->curl, CURLINFO_RESPONSE_CODE, &http_code);
+        if (http_code >= 200 && http_code < 300) {
+            return total;
+        }
+    }
+    sink->response.body.append(ptr, total);
+    return total;
+}
+
+/** Collect "Name: value" response headers with lower-cased names. */
+static size_t curl_header_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    ResponseSink* sink = static_cast<ResponseSink*>(userdata);
+    size_t total = size * nmemb;
+
+    size_t colon = 0;
+    while (colon < total && ptr[colon] != ':') ++colon;
+    if (colon == 0 || colon == total) return total;   /* Status line or blank line */
+
+    std::string name(ptr, colon);
+    for (size_t i = 0; i < name.size(); ++i) {
+        if (name[i] >= 'A' && name[i] <= 'Z') name[i] = static_cast<char>(name[i] - 'A' + 'a');
+    }
+
+    size_t begin = colon + 1;
+    size_t end = total;
+    while (begin < end && (ptr[begin] == ' ' || ptr[begin] == '\t')) ++begin;
+    while (end > begin && (ptr[end - 1] == '\r' || ptr[end - 1] == '\n' || ptr[end - 1] == ' ')) --end;
+    sink->response.headers[name] = std::string(ptr + begin, end - begin);
+    return total;
+}
+
+// =============================================================================
+// Transfer timing
+// =============================================================================
+
+/** Read one of curl's cumulative transfer timers in microseconds. */
+static int64_t curl_time_us(CURL* curl, CURLINFO info_t, CURLINFO info_double) {
+#if LIBCURL_VERSION_NUM >= 0x073d00
+    (void)info_double;
+    curl_off_t us = 0;
+    curl_easy_getinfo(curl, info_t, &us);
+    return static_cast<int64_t>(us);
+#else
+    (void)info_t;
+    double secs = 0;
+    curl_easy_getinfo(curl, info_double, &secs);
+    return static_cast<int64_t>(secs * 1e6);
+#endif
+}
+
+#if LIBCURL_VERSION_NUM >= 0x073d00
+#define DRIP_CURL_TIME(curl, name) curl_time_us(curl, CURLINFO_##name##_T, CURLINFO_##name)
+#else
+#define DRIP_CURL_TIME(curl, name) curl_time_us(curl, CURLINFO_##name, CURLINFO_##name)
+#endif
+
+/** Fill a single-request RequestInfo from a finished handle. */
+static void read_transfer_info(CURL* curl, size_t body_size, RequestInfo& info) {
+    info.namelookup_us = DRIP_CURL_TIME(curl, NAMELOOKUP_TIME);
+    info.connect_us = DRIP_CURL_TIME(curl, CONNECT_TIME);
+    info.appconnect_us = DRIP_CURL_TIME(curl, APPCONNECT_TIME);
+    info.pretransfer_us = DRIP_CURL_TIME(curl, PRETRANSFER_TIME);
+    info.starttransfer_us = DRIP_CURL_TIME(curl, STARTTRANSFER_TIME);
+    info.total_us = DRIP_CURL_TIME(curl, TOTAL_TIME);
+
+    long new_connects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &new_connects);
+    info.connection_reused = (new_connects == 0);
+
+    long http_code = 0;
+    long request_size = 0;
+    long header_size = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_easy_getinfo(curl, CURLINFO_REQUEST_SIZE, &request_size);
+    curl_easy_getinfo(curl, CURLINFO_HEADER_SIZE, &header_size);
+#if LIBCURL_VERSION_NUM >= 0x073700
+    curl_off_t download_size = 0;
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &download_size);
+#else
+    /* CURLINFO_SIZE_DOWNLOAD_T needs libcurl 7.55 */
+    double download_size = 0;
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD, &download_size);
+#endif
+
+    info.requests = 1;
+    info.http_status = static_cast<int>(http_code);
+    info.bytes_sent = static_cast<int64_t>(request_size) + static_cast<int64_t>(body_size);
+    info.bytes_received = static_cast<int64_t>(header_size) + static_cast<int64_t>(download_size);
+}
+
+#undef DRIP_CURL_TIME
+
+// =============================================================================
+// Global init
+// =============================================================================
+
+/* curl_global_init() is not thread-safe on older libcurl; run it once. */
+#ifdef _WIN32
+static INIT_ONCE curl_init_once = INIT_ONCE_STATIC_INIT;
+static BOOL CALLBACK curl_global_init_cb(PINIT_ONCE, PVOID, PVOID*) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    return TRUE;
+}
+static void ensure_curl_global_init() {
+    InitOnceExecuteOnce(&curl_init_once, curl_global_init_cb, NULL, NULL);
+}
+#else
+static pthread_once_t curl_init_once = PTHREAD_ONCE_INIT;
+static void curl_global_init_cb() {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+}
+static void ensure_curl_global_init() {
+    pthread_once(&curl_init_once, curl_global_init_cb);
+}
+#endif
+
+// =============================================================================
+// CurlTransport
+// =============================================================================
+
+/* Upper bound on idle curl handles kept for connection reuse. */
+static const size_t MAX_IDLE_HANDLES = 16;
+
+/*
+ * How long one wait for socket activity may block. Without a
+ * cancellation token this matches curl_easy_perform(); with one it bounds
+ * how late a cancel() is noticed.
+ */
+static const int IDLE_POLL_MS = 1000;
+static const int CANCEL_POLL_MS = 20;
+
+/**
+ * An easy handle driven through its own multi handle. The multi owns the
+ * connection cache, so each pooled pair keeps its connections alive, and
+ * a cancelled transfer is aborted by removing the easy handle.
+ */
+struct CurlHandle {
+    CURL* easy;
+    CURLM* multi;
+};
+
+static void curl_handle_cleanup(CurlHandle h) {
+    if (h.multi) curl_multi_cleanup(h.multi);
+    if (h.easy) curl_easy_cleanup(h.easy);
+}
+
+struct CurlTransport::Impl {
+    /* Idle handle pairs; each keeps its own connection cache alive. */
+    detail::Mutex pool_mutex;
+    std::vector<CurlHandle> idle_handles;
+
+    ~Impl() {
+        for (size_t i = 0; i < idle_handles.size(); ++i) {
+            curl_handle_cleanup(idle_handles[i]);
+        }
+    }
+
+    CurlHandle acquire_handle() {
+        {
+            detail::ScopedLock lock(pool_mutex);
+            if (!idle_handles.empty()) {
+                CurlHandle h = idle_handles.back();
+                idle_handles.pop_back();
+                return h;
+            }
+        }
+        CurlHandle h;
+        h.easy = curl_easy_init();
+        h.multi = curl_multi_init();
+        if (!h.easy || !h.multi) {
+            curl_handle_cleanup(h);
+            h.easy = NULL;
+            h.multi = NULL;
+        }
+        return h;
+    }
+
+    void release_handle(CurlHandle h) {
+        /* reset() clears options but keeps the connection cache */
+        curl_easy_reset(h.easy);
+        {
+            detail::ScopedLock lock(pool_mutex);
+            if (idle_handles.size() < MAX_IDLE_HANDLES) {
+                idle_handles.push_back(h);
+                return;
+            }
+        }
+        curl_handle_cleanup(h);
+    }
+
+    /** Returns a pooled handle and frees the header list on scope exit. */
+    struct HandleLease {
+        Impl& impl;
+        CurlHandle handle;
+        struct curl_slist* headers;
+
+        HandleLease(Impl& i)
+            : impl(i)
+            , handle(i.acquire_handle())
+            , headers(NULL)
+        {}
+
+        ~HandleLease() {
+            if (headers) curl_slist_free_all(headers);
+            if (handle.easy) impl.release_handle(handle);
+        }
+    };
+};
+
+/**
+ * Run the transfer on h.multi until it finishes or the token is
+ * cancelled. *cancelled is set in the latter case.
+ */
+static CURLcode run_transfer(CurlHandle h, const CancellationToken* token, bool* cancelled) {
+    *cancelled = false;
+    if (curl_multi_add_handle(h.multi, h.easy) != CURLM_OK) {
+        return CURLE_FAILED_INIT;
+    }
+
+    CURLcode result = CURLE_OK;
+    int running = 1;
+    while (running) {
+        if (curl_multi_perform(h.multi, &running) != CURLM_OK) {
+            result = CURLE_RECV_ERROR;
+            break;
+        }
+        if (!running) break;
+        if (token && token->isCancelled()) {
+            *cancelled = true;
+            break;
+        }
+#if LIBCURL_VERSION_NUM >= 0x074200
+        curl_multi_poll(h.multi, NULL, 0, token ? CANCEL_POLL_MS : IDLE_POLL_MS, NULL);
+#else
+        curl_multi_wait(h.multi, NULL, 0, token ? CANCEL_POLL_MS : IDLE_POLL_MS, NULL);
+#endif
+    }
+
+    if (!*cancelled) {
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(h.multi, &queued)) {
+            if (msg->msg == CURLMSG_DONE && msg->easy_handle == h.easy) {
+                result = msg->data.result;
+            }
+        }
+    }
+    /* Removing a handle mid-transfer closes its connection */
+    curl_multi_remove_handle(h.multi, h.easy);
+    return result;
+}
+
+CurlTransport::CurlTransport()
+    : impl_(NULL)
+{
+    ensure_curl_global_init();
+    impl_ = new Impl();
+}
+
+CurlTransport::~CurlTransport() {
+    delete impl_;
+}
+
+void CurlTransport::perform(const HttpRequest& request, HttpResponse& response) {
+    Impl::HandleLease lease(*impl_);
+    CURL* curl = lease.handle.easy;
+    if (!curl) {
+        response.status = TRANSPORT_NETWORK_ERROR;
+        response.error = "Failed to initialize CURL";
+        return;
+    }
+    if (request.cancellation && request.cancellation->isCancelled()) {
+        response.status = TRANSPORT_CANCELLED;
+        response.error = "Request cancelled";
+        return;
+    }
+
+    ResponseSink sink(response, curl, request.discard_success_body);
+
+    for (size_t i = 0; i < request.headers.size(); ++i) {
+        lease.headers = curl_slist_append(lease.headers, request.headers[i].c_str());
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, lease.headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_write_cb);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sink);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curl_header_cb);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &sink);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, static_cast<long>(request.timeout_ms));
+    if (request.connect_timeout_ms > 0) {
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(request.connect_timeout_ms));
+    }
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+    if (request.method == "GET") {
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    } else {
+        if (request.method == "POST") {
+            curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        } else {
+            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+        }
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request.body.c_str());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(request.body.size()));
+    }
+
+    bool cancelled = false;
+    CURLcode res = run_transfer(lease.handle, request.cancellation, &cancelled);
+    read_transfer_info(curl, request.body.size(), response.info);
+    response.http_status = response.info.http_status;
+
+    if (cancelled) {
+        response.status = TRANSPORT_CANCELLED;
+        response.error = "Request cancelled";
+    } else if (res == CURLE_OPERATION_TIMEDOUT) {
+        response.status = TRANSPORT_TIMEOUT;
+        response.error = "Request timed out";
+    } else if (res != CURLE_OK) {
+        response.status = TRANSPORT_NETWORK_ERROR;
+        response.error = std::string("CURL error: ") + curl_easy_strerror(res);
+    } else {
+        response.status = TRANSPORT_OK;
+    }
+}
+
+} // namespace drip
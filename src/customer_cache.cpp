@@ -0,0 +1,101 @@
+#include "customer_cache.hpp"
+#include "atomic.hpp"
+
+namespace drip {
+namespace detail {
+
+CustomerCache::CustomerCache()
+    : enabled_(false)
+    , capacity_(0)
+    , ttl_ns_(0)
+    , negative_ttl_ns_(0)
+    , counters_(NULL)
+{}
+
+void CustomerCache::configure(const CustomerCacheConfig& config, MetricsRegistry& metrics) {
+    ScopedLock lock(mutex_);
+    enabled_ = config.enabled && config.capacity > 0 && config.ttl_ms > 0;
+    capacity_ = config.capacity > 0 ? static_cast<size_t>(config.capacity) : 0;
+    ttl_ns_ = config.ttl_ms > 0 ? static_cast<uint64_t>(config.ttl_ms) * 1000000ULL : 0;
+    negative_ttl_ns_ = config.negative_ttl_ms > 0
+                     ? static_cast<uint64_t>(config.negative_ttl_ms) * 1000000ULL : 0;
+    counters_ = &metrics.cache(CACHE_CUSTOMER);
+    lru_.clear();
+    index_.clear();
+}
+
+CustomerCache::Lookup CustomerCache::get(const std::string& id, uint64_t now_ns,
+                                         CustomerResult& out, std::string& message) {
+    ScopedLock lock(mutex_);
+    Index::iterator it = index_.find(id);
+    if (it == index_.end() || now_ns >= it->second->expires_ns) {
+        if (it != index_.end()) eraseLocked(it);
+        atomic_add(&counters_->misses, 1);
+        return CACHE_MISS;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    const Entry& entry = *it->second;
+    if (!entry.found) {
+        message = entry.message;
+        atomic_add(&counters_->negative_hits, 1);
+        return CACHE_NOT_FOUND;
+    }
+    out = entry.customer;
+    atomic_add(&counters_->hits, 1);
+    return CACHE_HIT;
+}
+
+void CustomerCache::put(const CustomerResult& customer, uint64_t now_ns) {
+    if (customer.id.empty()) return;
+    Entry entry;
+    entry.id = customer.id;
+    entry.found = true;
+    entry.customer = customer;
+    entry.expires_ns = now_ns + ttl_ns_;
+    ScopedLock lock(mutex_);
+    store(entry);
+}
+
+void CustomerCache::putNotFound(const std::string& id, const std::string& message, uint64_t now_ns) {
+    if (negative_ttl_ns_ == 0) return;
+    Entry entry;
+    entry.id = id;
+    entry.found = false;
+    entry.message = message;
+    entry.expires_ns = now_ns + negative_ttl_ns_;
+    ScopedLock lock(mutex_);
+    store(entry);
+}
+
+void CustomerCache::erase(const std::string& id) {
+    ScopedLock lock(mutex_);
+    Index::iterator it = index_.find(id);
+    if (it != index_.end()) eraseLocked(it);
+}
+
+/* mutex_ held */
+void CustomerCache::store(const Entry& entry) {
+    Index::iterator it = index_.find(entry.id);
+    if (it != index_.end()) {
+        *it->second = entry;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+    while (index_.size() >= capacity_ && !lru_.empty()) {
+        eraseLocked(index_.find(lru_.back().id));
+        atomic_add(&counters_->evictions, 1);
+    }
+    lru_.push_front(entry);
+    index_.insert(std::make_pair(entry.id, lru_.begin()));
+    atomic_store(&counters_->entries, index_.size());
+}
+
+/* mutex_ held */
+void CustomerCache::eraseLocked(Index::iterator it) {
+    lru_.erase(it->second);
+    index_.erase(it);
+    atomic_store(&counters_->entries, index_.size());
+}
+
+} // namespace detail
+} // namespace drip
@@ -0,0 +1,83 @@
+#ifndef DRIP_CUSTOMER_CACHE_HPP
+#define DRIP_CUSTOMER_CACHE_HPP
+
+/*
+ * getCustomer() cache behind CustomerCacheConfig. Internal header — not
+ * installed.
+ */
+
+#include "drip/types.hpp"
+#include "metrics_registry.hpp"
+#include "sync.hpp"
+
+#include <list>
+#include <map>
+#include <string>
+
+namespace drip {
+namespace detail {
+
+/**
+ * Bounded LRU map from customer id to CustomerResult or "not found".
+ * One mutex; lookups are a map find plus a list splice under it.
+ * Expired entries are dropped when looked up, or evicted as least
+ * recently used.
+ */
+class CustomerCache {
+public:
+    enum Lookup {
+        CACHE_MISS,
+        CACHE_HIT,
+        CACHE_NOT_FOUND   /* Negative hit; message holds the original error */
+    };
+
+    CustomerCache();
+
+    /** Counters are published to @p metrics under CACHE_CUSTOMER. */
+    void configure(const CustomerCacheConfig& config, MetricsRegistry& metrics);
+
+    bool enabled() const { return enabled_; }
+
+    /** On CACHE_HIT fills @p out; on CACHE_NOT_FOUND fills @p message. */
+    Lookup get(const std::string& id, uint64_t now_ns, CustomerResult& out, std::string& message);
+
+    void put(const CustomerResult& customer, uint64_t now_ns);
+
+    /** Remember that @p id does not exist (no-op when negative_ttl_ms is 0). */
+    void putNotFound(const std::string& id, const std::string& message, uint64_t now_ns);
+
+    void erase(const std::string& id);
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    CustomerCache(const CustomerCache&);
+    CustomerCache& operator=(const CustomerCache&);
+
+    struct Entry {
+        std::string id;
+        bool found;
+        CustomerResult customer;
+        std::string message;
+        uint64_t expires_ns;
+    };
+
+    typedef std::list<Entry> LruList;   /* Front = most recently used */
+    typedef std::map<std::string, LruList::iterator> Index;
+
+    void store(const Entry& entry);
+    void eraseLocked(Index::iterator it);
+
+    Mutex mutex_;
+    bool enabled_;
+    size_t capacity_;
+    uint64_t ttl_ns_;
+    uint64_t negative_ttl_ns_;
+    CacheCounters* counters_;
+    LruList lru_;
+    Index index_;
+};
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_CUSTOMER_CACHE_HPP
@@ -0,0 +1,163 @@
+#include "customer_index.hpp"
+#include "atomic.hpp"
+
+#include <cstring>
+
+namespace drip {
+namespace detail {
+
+static const size_t INITIAL_SLOTS = 64;
+static const size_t MAX_FIELD = 0xFFFF;
+
+CustomerIndex::CustomerIndex()
+    : active_(0)
+    , size_(0)
+    , garbage_(0)
+    , list_offset_(0)
+    , counters_(NULL)
+{}
+
+void CustomerIndex::configure(MetricsRegistry& metrics) {
+    counters_ = &metrics.cache(CACHE_CUSTOMER_INDEX);
+}
+
+void CustomerIndex::activate() {
+    atomic_store(&active_, 1);
+}
+
+bool CustomerIndex::active() const {
+    return atomic_load(&active_) != 0;
+}
+
+uint32_t CustomerIndex::hashKey(const char* key, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(key[i]);
+        h *= 1099511628211ULL;
+    }
+    uint32_t folded = static_cast<uint32_t>(h ^ (h >> 32));
+    return folded != 0 ? folded : 1;
+}
+
+/* Slot holding key, or the empty slot where it would go. */
+size_t CustomerIndex::probe(uint32_t hash, const char* key, size_t len) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        const Slot& s = slots_[i];
+        if (s.hash == 0) return i;
+        if (s.hash == hash && s.key_len == len &&
+            std::memcmp(arena_.data() + s.offset, key, len) == 0) {
+            return i;
+        }
+    }
+}
+
+/* Rebuild into `capacity` slots, dropping overwritten values from the arena. */
+void CustomerIndex::rehash(size_t capacity) {
+    std::vector<Slot> old_slots(capacity);
+    old_slots.swap(slots_);
+    for (size_t i = 0; i < slots_.size(); ++i) slots_[i].hash = 0;
+    std::string old_arena;
+    old_arena.swap(arena_);
+    arena_.reserve(old_arena.size() - garbage_);
+    garbage_ = 0;
+
+    size_t mask = slots_.size() - 1;
+    for (size_t i = 0; i < old_slots.size(); ++i) {
+        Slot s = old_slots[i];
+        if (s.hash == 0) continue;
+        size_t n = static_cast<size_t>(s.key_len) + s.value_len;
+        size_t j = s.hash & mask;
+        while (slots_[j].hash != 0) j = (j + 1) & mask;
+        uint32_t offset = static_cast<uint32_t>(arena_.size());
+        arena_.append(old_arena, s.offset, n);
+        s.offset = offset;
+        slots_[j] = s;
+    }
+}
+
+/* mutex_ held */
+bool CustomerIndex::lookup(const std::string& external_id, std::string& customer_id) const {
+    if (size_ == 0 || external_id.empty()) return false;
+    const Slot& s = slots_[probe(hashKey(external_id.data(), external_id.size()),
+                                 external_id.data(), external_id.size())];
+    if (s.hash == 0) return false;
+    customer_id.assign(arena_, s.offset + s.key_len, s.value_len);
+    return true;
+}
+
+bool CustomerIndex::find(const std::string& external_id, std::string& customer_id) {
+    ScopedLock lock(mutex_);
+    bool found = lookup(external_id, customer_id);
+    atomic_add(found ? &counters_->hits : &counters_->misses, 1);
+    return found;
+}
+
+bool CustomerIndex::peek(const std::string& external_id, std::string& customer_id) const {
+    ScopedLock lock(mutex_);
+    return lookup(external_id, customer_id);
+}
+
+void CustomerIndex::insert(const std::string& external_id, const std::string& customer_id) {
+    if (external_id.empty() || external_id.size() > MAX_FIELD || customer_id.size() > MAX_FIELD) {
+        return;
+    }
+    ScopedLock lock(mutex_);
+    /* Keep the load factor under 0.7 */
+    if (slots_.empty()) {
+        rehash(INITIAL_SLOTS);
+    } else if ((size_ + 1) * 10 > slots_.size() * 7) {
+        rehash(slots_.size() * 2);
+    }
+
+    uint32_t hash = hashKey(external_id.data(), external_id.size());
+    size_t i = probe(hash, external_id.data(), external_id.size());
+    Slot& s = slots_[i];
+    if (s.hash != 0) {
+        if (s.value_len == customer_id.size() &&
+            arena_.compare(s.offset + s.key_len, s.value_len, customer_id) == 0) {
+            return;
+        }
+        garbage_ += static_cast<size_t>(s.key_len) + s.value_len;
+    } else {
+        ++size_;
+        atomic_store(&counters_->entries, size_);
+    }
+    s.hash = hash;
+    s.offset = static_cast<uint32_t>(arena_.size());
+    s.key_len = static_cast<uint16_t>(external_id.size());
+    s.value_len = static_cast<uint16_t>(customer_id.size());
+    arena_.append(external_id);
+    arena_.append(customer_id);
+
+    if (garbage_ > arena_.size() / 2) rehash(slots_.size());
+}
+
+size_t CustomerIndex::size() const {
+    ScopedLock lock(mutex_);
+    return size_;
+}
+
+void CustomerIndex::entries(std::vector<std::pair<std::string, std::string> >& out) const {
+    ScopedLock lock(mutex_);
+    out.reserve(out.size() + size_);
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        const Slot& s = slots_[i];
+        if (s.hash == 0) continue;
+        out.push_back(std::make_pair(arena_.substr(s.offset, s.key_len),
+                                     arena_.substr(s.offset + s.key_len, s.value_len)));
+    }
+}
+
+int CustomerIndex::listOffset() const {
+    ScopedLock lock(mutex_);
+    return list_offset_;
+}
+
+void CustomerIndex::setListOffset(int offset) {
+    ScopedLock lock(mutex_);
+    list_offset_ = offset;
+}
+
+} // namespace detail
+} // namespace drip
@@ -0,0 +1,98 @@
+#ifndef DRIP_CUSTOMER_INDEX_HPP
+#define DRIP_CUSTOMER_INDEX_HPP
+
+/*
+ * external_customer_id -> customer id index behind resolveCustomer().
+ * Internal header — not installed.
+ */
+
+#include "metrics_registry.hpp"
+#include "sync.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/* C++03: use <stdint.h> instead of <cstdint> */
+#include <stdint.h>
+
+namespace drip {
+namespace detail {
+
+/**
+ * Open-addressing (linear probing) string map. Keys and values live
+ * back to back in one arena string; a slot is 12 bytes (32-bit hash,
+ * arena offset, two 16-bit lengths), so a million customers with short
+ * ids take a few tens of MB and no per-entry allocation. Hash 0 marks an
+ * empty slot. Entries are never removed; an overwritten value leaves its
+ * old bytes behind until the next rehash compacts the arena.
+ *
+ * Thread-safe behind one mutex. Stays empty (and costs nothing) until
+ * activate() is called, so clients that never resolve do not index.
+ */
+class CustomerIndex {
+public:
+    CustomerIndex();
+
+    /** Counters are published to @p metrics under CACHE_CUSTOMER_INDEX. */
+    void configure(MetricsRegistry& metrics);
+
+    void activate();
+    bool active() const;
+
+    /** Look up; counts a hit or miss. */
+    bool find(const std::string& external_id, std::string& customer_id);
+
+    /** find() without touching the hit/miss counters. */
+    bool peek(const std::string& external_id, std::string& customer_id) const;
+
+    /** Insert or overwrite. Ignores empty keys and keys or values over 64 KiB. */
+    void insert(const std::string& external_id, const std::string& customer_id);
+
+    size_t size() const;
+
+    /** Append every (external id, customer id) pair to @p out. */
+    void entries(std::vector<std::pair<std::string, std::string> >& out) const;
+
+    /** Offset of the first customer-list entry not yet read (see Client::resolveCustomer). */
+    int listOffset() const;
+    void setListOffset(int offset);
+
+    /** Serializes list refreshes so concurrent misses page the API once. */
+    Mutex& refreshMutex() { return refresh_mutex_; }
+
+    /** FNV-1a, folded to 32 bits; never 0 (the empty-slot marker). Also hashes IdCacheFile tables. */
+    static uint32_t hashKey(const char* key, size_t len);
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    CustomerIndex(const CustomerIndex&);
+    CustomerIndex& operator=(const CustomerIndex&);
+
+    struct Slot {
+        uint32_t hash;
+        uint32_t offset;
+        uint16_t key_len;
+        uint16_t value_len;
+    };
+
+    /* mutex_ held */
+    size_t probe(uint32_t hash, const char* key, size_t len) const;
+    bool lookup(const std::string& external_id, std::string& customer_id) const;
+    void rehash(size_t capacity);
+
+    mutable Mutex mutex_;
+    Mutex refresh_mutex_;
+    volatile uint64_t active_;
+    std::vector<Slot> slots_;   /* Power-of-two size */
+    std::string arena_;
+    size_t size_;
+    size_t garbage_;            /* Arena bytes no slot points at */
+    int list_offset_;
+    CacheCounters* counters_;
+};
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_CUSTOMER_INDEX_HPP
@@ -0,0 +1,78 @@
+#include "fan_out.hpp"
+
+namespace drip {
+namespace detail {
+
+FanOut::FanOut(Task task, void* arg, size_t count)
+    : task_(task)
+    , arg_(arg)
+    , count_(count)
+    , next_(0)
+    , returned_(0)
+    , running_(0)
+    , stopping_(false)
+{}
+
+FanOut::~FanOut() {
+    stop();
+}
+
+int FanOut::start(int threads) {
+    ScopedLock lock(mutex_);
+    for (int i = 0; i < threads && static_cast<size_t>(i) < count_; ++i) {
+        /* Fewer threads than asked for only means less overlap */
+        if (!start_detached_thread(&FanOut::workerMain, this)) break;
+        ++running_;
+    }
+    return running_;
+}
+
+void FanOut::workerMain(void* arg) {
+    static_cast<FanOut*>(arg)->workerLoop();
+}
+
+void FanOut::workerLoop() {
+    ScopedLock lock(mutex_);
+    while (!stopping_ && next_ < count_) {
+        size_t index = next_++;
+        mutex_.unlock();
+        task_(arg_, index);
+        mutex_.lock();
+        finished_.push_back(index);
+        changed_.notifyAll();
+    }
+    --running_;
+    changed_.notifyAll();
+}
+
+bool FanOut::next(size_t& index) {
+    ScopedLock lock(mutex_);
+    for (;;) {
+        if (!finished_.empty()) {
+            index = finished_.front();
+            finished_.pop_front();
+            ++returned_;
+            return true;
+        }
+        if (returned_ == count_ || stopping_) return false;
+        if (running_ == 0) break;
+        changed_.wait(mutex_);
+    }
+    if (next_ == count_) return false;
+    /* No worker left: run the next item here */
+    index = next_++;
+    mutex_.unlock();
+    task_(arg_, index);
+    mutex_.lock();
+    ++returned_;
+    return true;
+}
+
+void FanOut::stop() {
+    ScopedLock lock(mutex_);
+    stopping_ = true;
+    while (running_ > 0) changed_.wait(mutex_);
+}
+
+} // namespace detail
+} // namespace drip
@@ -0,0 +1,73 @@
+#ifndef DRIP_FAN_OUT_HPP
+#define DRIP_FAN_OUT_HPP
+
+/*
+ * Bounded-parallel loops for the bulk methods. Internal header — not
+ * installed.
+ */
+
+#include "sync.hpp"
+
+#include <deque>
+
+/* C++03: use <stddef.h> for size_t */
+#include <stddef.h>
+
+namespace drip {
+namespace detail {
+
+/**
+ * Runs task(arg, i) for every i in [0, count) on up to `threads` worker
+ * threads, handing finished indices back to the calling thread in
+ * completion order. If no worker could be started, next() runs the
+ * items itself, one per call. The task must not throw.
+ *
+ *   FanOut fan(&task, &state, n);
+ *   fan.start(8);
+ *   size_t i;
+ *   while (fan.next(i)) report(i);
+ *
+ * The destructor stops claiming items and waits for the running ones, so
+ * state the task touches may live on the caller's stack.
+ */
+class FanOut {
+public:
+    typedef void (*Task)(void* arg, size_t index);
+
+    FanOut(Task task, void* arg, size_t count);
+    ~FanOut();
+
+    /** Start min(threads, count) workers; returns how many started. */
+    int start(int threads);
+
+    /** Wait for the next finished item; false once every item has been returned. */
+    bool next(size_t& index);
+
+    /** Stop claiming items and wait for the ones in flight. */
+    void stop();
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    FanOut(const FanOut&);
+    FanOut& operator=(const FanOut&);
+
+    static void workerMain(void* arg);
+    void workerLoop();
+
+    Task task_;
+    void* arg_;
+    size_t count_;
+
+    Mutex mutex_;
+    CondVar changed_;
+    size_t next_;            /* Next index to claim */
+    size_t returned_;        /* Indices handed out by next() */
+    int running_;            /* Worker threads alive */
+    bool stopping_;
+    std::deque<size_t> finished_;
+};
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_FAN_OUT_HPP
@@ -0,0 +1,294 @@
+#include "hedge.hpp"
+#include "drip/cancellation.hpp"
+#include "atomic.hpp"
+#include "clock.hpp"
+
+#include <algorithm>
+
+namespace drip {
+namespace detail {
+
+/* Percentile delays are recomputed at most this often */
+static const uint64_t REFRESH_NS = 1000000000ULL;
+
+/* Wait slice while watching the caller's cancellation token */
+static const int CANCEL_POLL_MS = 20;
+
+/**
+ * State shared by the caller, the timer thread and the hedge of one
+ * request. Freed by whichever of the caller and the hedge lets go last;
+ * the timer thread only touches it while it is in watched_.
+ */
+struct HedgeCall {
+    Hedger* hedger;
+    Transport* transport;
+    Endpoint endpoint;
+    uint64_t calls;      /* Hedgeable requests so far, for the budget */
+    HttpRequest requests[2];
+    HttpResponse responses[2];
+    CancellationToken tokens[2];
+
+    /* Guarded by the hedger's timer_mutex_ */
+    uint64_t hedge_at;   /* monotonic_ns() when the hedge is due */
+    const CancellationToken* caller;
+    bool hedge_decided;
+
+    Mutex mutex;
+    CondVar finished;
+    bool hedged;         /* The second leg was sent */
+    bool done[2];
+    int winner;          /* First leg with a usable response; -1 until then */
+    int refs;
+
+    HedgeCall(Hedger* h, Transport* t, Endpoint e, const HttpRequest& request)
+        : hedger(h)
+        , transport(t)
+        , endpoint(e)
+        , calls(0)
+        , hedge_at(0)
+        , caller(request.cancellation)
+        , hedge_decided(false)
+        , hedged(false)
+        , winner(-1)
+        , refs(1)
+    {
+        for (int i = 0; i < 2; ++i) {
+            requests[i] = request;
+            requests[i].cancellation = &tokens[i];
+            done[i] = false;
+        }
+    }
+
+    void release() {
+        bool last;
+        {
+            ScopedLock lock(mutex);
+            last = --refs == 0;
+        }
+        if (last) delete this;
+    }
+};
+
+/** A response worth returning: one was received and it is not a 5xx. */
+static bool usable(const HttpResponse& resp) {
+    return resp.status == TRANSPORT_OK && resp.http_status < 500;
+}
+
+Hedger::Hedger()
+    : metrics_(NULL)
+    , enabled_(false)
+    , calls_(0)
+    , hedges_(0)
+    , timer_running_(false)
+    , stop_(false)
+    , legs_(0)
+{
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        delay_ns_[e] = 0;
+        refreshed_ns_[e] = 0;
+    }
+}
+
+Hedger::~Hedger() {
+    drain();
+}
+
+void Hedger::configure(const HedgeConfig& config, MetricsRegistry& metrics) {
+    config_ = config;
+    metrics_ = &metrics;
+    if (config_.min_samples < 1) config_.min_samples = 1;
+    enabled_ = config_.enabled && config_.budget_percent > 0;
+}
+
+void Hedger::drain() {
+    {
+        ScopedLock lock(timer_mutex_);
+        stop_ = true;
+        timer_cv_.notifyAll();
+        while (timer_running_) timer_cv_.wait(timer_mutex_);
+    }
+    ScopedLock lock(legs_mutex_);
+    while (legs_ > 0) legs_done_.wait(legs_mutex_);
+}
+
+int Hedger::delayMs(Endpoint endpoint, uint64_t now_ns) {
+    if (config_.delay_ms > 0) return config_.delay_ms;
+
+    uint64_t refreshed = atomic_load(&refreshed_ns_[endpoint]);
+    if (refreshed == 0 || now_ns - refreshed >= REFRESH_NS) {
+        const LatencyHistogram& latency = metrics_->endpoint(endpoint).latency;
+        uint64_t delay = 0;
+        if (latency.count() >= static_cast<uint64_t>(config_.min_samples)) {
+            delay = latency.percentile(config_.percentile);
+            if (delay < 1000000ULL) delay = 1000000ULL;
+        }
+        atomic_store(&delay_ns_[endpoint], delay);
+        atomic_store(&refreshed_ns_[endpoint], now_ns);
+    }
+    uint64_t delay = atomic_load(&delay_ns_[endpoint]);
+    return delay > 0 ? static_cast<int>((delay + 999999ULL) / 1000000ULL) : -1;
+}
+
+bool Hedger::takeBudget(uint64_t calls) {
+    /* Approximate under contention: two callers may both take the last slot */
+    uint64_t hedges = atomic_load(&hedges_);
+    if (static_cast<double>(hedges + 1) * 100.0 > config_.budget_percent * static_cast<double>(calls)) {
+        return false;
+    }
+    atomic_add(&hedges_, 1);
+    return true;
+}
+
+bool Hedger::startTimer() {
+    if (!timer_running_ && !stop_) {
+        timer_running_ = start_detached_thread(&Hedger::timerMain, this);
+    }
+    return timer_running_;
+}
+
+void Hedger::timerMain(void* arg) {
+    Hedger* self = static_cast<Hedger*>(arg);
+    ScopedLock lock(self->timer_mutex_);
+    while (!self->stop_) {
+        uint64_t now = monotonic_ns();
+        int wait_ms = -1;
+        for (size_t i = 0; i < self->watched_.size(); ++i) {
+            HedgeCall* call = self->watched_[i];
+            if (call->caller && call->caller->isCancelled()) {
+                /* The first leg runs under its own token; pass the cancel on */
+                call->tokens[0].cancel();
+                call->tokens[1].cancel();
+                call->caller = NULL;
+                call->hedge_decided = true;
+                continue;
+            }
+            if (!call->hedge_decided) {
+                if (now >= call->hedge_at) {
+                    call->hedge_decided = true;
+                    if (self->takeBudget(call->calls)) self->sendHedge(call);
+                } else {
+                    int ms = static_cast<int>((call->hedge_at - now + 999999ULL) / 1000000ULL);
+                    if (wait_ms < 0 || ms < wait_ms) wait_ms = ms;
+                }
+            }
+            if (call->caller && (wait_ms < 0 || wait_ms > CANCEL_POLL_MS)) {
+                wait_ms = CANCEL_POLL_MS;
+            }
+        }
+        if (wait_ms < 0) {
+            self->timer_cv_.wait(self->timer_mutex_);
+        } else {
+            self->timer_cv_.waitFor(self->timer_mutex_, wait_ms);
+        }
+    }
+    self->timer_running_ = false;
+    self->timer_cv_.notifyAll();
+}
+
+void Hedger::sendHedge(HedgeCall* call) {
+    {
+        ScopedLock lock(legs_mutex_);
+        ++legs_;
+    }
+    ScopedLock lock(call->mutex);
+    ++call->refs;
+    if (start_detached_thread(&Hedger::runHedge, call)) {
+        call->hedged = true;
+        metrics_->recordHedge(call->endpoint);
+        return;
+    }
+    --call->refs;
+    ScopedLock legs_lock(legs_mutex_);
+    --legs_;
+    legs_done_.notifyAll();
+}
+
+void Hedger::runHedge(void* arg) {
+    HedgeCall* call = static_cast<HedgeCall*>(arg);
+    Hedger* hedger = call->hedger;
+
+    call->transport->perform(call->requests[1], call->responses[1]);
+    {
+        ScopedLock lock(call->mutex);
+        call->done[1] = true;
+        if (call->winner < 0 && usable(call->responses[1])) {
+            call->winner = 1;
+            /* Frees the caller from the first leg */
+            call->tokens[0].cancel();
+        }
+        call->finished.notifyAll();
+    }
+    call->release();
+
+    ScopedLock lock(hedger->legs_mutex_);
+    --hedger->legs_;
+    hedger->legs_done_.notifyAll();
+}
+
+void Hedger::perform(Transport& transport, Endpoint endpoint,
+                     const HttpRequest& request, HttpResponse& response) {
+    uint64_t calls = atomic_add(&calls_, 1);
+    uint64_t start = monotonic_ns();
+    int delay_ms = delayMs(endpoint, start);
+    if (delay_ms < 0) {
+        transport.perform(request, response);
+        return;
+    }
+
+    HedgeCall* call = new HedgeCall(this, &transport, endpoint, request);
+    call->calls = calls;
+    call->hedge_at = start + static_cast<uint64_t>(delay_ms) * 1000000ULL;
+    bool watched;
+    {
+        ScopedLock lock(timer_mutex_);
+        watched = startTimer();
+        if (watched) {
+            watched_.push_back(call);
+            timer_cv_.notifyAll();
+        }
+    }
+    if (!watched) {
+        delete call;
+        transport.perform(request, response);
+        return;
+    }
+
+    /* The first leg runs here; the timer thread sends the hedge if it is due first */
+    transport.perform(call->requests[0], call->responses[0]);
+    {
+        ScopedLock lock(timer_mutex_);
+        watched_.erase(std::find(watched_.begin(), watched_.end(), call));
+    }
+
+    const CancellationToken* caller = request.cancellation;
+    bool hedged;
+    int winner;
+    {
+        ScopedLock lock(call->mutex);
+        call->done[0] = true;
+        if (call->winner < 0 && usable(call->responses[0])) call->winner = 0;
+        /* A failed first leg waits for the hedge, which may still succeed */
+        while (call->winner < 0 && call->hedged && !call->done[1]) {
+            if (caller && caller->isCancelled()) {
+                call->tokens[1].cancel();
+                caller = NULL;
+                continue;
+            }
+            if (caller) {
+                call->finished.waitFor(call->mutex, CANCEL_POLL_MS);
+            } else {
+                call->finished.wait(call->mutex);
+            }
+        }
+        /* Both failed (or no hedge was sent): report the first leg */
+        winner = call->winner < 0 ? 0 : call->winner;
+        call->tokens[1 - winner].cancel();
+        hedged = call->hedged;
+        response = call->responses[winner];
+    }
+    if (hedged && winner == 1) metrics_->recordHedgeWin(endpoint);
+    call->release();
+}
+
+} // namespace detail
+} // namespace drip
@@ -0,0 +1,101 @@
+#ifndef DRIP_HEDGE_HPP
+#define DRIP_HEDGE_HPP
+
+/*
+ * Hedged requests behind HedgeConfig. Internal header — not installed.
+ */
+
+#include "drip/types.hpp"
+#include "drip/metrics.hpp"
+#include "drip/transport.hpp"
+#include "metrics_registry.hpp"
+#include "sync.hpp"
+
+#include <vector>
+
+namespace drip {
+namespace detail {
+
+struct HedgeCall;
+
+/**
+ * Sends a request, and if it has not answered within the hedge delay, an
+ * identical second one. The first usable response (received, not 5xx)
+ * is returned and the other request is cancelled through its own
+ * CancellationToken; a failed request never wins while the other may
+ * still succeed.
+ *
+ * The SDK is blocking, so the first request ("leg") runs on the calling
+ * thread. One timer thread per Hedger, started with the first hedgeable
+ * call, sends hedges when they are due on a detached thread each; calls
+ * that are not hedged start no thread. A cancelled hedge may outlive the
+ * call that started it; drain() waits for such legs and must run before
+ * the transport is destroyed.
+ */
+class Hedger {
+public:
+    Hedger();
+    ~Hedger();
+
+    /** Hedge delays are derived from the latency histograms in @p metrics. */
+    void configure(const HedgeConfig& config, MetricsRegistry& metrics);
+
+    bool enabled() const { return enabled_; }
+
+    /**
+     * Same contract as Transport::perform(). Falls back to a plain
+     * perform() when no delay is known yet or the timer thread cannot be
+     * started.
+     */
+    void perform(Transport& transport, Endpoint endpoint,
+                 const HttpRequest& request, HttpResponse& response);
+
+    /** Stop the timer thread and block until every hedge sent so far has finished. */
+    void drain();
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    Hedger(const Hedger&);
+    Hedger& operator=(const Hedger&);
+
+    /** Hedge delay for endpoint in ms; -1 while there is too little data. */
+    int delayMs(Endpoint endpoint, uint64_t now_ns);
+
+    /** Claim one hedge from the budget, given `calls` hedgeable requests so far. */
+    bool takeBudget(uint64_t calls);
+
+    /* timer_mutex_ held */
+    bool startTimer();
+    void sendHedge(HedgeCall* call);
+
+    static void timerMain(void* arg);
+    static void runHedge(void* arg);
+
+    HedgeConfig config_;
+    MetricsRegistry* metrics_;
+    bool enabled_;
+
+    volatile uint64_t calls_;
+    volatile uint64_t hedges_;
+
+    /* Cached percentile delay per endpoint, refreshed once a second */
+    volatile uint64_t delay_ns_[ENDPOINT_COUNT];
+    volatile uint64_t refreshed_ns_[ENDPOINT_COUNT];
+
+    /* Calls whose first leg is in flight, watched by the timer thread */
+    Mutex timer_mutex_;
+    CondVar timer_cv_;
+    std::vector<HedgeCall*> watched_;
+    bool timer_running_;
+    bool stop_;
+
+    /* Hedges still running, for drain() */
+    Mutex legs_mutex_;
+    CondVar legs_done_;
+    int legs_;
+};
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_HEDGE_HPP
@@ -0,0 +1,368 @@
+#include "id_cache_file.hpp"
+#include "customer_index.hpp"
+#include "atomic.hpp"
+#include "clock.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace drip {
+namespace detail {
+
+static const char FILE_MAGIC[8] = { 'D', 'R', 'I', 'P', 'I', 'D', 'C', '1' };
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+static const size_t MAX_FIELD = 0xFFFF;
+static const uint64_t MAX_SLOTS = 1ULL << 28;
+
+/** First 64 bytes of the file; every size is in native byte order. */
+struct FileHeader {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t header_size;
+    uint32_t workflow_slots;
+    uint32_t customer_slots;
+    uint32_t workflow_count;
+    uint32_t customer_count;
+    uint64_t workflow_arena;
+    uint64_t customer_arena;
+    int64_t list_offset;
+    int64_t written_ms;
+};
+
+/* C++03: no static_assert */
+typedef char file_header_is_64_bytes[sizeof(FileHeader) == 64 ? 1 : -1];
+
+static bool is_power_of_two(uint64_t n) {
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+IdCacheFile::IdCacheFile()
+    : reload_check_ns_(0)
+    , next_check_ns_(0)
+    , file_dev_(0)
+    , file_ino_(0)
+    , file_mtime_(0)
+    , file_size_(0)
+    , map_(NULL)
+    , map_size_(0)
+    , list_offset_(0)
+    , counters_(NULL)
+{
+    workflows_.slots = NULL;
+    workflows_.slot_count = 0;
+    workflows_.arena = NULL;
+    workflows_.arena_size = 0;
+    customers_ = workflows_;
+}
+
+IdCacheFile::~IdCacheFile() {
+    ScopedLock lock(mutex_);
+    unmap();
+}
+
+void IdCacheFile::configure(const IdCacheConfig& config, MetricsRegistry& metrics) {
+    ScopedLock lock(mutex_);
+    unmap();
+    path_ = config.path;
+    reload_check_ns_ = config.reload_check_ms > 0
+                     ? static_cast<uint64_t>(config.reload_check_ms) * 1000000ULL : 0;
+    counters_ = &metrics.cache(CACHE_ID_CACHE);
+    if (!path_.empty()) {
+        map();
+        next_check_ns_ = monotonic_ns() + reload_check_ns_;
+    }
+}
+
+bool IdCacheFile::findWorkflow(const std::string& slug, std::string& workflow_id,
+                               std::string& workflow_name) {
+    ScopedLock lock(mutex_);
+    maybeReload();
+    std::string value;
+    bool found = lookup(workflows_, slug, value);
+    if (found) {
+        size_t tab = value.find('\t');
+        workflow_id = value.substr(0, tab);
+        workflow_name = tab != std::string::npos ? value.substr(tab + 1) : std::string();
+    }
+    count(found);
+    return found;
+}
+
+bool IdCacheFile::findCustomer(const std::string& external_id, std::string& customer_id) {
+    ScopedLock lock(mutex_);
+    maybeReload();
+    bool found = lookup(customers_, external_id, customer_id);
+    count(found);
+    return found;
+}
+
+int IdCacheFile::listOffset() {
+    ScopedLock lock(mutex_);
+    return list_offset_;
+}
+
+void IdCacheFile::customers(Entries& out) {
+    ScopedLock lock(mutex_);
+    for (size_t i = 0; i < customers_.slot_count; ++i) {
+        const Slot& s = customers_.slots[i];
+        if (s.hash == 0) continue;
+        if (static_cast<size_t>(s.offset) + s.key_len + s.value_len > customers_.arena_size) continue;
+        const char* key = customers_.arena + s.offset;
+        out.push_back(std::make_pair(std::string(key, s.key_len),
+                                     std::string(key + s.key_len, s.value_len)));
+    }
+}
+
+/* Open addressing as in CustomerIndex, sized for a load factor under 0.7. Later duplicates win. */
+void IdCacheFile::buildTable(const Entries& entries, std::vector<Slot>& slots, std::string& arena) {
+    if (entries.empty()) return;
+    size_t capacity = 16;
+    while (capacity * 7 < (entries.size() + 1) * 10) capacity *= 2;
+    Slot empty = { 0, 0, 0, 0 };
+    slots.assign(capacity, empty);
+
+    size_t mask = capacity - 1;
+    for (size_t e = 0; e < entries.size(); ++e) {
+        const std::string& key = entries[e].first;
+        const std::string& value = entries[e].second;
+        if (key.empty() || key.size() > MAX_FIELD || value.size() > MAX_FIELD) continue;
+        uint32_t hash = CustomerIndex::hashKey(key.data(), key.size());
+        size_t i = hash & mask;
+        while (slots[i].hash != 0 &&
+               !(slots[i].hash == hash && slots[i].key_len == key.size() &&
+                 arena.compare(slots[i].offset, key.size(), key) == 0)) {
+            i = (i + 1) & mask;
+        }
+        slots[i].hash = hash;
+        slots[i].offset = static_cast<uint32_t>(arena.size());
+        slots[i].key_len = static_cast<uint16_t>(key.size());
+        slots[i].value_len = static_cast<uint16_t>(value.size());
+        arena.append(key);
+        arena.append(value);
+    }
+}
+
+bool IdCacheFile::lookup(const Table& table, const std::string& key, std::string& value) {
+    if (table.slot_count == 0 || key.empty()) return false;
+    uint32_t hash = CustomerIndex::hashKey(key.data(), key.size());
+    size_t mask = table.slot_count - 1;
+    size_t i = hash & mask;
+    for (size_t n = 0; n < table.slot_count; ++n, i = (i + 1) & mask) {
+        const Slot& s = table.slots[i];
+        if (s.hash == 0) return false;
+        if (s.hash != hash || s.key_len != key.size()) continue;
+        /* A damaged file must not read past the mapping */
+        if (static_cast<size_t>(s.offset) + s.key_len + s.value_len > table.arena_size) return false;
+        if (std::memcmp(table.arena + s.offset, key.data(), key.size()) == 0) {
+            value.assign(table.arena + s.offset + s.key_len, s.value_len);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IdCacheFile::write(const Entries& workflows, const Entries& customers, int list_offset,
+                        std::string& error) {
+    std::vector<Slot> workflow_slots;
+    std::vector<Slot> customer_slots;
+    std::string workflow_arena;
+    std::string customer_arena;
+    buildTable(workflows, workflow_slots, workflow_arena);
+    buildTable(customers, customer_slots, customer_arena);
+    if (workflow_arena.size() > 0xFFFFFFFFULL || customer_arena.size() > 0xFFFFFFFFULL) {
+        error = "id cache too large";
+        return false;
+    }
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.byte_order = BYTE_ORDER_MARK;
+    header.header_size = sizeof(FileHeader);
+    header.workflow_slots = static_cast<uint32_t>(workflow_slots.size());
+    header.customer_slots = static_cast<uint32_t>(customer_slots.size());
+    for (size_t i = 0; i < workflow_slots.size(); ++i) {
+        if (workflow_slots[i].hash != 0) ++header.workflow_count;
+    }
+    for (size_t i = 0; i < customer_slots.size(); ++i) {
+        if (customer_slots[i].hash != 0) ++header.customer_count;
+    }
+    header.workflow_arena = workflow_arena.size();
+    header.customer_arena = customer_arena.size();
+    header.list_offset = list_offset;
+    header.written_ms = static_cast<int64_t>(std::time(NULL)) * 1000;
+
+    /* Written beside the target, then renamed over it */
+    std::ostringstream tmp;
+#ifdef _WIN32
+    tmp << path_ << ".tmp." << _getpid();
+#else
+    tmp << path_ << ".tmp." << getpid();
+#endif
+    std::string tmp_path = tmp.str();
+    std::FILE* f = std::fopen(tmp_path.c_str(), "wb");
+    if (!f) {
+        error = "Failed to open " + tmp_path + ": " + std::strerror(errno);
+        return false;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1;
+    if (ok && !workflow_slots.empty()) {
+        ok = std::fwrite(&workflow_slots[0], sizeof(Slot), workflow_slots.size(), f) == workflow_slots.size();
+    }
+    if (ok && !customer_slots.empty()) {
+        ok = std::fwrite(&customer_slots[0], sizeof(Slot), customer_slots.size(), f) == customer_slots.size();
+    }
+    if (ok) ok = std::fwrite(workflow_arena.data(), 1, workflow_arena.size(), f) == workflow_arena.size();
+    if (ok) ok = std::fwrite(customer_arena.data(), 1, customer_arena.size(), f) == customer_arena.size();
+    if (std::fclose(f) != 0) ok = false;
+#ifdef _WIN32
+    if (ok) ok = MoveFileExA(tmp_path.c_str(), path_.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    if (ok) ok = std::rename(tmp_path.c_str(), path_.c_str()) == 0;
+#endif
+    if (!ok) {
+        error = "Failed to write " + path_ + ": " + std::strerror(errno);
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    ScopedLock lock(mutex_);
+    unmap();
+    map();
+    next_check_ns_ = monotonic_ns() + reload_check_ns_;
+    return true;
+}
+
+/* mutex_ held. Remap if another process replaced the file. */
+void IdCacheFile::maybeReload() {
+    if (path_.empty() || reload_check_ns_ == 0) return;
+    uint64_t now = monotonic_ns();
+    if (now < next_check_ns_) return;
+    next_check_ns_ = now + reload_check_ns_;
+
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path_.c_str(), &st) != 0) return;
+#else
+    struct stat st;
+    if (::stat(path_.c_str(), &st) != 0) return;   /* Removed: keep the old view */
+#endif
+    if (static_cast<uint64_t>(st.st_dev) == file_dev_ && static_cast<uint64_t>(st.st_ino) == file_ino_ &&
+        static_cast<int64_t>(st.st_mtime) == file_mtime_ && static_cast<uint64_t>(st.st_size) == file_size_) {
+        return;
+    }
+    unmap();
+    map();
+}
+
+/* mutex_ held. Map path_ and check its header; false leaves nothing mapped. */
+bool IdCacheFile::map() {
+    void* data = NULL;
+    size_t size = 0;
+#ifdef _WIN32
+    /* No shared mapping here: read the file into memory */
+    struct _stat64 st;
+    if (_stat64(path_.c_str(), &st) != 0) return false;
+    std::FILE* f = std::fopen(path_.c_str(), "rb");
+    if (!f) return false;
+    size = static_cast<size_t>(st.st_size);
+    data = size > 0 ? std::malloc(size) : NULL;
+    bool read = data && std::fread(data, 1, size, f) == size;
+    std::fclose(f);
+    if (!read) {
+        std::free(data);
+        return false;
+    }
+#else
+    int fd = ::open(path_.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(st.st_size);
+    data = ::mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) return false;
+#endif
+    /* Remember the file even if it is unusable, so it is not re-read until replaced */
+    file_dev_ = static_cast<uint64_t>(st.st_dev);
+    file_ino_ = static_cast<uint64_t>(st.st_ino);
+    file_mtime_ = static_cast<int64_t>(st.st_mtime);
+    file_size_ = static_cast<uint64_t>(st.st_size);
+    map_ = data;
+    map_size_ = size;
+
+    const FileHeader* h = static_cast<const FileHeader*>(data);
+    bool valid = size >= sizeof(FileHeader) &&
+                 std::memcmp(h->magic, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0 &&
+                 h->byte_order == BYTE_ORDER_MARK && h->header_size == sizeof(FileHeader) &&
+                 (h->workflow_slots == 0 || is_power_of_two(h->workflow_slots)) &&
+                 (h->customer_slots == 0 || is_power_of_two(h->customer_slots)) &&
+                 h->workflow_slots <= MAX_SLOTS && h->customer_slots <= MAX_SLOTS &&
+                 h->workflow_arena <= 0xFFFFFFFFULL && h->customer_arena <= 0xFFFFFFFFULL &&
+                 sizeof(FileHeader) + (static_cast<uint64_t>(h->workflow_slots) + h->customer_slots) * sizeof(Slot)
+                     + h->workflow_arena + h->customer_arena == size;
+    if (!valid) {
+        unmap();
+        return false;
+    }
+
+    const char* base = static_cast<const char*>(data);
+    const char* slots = base + sizeof(FileHeader);
+    workflows_.slots = reinterpret_cast<const Slot*>(slots);
+    workflows_.slot_count = h->workflow_slots;
+    customers_.slots = reinterpret_cast<const Slot*>(slots + h->workflow_slots * sizeof(Slot));
+    customers_.slot_count = h->customer_slots;
+    workflows_.arena = slots + (static_cast<size_t>(h->workflow_slots) + h->customer_slots) * sizeof(Slot);
+    workflows_.arena_size = static_cast<size_t>(h->workflow_arena);
+    customers_.arena = workflows_.arena + workflows_.arena_size;
+    customers_.arena_size = static_cast<size_t>(h->customer_arena);
+    list_offset_ = h->list_offset > 0 && h->list_offset < 0x7FFFFFFF ? static_cast<int>(h->list_offset) : 0;
+    if (counters_) atomic_store(&counters_->entries, static_cast<uint64_t>(h->workflow_count) + h->customer_count);
+    return true;
+}
+
+/* mutex_ held. The file identity is kept so an unusable file is not retried. */
+void IdCacheFile::unmap() {
+    if (map_) {
+#ifdef _WIN32
+        std::free(map_);
+#else
+        ::munmap(map_, map_size_);
+#endif
+    }
+    map_ = NULL;
+    map_size_ = 0;
+    workflows_.slots = NULL;
+    workflows_.slot_count = 0;
+    workflows_.arena = NULL;
+    workflows_.arena_size = 0;
+    customers_ = workflows_;
+    list_offset_ = 0;
+    if (counters_) atomic_store(&counters_->entries, 0);
+}
+
+/* mutex_ held */
+void IdCacheFile::count(bool hit) {
+    atomic_add(hit ? &counters_->hits : &counters_->misses, 1);
+}
+
+} // namespace detail
+} // namespace drip
@@ -0,0 +1,129 @@
+#ifndef DRIP_ID_CACHE_FILE_HPP
+#define DRIP_ID_CACHE_FILE_HPP
+
+/*
+ * Memory-mapped on-disk cache of workflow slug and external customer id
+ * mappings (IdCacheConfig). Internal header — not installed.
+ */
+
+#include "drip/types.hpp"
+#include "metrics_registry.hpp"
+#include "sync.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/* C++03: use <stdint.h> instead of <cstdint> */
+#include <stdint.h>
+
+namespace drip {
+namespace detail {
+
+/**
+ * Read-only view of an id cache file, looked up in place. The file holds
+ * two open-addressing tables laid out like CustomerIndex (12-byte slots
+ * over a key/value arena), so opening it is a stat, an mmap and a header
+ * check; nothing is parsed or copied. Pages are shared with every other
+ * process mapping the same file.
+ *
+ * Layout (native byte order; a file written on another architecture is
+ * ignored):
+ *
+ *   64-byte header   magic "DRIPIDC1", sizes, customer list offset
+ *   workflow slots   workflow_slots * 12 bytes
+ *   customer slots   customer_slots * 12 bytes
+ *   workflow arena   slug, then "id\tname"
+ *   customer arena   external id, then customer id
+ *
+ * write() builds a new file next to the old one and renames it over it,
+ * so readers never see a partial file; a process still mapping the old
+ * one keeps a consistent view until it remaps. Lookups check at most once
+ * per reload_check_ms whether the file was replaced and remap it.
+ *
+ * Thread-safe behind one mutex.
+ */
+class IdCacheFile {
+public:
+    typedef std::vector<std::pair<std::string, std::string> > Entries;
+
+    IdCacheFile();
+    ~IdCacheFile();
+
+    /** Maps the file if it exists. Counters are published to @p metrics under CACHE_ID_CACHE. */
+    void configure(const IdCacheConfig& config, MetricsRegistry& metrics);
+
+    bool enabled() const { return !path_.empty(); }
+
+    /** Look up a workflow by slug; counts a hit or miss. */
+    bool findWorkflow(const std::string& slug, std::string& workflow_id, std::string& workflow_name);
+
+    /** Look up a customer by external id; counts a hit or miss. */
+    bool findCustomer(const std::string& external_id, std::string& customer_id);
+
+    /** Customer list offset the file was written at (0 without a file). */
+    int listOffset();
+
+    /** Append the mapped file's customer entries to @p out. */
+    void customers(Entries& out);
+
+    /**
+     * Replace the file with these mappings and map it. @p workflows values
+     * are "id\tname". False with @p error set if the file could not be
+     * written; the old mapping then stays in use.
+     */
+    bool write(const Entries& workflows, const Entries& customers, int list_offset,
+               std::string& error);
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    IdCacheFile(const IdCacheFile&);
+    IdCacheFile& operator=(const IdCacheFile&);
+
+    struct Slot {
+        uint32_t hash;
+        uint32_t offset;
+        uint16_t key_len;
+        uint16_t value_len;
+    };
+
+    /** A mapped table: slots plus the arena their offsets point into. */
+    struct Table {
+        const Slot* slots;
+        size_t slot_count;   /* Power of two, or 0 */
+        const char* arena;
+        size_t arena_size;
+    };
+
+    static void buildTable(const Entries& entries, std::vector<Slot>& slots, std::string& arena);
+    static bool lookup(const Table& table, const std::string& key, std::string& value);
+
+    /* mutex_ held */
+    void maybeReload();
+    bool map();
+    void unmap();
+    void count(bool hit);
+
+    Mutex mutex_;
+    std::string path_;
+    uint64_t reload_check_ns_;
+    uint64_t next_check_ns_;   /* monotonic_ns() of the next replacement check */
+
+    /* Identity of the mapped file, to notice a rename over it */
+    uint64_t file_dev_;
+    uint64_t file_ino_;
+    int64_t file_mtime_;
+    uint64_t file_size_;
+
+    void* map_;                /* Whole file; NULL when nothing is mapped */
+    size_t map_size_;
+    Table workflows_;
+    Table customers_;
+    int list_offset_;
+    CacheCounters* counters_;
+};
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_ID_CACHE_FILE_HPP
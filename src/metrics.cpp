@@ -0,0 +1,563 @@
+#include "metrics_registry.hpp"
+#include "atomic.hpp"
+
+#include <cstdio>
+#include <cstdarg>
+
+namespace drip {
+
+namespace detail {
+
+// =============================================================================
+// Bucket math
+// =============================================================================
+
+/** Index of the highest set bit (v must be non-zero). */
+static int highest_bit(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(v);
+#else
+    int n = 0;
+    while (v >>= 1) ++n;
+    return n;
+#endif
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t v) {
+    if (v < static_cast<uint64_t>(SUB_BUCKETS)) {
+        return static_cast<size_t>(v);
+    }
+    int e = highest_bit(v);
+    if (e > MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    size_t sub = static_cast<size_t>((v >> (e - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return static_cast<size_t>(e - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(size_t index) {
+    if (index < static_cast<size_t>(SUB_BUCKETS)) {
+        return index;
+    }
+    int e = static_cast<int>(index / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+    uint64_t sub = index % SUB_BUCKETS;
+    return (static_cast<uint64_t>(SUB_BUCKETS) + sub) << (e - SUB_BUCKET_BITS);
+}
+
+// =============================================================================
+// LatencyHistogram
+// =============================================================================
+
+LatencyHistogram::LatencyHistogram()
+    : count_(0)
+    , sum_(0)
+    , min_(~static_cast<uint64_t>(0))
+    , max_(0)
+{
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) buckets_[i] = 0;
+}
+
+void LatencyHistogram::record(uint64_t value_ns) {
+    atomic_add(&buckets_[bucketIndex(value_ns)], 1);
+    atomic_add(&count_, 1);
+    atomic_add(&sum_, value_ns);
+    atomic_min(&min_, value_ns);
+    atomic_max(&max_, value_ns);
+}
+
+void LatencyHistogram::snapshot(HistogramSnapshot& out) const {
+    out.counts.resize(BUCKET_COUNT);
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        out.counts[i] = atomic_load(&buckets_[i]);
+        total += out.counts[i];
+    }
+    /* Derive count from the buckets so percentiles stay self-consistent. */
+    out.count = total;
+    out.sum_ns = atomic_load(&sum_);
+    out.max_ns = atomic_load(&max_);
+    out.min_ns = total > 0 ? atomic_load(&min_) : 0;
+}
+
+void LatencyHistogram::cumulativeCounts(const uint64_t* bounds_ns, size_t n,
+                                        uint64_t* cumulative) const {
+    for (size_t b = 0; b <= n; ++b) cumulative[b] = 0;
+    size_t b = 0;
+    uint64_t running = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        uint64_t upper = bucketLowerBound(i + 1);
+        while (b < n && upper > bounds_ns[b] + 1) {
+            cumulative[b++] = running;
+        }
+        running += atomic_load(&buckets_[i]);
+    }
+    while (b < n) cumulative[b++] = running;
+    cumulative[n] = running;
+}
+
+uint64_t LatencyHistogram::sum() const {
+    return atomic_load(&sum_);
+}
+
+uint64_t LatencyHistogram::count() const {
+    return atomic_load(&count_);
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    uint64_t total = atomic_load(&count_);
+    if (total == 0) return 0;
+    uint64_t lo = atomic_load(&min_);
+    uint64_t hi = atomic_load(&max_);
+    if (p <= 0) return lo;
+    if (p >= 100) return hi;
+
+    double target = p / 100.0 * static_cast<double>(total);
+    uint64_t rank = static_cast<uint64_t>(target);
+    if (static_cast<double>(rank) < target) ++rank;
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i + 1 < BUCKET_COUNT; ++i) {
+        seen += atomic_load(&buckets_[i]);
+        if (seen >= rank) {
+            uint64_t v = bucketLowerBound(i + 1) - 1;
+            if (v > hi) v = hi;
+            if (v < lo) v = lo;
+            return v;
+        }
+    }
+    return hi;
+}
+
+// =============================================================================
+// MetricsRegistry
+// =============================================================================
+
+EndpointCounters::EndpointCounters()
+    : requests(0)
+    , retries(0)
+    , failovers(0)
+    , bytes_sent(0)
+    , bytes_received(0)
+    , serialize_ns(0)
+    , parse_ns(0)
+    , connections_reused(0)
+    , connections_opened(0)
+    , circuit_state(CIRCUIT_CLOSED)
+    , circuit_opens(0)
+    , circuit_rejections(0)
+    , hedges(0)
+    , hedge_wins(0)
+    , coalesced(0)
+{
+    for (int i = 0; i < ERROR_KIND_COUNT; ++i) errors[i] = 0;
+    for (int i = 0; i < TRANSFER_PHASE_COUNT; ++i) phase_ns[i] = 0;
+}
+
+CacheCounters::CacheCounters()
+    : hits(0)
+    , negative_hits(0)
+    , misses(0)
+    , evictions(0)
+    , entries(0)
+{}
+
+void MetricsRegistry::recordRequest(Endpoint e, uint64_t latency_ns,
+                                    uint64_t bytes_sent, uint64_t bytes_received) {
+    EndpointCounters& c = endpoints_[e];
+    atomic_add(&c.requests, 1);
+    atomic_add(&c.bytes_sent, bytes_sent);
+    atomic_add(&c.bytes_received, bytes_received);
+    c.latency.record(latency_ns);
+}
+
+void MetricsRegistry::recordError(Endpoint e, ErrorKind kind) {
+    atomic_add(&endpoints_[e].errors[kind], 1);
+}
+
+void MetricsRegistry::recordRetry(Endpoint e) {
+    atomic_add(&endpoints_[e].retries, 1);
+}
+
+void MetricsRegistry::recordFailover(Endpoint e) {
+    atomic_add(&endpoints_[e].failovers, 1);
+}
+
+void MetricsRegistry::recordSerialize(Endpoint e, uint64_t ns) {
+    atomic_add(&endpoints_[e].serialize_ns, ns);
+    serialize_.record(ns);
+}
+
+void MetricsRegistry::recordParse(Endpoint e, uint64_t ns) {
+    atomic_add(&endpoints_[e].parse_ns, ns);
+    parse_.record(ns);
+}
+
+void MetricsRegistry::recordPhases(Endpoint e, const uint64_t (&phase_ns)[TRANSFER_PHASE_COUNT],
+                                   bool reused) {
+    EndpointCounters& c = endpoints_[e];
+    for (int i = 0; i < TRANSFER_PHASE_COUNT; ++i) {
+        if (phase_ns[i] > 0) atomic_add(&c.phase_ns[i], phase_ns[i]);
+    }
+    atomic_add(reused ? &c.connections_reused : &c.connections_opened, 1);
+}
+
+void MetricsRegistry::recordCircuitState(Endpoint e, CircuitState state) {
+    EndpointCounters& c = endpoints_[e];
+    atomic_store(&c.circuit_state, static_cast<uint64_t>(state));
+    if (state == CIRCUIT_OPEN) atomic_add(&c.circuit_opens, 1);
+}
+
+void MetricsRegistry::recordCircuitRejection(Endpoint e) {
+    atomic_add(&endpoints_[e].circuit_rejections, 1);
+}
+
+void MetricsRegistry::recordHedge(Endpoint e) {
+    atomic_add(&endpoints_[e].hedges, 1);
+}
+
+void MetricsRegistry::recordHedgeWin(Endpoint e) {
+    atomic_add(&endpoints_[e].hedge_wins, 1);
+}
+
+void MetricsRegistry::recordCoalesced(Endpoint e) {
+    atomic_add(&endpoints_[e].coalesced, 1);
+}
+
+void MetricsRegistry::snapshot(MetricsSnapshot& out) const {
+    for (int i = 0; i < ENDPOINT_COUNT; ++i) {
+        const EndpointCounters& c = endpoints_[i];
+        EndpointMetrics& m = out.endpoints[i];
+        m.requests = atomic_load(&c.requests);
+        for (int k = 0; k < ERROR_KIND_COUNT; ++k) {
+            m.errors[k] = atomic_load(&c.errors[k]);
+        }
+        m.retries = atomic_load(&c.retries);
+        m.failovers = atomic_load(&c.failovers);
+        m.bytes_sent = atomic_load(&c.bytes_sent);
+        m.bytes_received = atomic_load(&c.bytes_received);
+        m.serialize_ns = atomic_load(&c.serialize_ns);
+        m.parse_ns = atomic_load(&c.parse_ns);
+        for (int p = 0; p < TRANSFER_PHASE_COUNT; ++p) {
+            m.phase_ns[p] = atomic_load(&c.phase_ns[p]);
+        }
+        m.connections_reused = atomic_load(&c.connections_reused);
+        m.connections_opened = atomic_load(&c.connections_opened);
+        m.circuit_state = static_cast<CircuitState>(atomic_load(&c.circuit_state));
+        m.circuit_opens = atomic_load(&c.circuit_opens);
+        m.circuit_rejections = atomic_load(&c.circuit_rejections);
+        m.hedges = atomic_load(&c.hedges);
+        m.hedge_wins = atomic_load(&c.hedge_wins);
+        m.coalesced = atomic_load(&c.coalesced);
+        c.latency.snapshot(m.latency);
+    }
+    serialize_.snapshot(out.serialize);
+    parse_.snapshot(out.parse);
+    for (int k = 0; k < CACHE_KIND_COUNT; ++k) {
+        const CacheCounters& c = caches_[k];
+        CacheMetrics& m = out.caches[k];
+        m.negative_hits = atomic_load(&c.negative_hits);
+        m.hits = atomic_load(&c.hits) + m.negative_hits;
+        m.misses = atomic_load(&c.misses);
+        m.evictions = atomic_load(&c.evictions);
+        m.entries = atomic_load(&c.entries);
+    }
+}
+
+// =============================================================================
+// Prometheus exposition
+// =============================================================================
+
+/* Request latency buckets: 500us .. 30s */
+static const uint64_t LATENCY_BOUNDS_NS[] = {
+    500000ULL, 1000000ULL, 2500000ULL, 5000000ULL, 10000000ULL, 25000000ULL,
+    50000000ULL, 100000000ULL, 250000000ULL, 500000000ULL, 1000000000ULL,
+    2500000000ULL, 5000000000ULL, 10000000000ULL, 30000000000ULL
+};
+
+/* Serialize / parse buckets: 1us .. 10ms */
+static const uint64_t CPU_BOUNDS_NS[] = {
+    1000ULL, 5000ULL, 10000ULL, 50000ULL, 100000ULL, 500000ULL,
+    1000000ULL, 5000000ULL, 10000000ULL
+};
+
+static const size_t MAX_BOUNDS = sizeof(LATENCY_BOUNDS_NS) / sizeof(LATENCY_BOUNDS_NS[0]);
+
+/** Appends formatted lines through one stack buffer; no per-line allocation. */
+class PromWriter {
+public:
+    explicit PromWriter(std::string& out) : out_(out) {}
+
+    void header(const char* name, const char* type, const char* help) {
+        append("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    }
+
+    void counter(const char* name, const char* labels, uint64_t v) {
+        append("%s{%s} %llu\n", name, labels, static_cast<unsigned long long>(v));
+    }
+
+    void seconds(const char* name, const char* labels, uint64_t ns) {
+        append("%s{%s} %.9g\n", name, labels, static_cast<double>(ns) / 1e9);
+    }
+
+    void histogram(const char* name, const char* labels, const LatencyHistogram& h,
+                   const uint64_t* bounds, size_t n) {
+        uint64_t cumulative[MAX_BOUNDS + 1];
+        h.cumulativeCounts(bounds, n, cumulative);
+        const char* sep = labels[0] != '\0' ? "," : "";
+        for (size_t i = 0; i < n; ++i) {
+            append("%s_bucket{%s%sle=\"%.9g\"} %llu\n", name, labels, sep,
+                   static_cast<double>(bounds[i]) / 1e9,
+                   static_cast<unsigned long long>(cumulative[i]));
+        }
+        append("%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, sep,
+               static_cast<unsigned long long>(cumulative[n]));
+        append("%s_sum{%s} %.9g\n", name, labels, static_cast<double>(h.sum()) / 1e9);
+        append("%s_count{%s} %llu\n", name, labels,
+               static_cast<unsigned long long>(cumulative[n]));
+    }
+
+private:
+    void append(const char* fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf_, sizeof(buf_), fmt, args);
+        va_end(args);
+        if (n > 0) {
+            out_.append(buf_, static_cast<size_t>(n) < sizeof(buf_) ? static_cast<size_t>(n)
+                                                                    : sizeof(buf_) - 1);
+        }
+    }
+
+    std::string& out_;
+    char buf_[256];
+};
+
+void MetricsRegistry::renderPrometheus(std::string& out) const {
+    /* Endpoints that have never been called are omitted. */
+    bool active[ENDPOINT_COUNT];
+    char labels[ENDPOINT_COUNT][48];
+    size_t active_count = 0;
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        active[e] = atomic_load(&endpoints_[e].requests) > 0;
+        if (active[e]) ++active_count;
+        std::snprintf(labels[e], sizeof(labels[e]), "endpoint=\"%s\"",
+                      endpoint_to_string(static_cast<Endpoint>(e)));
+    }
+    out.reserve(out.size() + 1024 + active_count * 3072);
+
+    PromWriter w(out);
+    char lbl[sizeof(labels) + 64];
+
+    w.header("drip_requests_total", "counter", "HTTP requests sent by the Drip SDK.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (active[e]) w.counter("drip_requests_total", labels[e], atomic_load(&endpoints_[e].requests));
+    }
+
+    w.header("drip_errors_total", "counter", "Failed HTTP requests by error kind.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (!active[e]) continue;
+        for (int k = 0; k < ERROR_KIND_COUNT; ++k) {
+            std::snprintf(lbl, sizeof(lbl), "%s,kind=\"%s\"", labels[e],
+                          error_kind_to_string(static_cast<ErrorKind>(k)));
+            w.counter("drip_errors_total", lbl, atomic_load(&endpoints_[e].errors[k]));
+        }
+    }
+
+    w.header("drip_retries_total", "counter", "HTTP requests re-sent after a retryable failure.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (active[e]) w.counter("drip_retries_total", labels[e], atomic_load(&endpoints_[e].retries));
+    }
+
+    w.header("drip_failovers_total", "counter", "HTTP requests re-sent to another base URL.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (active[e]) w.counter("drip_failovers_total", labels[e], atomic_load(&endpoints_[e].failovers));
+    }
+
+    w.header("drip_sent_bytes_total", "counter", "Request bytes sent, headers included.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (active[e]) w.counter("drip_sent_bytes_total", labels[e], atomic_load(&endpoints_[e].bytes_sent));
+    }
+
+    w.header("drip_received_bytes_total", "counter", "Response bytes received, headers included.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (active[e]) w.counter("drip_received_bytes_total", labels[e], atomic_load(&endpoints_[e].bytes_received));
+    }
+
+    w.header("drip_connections_total", "counter", "Connections used, by whether they were reused.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (!active[e]) continue;
+        std::snprintf(lbl, sizeof(lbl), "%s,state=\"reused\"", labels[e]);
+        w.counter("drip_connections_total", lbl, atomic_load(&endpoints_[e].connections_reused));
+        std::snprintf(lbl, sizeof(lbl), "%s,state=\"opened\"", labels[e]);
+        w.counter("drip_connections_total", lbl, atomic_load(&endpoints_[e].connections_opened));
+    }
+
+    w.header("drip_transfer_phase_seconds_total", "counter", "Time spent per transfer phase.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (!active[e]) continue;
+        for (int p = 0; p < TRANSFER_PHASE_COUNT; ++p) {
+            std::snprintf(lbl, sizeof(lbl), "%s,phase=\"%s\"", labels[e],
+                          transfer_phase_to_string(static_cast<TransferPhase>(p)));
+            w.seconds("drip_transfer_phase_seconds_total", lbl, atomic_load(&endpoints_[e].phase_ns[p]));
+        }
+    }
+
+    w.header("drip_circuit_state", "gauge", "Circuit breaker state: 0 closed, 1 open, 2 half-open.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (active[e]) w.counter("drip_circuit_state", labels[e], atomic_load(&endpoints_[e].circuit_state));
+    }
+
+    w.header("drip_circuit_opens_total", "counter", "Times the circuit breaker opened.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (active[e]) w.counter("drip_circuit_opens_total", labels[e], atomic_load(&endpoints_[e].circuit_opens));
+    }
+
+    w.header("drip_circuit_rejections_total", "counter", "Calls failed fast by an open circuit breaker.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (active[e]) w.counter("drip_circuit_rejections_total", labels[e], atomic_load(&endpoints_[e].circuit_rejections));
+    }
+
+    w.header("drip_hedges_total", "counter", "Hedge requests sent for slow reads.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (active[e]) w.counter("drip_hedges_total", labels[e], atomic_load(&endpoints_[e].hedges));
+    }
+
+    w.header("drip_hedge_wins_total", "counter", "Hedge requests that answered before the original.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (active[e]) w.counter("drip_hedge_wins_total", labels[e], atomic_load(&endpoints_[e].hedge_wins));
+    }
+
+    w.header("drip_coalesced_requests_total", "counter", "GETs answered by an identical request already in flight.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (active[e]) w.counter("drip_coalesced_requests_total", labels[e], atomic_load(&endpoints_[e].coalesced));
+    }
+
+    w.header("drip_serialize_seconds_total", "counter", "Time spent serializing request bodies.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (active[e]) w.seconds("drip_serialize_seconds_total", labels[e], atomic_load(&endpoints_[e].serialize_ns));
+    }
+
+    w.header("drip_parse_seconds_total", "counter", "Time spent parsing response bodies.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (active[e]) w.seconds("drip_parse_seconds_total", labels[e], atomic_load(&endpoints_[e].parse_ns));
+    }
+
+    w.header("drip_request_duration_seconds", "histogram", "HTTP request latency.");
+    for (int e = 0; e < ENDPOINT_COUNT; ++e) {
+        if (active[e]) {
+            w.histogram("drip_request_duration_seconds", labels[e], endpoints_[e].latency,
+                        LATENCY_BOUNDS_NS, MAX_BOUNDS);
+        }
+    }
+
+    /* Caches that have never been looked up in (usually: disabled) are omitted. */
+    bool cache_active[CACHE_KIND_COUNT];
+    char cache_labels[CACHE_KIND_COUNT][32];
+    for (int k = 0; k < CACHE_KIND_COUNT; ++k) {
+        const CacheCounters& c = caches_[k];
+        cache_active[k] = atomic_load(&c.hits) + atomic_load(&c.negative_hits) +
+                          atomic_load(&c.misses) > 0;
+        std::snprintf(cache_labels[k], sizeof(cache_labels[k]), "cache=\"%s\"",
+                      cache_kind_to_string(static_cast<CacheKind>(k)));
+    }
+
+    w.header("drip_cache_lookups_total", "counter", "In-process cache lookups by result.");
+    for (int k = 0; k < CACHE_KIND_COUNT; ++k) {
+        if (!cache_active[k]) continue;
+        const CacheCounters& c = caches_[k];
+        std::snprintf(lbl, sizeof(lbl), "%s,result=\"hit\"", cache_labels[k]);
+        w.counter("drip_cache_lookups_total", lbl, atomic_load(&c.hits));
+        std::snprintf(lbl, sizeof(lbl), "%s,result=\"negative_hit\"", cache_labels[k]);
+        w.counter("drip_cache_lookups_total", lbl, atomic_load(&c.negative_hits));
+        std::snprintf(lbl, sizeof(lbl), "%s,result=\"miss\"", cache_labels[k]);
+        w.counter("drip_cache_lookups_total", lbl, atomic_load(&c.misses));
+    }
+
+    w.header("drip_cache_evictions_total", "counter", "Cache entries dropped to stay within capacity.");
+    for (int k = 0; k < CACHE_KIND_COUNT; ++k) {
+        if (cache_active[k]) w.counter("drip_cache_evictions_total", cache_labels[k], atomic_load(&caches_[k].evictions));
+    }
+
+    w.header("drip_cache_entries", "gauge", "Entries currently cached.");
+    for (int k = 0; k < CACHE_KIND_COUNT; ++k) {
+        if (cache_active[k]) w.counter("drip_cache_entries", cache_labels[k], atomic_load(&caches_[k].entries));
+    }
+
+    const size_t cpu_bounds = sizeof(CPU_BOUNDS_NS) / sizeof(CPU_BOUNDS_NS[0]);
+    w.header("drip_serialize_duration_seconds", "histogram", "Per-request body serialization time.");
+    w.histogram("drip_serialize_duration_seconds", "", serialize_, CPU_BOUNDS_NS, cpu_bounds);
+    w.header("drip_parse_duration_seconds", "histogram", "Per-request response parse time.");
+    w.histogram("drip_parse_duration_seconds", "", parse_, CPU_BOUNDS_NS, cpu_bounds);
+}
+
+/** True if path is prefix exactly or prefix followed by '/' or '?'. */
+static bool path_is(const std::string& path, const char* prefix) {
+    size_t n = 0;
+    while (prefix[n] != '\0') ++n;
+    if (path.compare(0, n, prefix) != 0) return false;
+    return path.size() == n || path[n] == '/' || path[n] == '?';
+}
+
+Endpoint MetricsRegistry::classify(const std::string& path) {
+    if (path_is(path, "/run-events/batch")) return ENDPOINT_RUN_EVENTS_BATCH;
+    if (path_is(path, "/run-events"))       return ENDPOINT_RUN_EVENTS;
+    if (path_is(path, "/runs"))             return ENDPOINT_RUNS;
+    if (path_is(path, "/usage/internal"))   return ENDPOINT_USAGE;
+    if (path_is(path, "/customers"))        return ENDPOINT_CUSTOMERS;
+    if (path_is(path, "/workflows"))        return ENDPOINT_WORKFLOWS;
+    if (path_is(path, "/health"))           return ENDPOINT_HEALTH;
+    return ENDPOINT_OTHER;
+}
+
+} // namespace detail
+
+// =============================================================================
+// HistogramSnapshot
+// =============================================================================
+
+size_t HistogramSnapshot::bucketCount() {
+    return detail::LatencyHistogram::BUCKET_COUNT;
+}
+
+uint64_t HistogramSnapshot::bucketLowerBound(size_t i) {
+    return detail::LatencyHistogram::bucketLowerBound(i);
+}
+
+uint64_t HistogramSnapshot::bucketUpperBound(size_t i) {
+    if (i + 1 >= bucketCount()) {
+        return ~static_cast<uint64_t>(0);
+    }
+    return detail::LatencyHistogram::bucketLowerBound(i + 1);
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if (count == 0) return 0;
+    if (p <= 0) return min_ns;
+    if (p >= 100) return max_ns;
+
+    double target = p / 100.0 * static_cast<double>(count);
+    uint64_t rank = static_cast<uint64_t>(target);
+    if (static_cast<double>(rank) < target) ++rank;
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            /* Report the highest value equivalent to this bucket. */
+            uint64_t v = bucketUpperBound(i) - 1;
+            if (v > max_ns) v = max_ns;
+            if (v < min_ns) v = min_ns;
+            return v;
+        }
+    }
+    return max_ns;
+}
+
+double HistogramSnapshot::mean() const {
+    if (count == 0) return 0;
+    return static_cast<double>(sum_ns) / static_cast<double>(count);
+}
+
+} // namespace drip
@@ -0,0 +1,142 @@
+#ifndef DRIP_METRICS_REGISTRY_HPP
+#define DRIP_METRICS_REGISTRY_HPP
+
+/*
+ * Lock-free metric storage behind Client::metrics(). Internal header —
+ * not installed.
+ */
+
+#include "drip/metrics.hpp"
+
+#include <string>
+
+namespace drip {
+namespace detail {
+
+/**
+ * Log-linear histogram with atomic buckets. record() is wait-free apart
+ * from the min/max CAS loops, which only spin while another thread is
+ * setting a new extreme.
+ */
+class LatencyHistogram {
+public:
+    enum {
+        SUB_BUCKET_BITS = 4,
+        SUB_BUCKETS = 1 << SUB_BUCKET_BITS,
+        MAX_EXPONENT = 44,   /* 2^45 ns is ~9.7 hours; larger values clamp */
+        BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS
+    };
+
+    LatencyHistogram();
+
+    void record(uint64_t value_ns);
+    void snapshot(HistogramSnapshot& out) const;
+
+    /**
+     * Cumulative counts for the given ascending upper bounds (ns), read
+     * straight from the live buckets. cumulative[n] receives the total.
+     * A bucket straddling a bound counts toward the next bound.
+     */
+    void cumulativeCounts(const uint64_t* bounds_ns, size_t n, uint64_t* cumulative) const;
+
+    uint64_t sum() const;
+    uint64_t count() const;
+
+    /** HistogramSnapshot::percentile() over the live buckets, without copying them. */
+    uint64_t percentile(double p) const;
+
+    static size_t bucketIndex(uint64_t value_ns);
+    static uint64_t bucketLowerBound(size_t index);
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    LatencyHistogram(const LatencyHistogram&);
+    LatencyHistogram& operator=(const LatencyHistogram&);
+
+    volatile uint64_t buckets_[BUCKET_COUNT];
+    volatile uint64_t count_;
+    volatile uint64_t sum_;
+    volatile uint64_t min_;
+    volatile uint64_t max_;
+};
+
+/** Live counters for one endpoint family; see EndpointMetrics. */
+struct EndpointCounters {
+    volatile uint64_t requests;
+    volatile uint64_t errors[ERROR_KIND_COUNT];
+    volatile uint64_t retries;
+    volatile uint64_t failovers;
+    volatile uint64_t bytes_sent;
+    volatile uint64_t bytes_received;
+    volatile uint64_t serialize_ns;
+    volatile uint64_t parse_ns;
+    volatile uint64_t phase_ns[TRANSFER_PHASE_COUNT];
+    volatile uint64_t connections_reused;
+    volatile uint64_t connections_opened;
+    volatile uint64_t circuit_state;   /* CircuitState */
+    volatile uint64_t circuit_opens;
+    volatile uint64_t circuit_rejections;
+    volatile uint64_t hedges;
+    volatile uint64_t hedge_wins;
+    volatile uint64_t coalesced;
+    LatencyHistogram latency;
+
+    EndpointCounters();
+};
+
+/** Live counters for one cache; see CacheMetrics (hits here excludes negative hits). */
+struct CacheCounters {
+    volatile uint64_t hits;
+    volatile uint64_t negative_hits;
+    volatile uint64_t misses;
+    volatile uint64_t evictions;
+    volatile uint64_t entries;
+
+    CacheCounters();
+};
+
+class MetricsRegistry {
+public:
+    MetricsRegistry() {}
+
+    EndpointCounters& endpoint(Endpoint e) { return endpoints_[e]; }
+    const EndpointCounters& endpoint(Endpoint e) const { return endpoints_[e]; }
+
+    void recordRequest(Endpoint e, uint64_t latency_ns,
+                       uint64_t bytes_sent, uint64_t bytes_received);
+    void recordError(Endpoint e, ErrorKind kind);
+    void recordRetry(Endpoint e);
+    void recordFailover(Endpoint e);
+    void recordSerialize(Endpoint e, uint64_t ns);
+    void recordParse(Endpoint e, uint64_t ns);
+    void recordPhases(Endpoint e, const uint64_t (&phase_ns)[TRANSFER_PHASE_COUNT], bool reused);
+    void recordCircuitState(Endpoint e, CircuitState state);
+    void recordCircuitRejection(Endpoint e);
+    void recordHedge(Endpoint e);
+    void recordHedgeWin(Endpoint e);
+    void recordCoalesced(Endpoint e);
+
+    CacheCounters& cache(CacheKind k) { return caches_[k]; }
+
+    void snapshot(MetricsSnapshot& out) const;
+
+    /** Append all metrics in Prometheus text exposition format (0.0.4). */
+    void renderPrometheus(std::string& out) const;
+
+    /** Map a request path (with query string) to its endpoint family. */
+    static Endpoint classify(const std::string& path);
+
+private:
+    MetricsRegistry(const MetricsRegistry&);
+    MetricsRegistry& operator=(const MetricsRegistry&);
+
+    EndpointCounters endpoints_[ENDPOINT_COUNT];
+    CacheCounters caches_[CACHE_KIND_COUNT];
+    LatencyHistogram serialize_;
+    LatencyHistogram parse_;
+};
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_METRICS_REGISTRY_HPP
@@ -0,0 +1,99 @@
+#include "single_flight.hpp"
+#include "drip/cancellation.hpp"
+#include "clock.hpp"
+
+namespace drip {
+namespace detail {
+
+/* Wait slice while watching a follower's cancellation token */
+static const int CANCEL_POLL_MS = 20;
+
+/** One in-flight request. Freed by whichever of leader and followers lets go last. */
+struct Flight {
+    std::string key;
+    int refs;
+    bool landed;
+    SingleFlight::Outcome outcome;
+    CondVar landed_cv;
+
+    explicit Flight(const std::string& k) : key(k), refs(1), landed(false) {}
+};
+
+Flight* SingleFlight::join(const std::string& key, bool& leader) {
+    ScopedLock lock(mutex_);
+    std::map<std::string, Flight*>::iterator it = flights_.find(key);
+    if (it != flights_.end()) {
+        ++it->second->refs;
+        leader = false;
+        return it->second;
+    }
+    Flight* flight = new Flight(key);
+    flights_.insert(std::make_pair(key, flight));
+    leader = true;
+    return flight;
+}
+
+void SingleFlight::land(Flight* flight, const JsonObj& data) {
+    Outcome outcome;
+    outcome.ok = true;
+    outcome.data = data;
+    publish(flight, outcome);
+}
+
+void SingleFlight::landCurrentException(Flight* flight, bool abandon) {
+    Outcome outcome;
+    if (!abandon) {
+        outcome.error.captureCurrent();
+        /* Followers were not cancelled; they retry on their own */
+        if (outcome.error.kind == CapturedError::CANCELLED || outcome.error.kind == CapturedError::OTHER) {
+            outcome.error = CapturedError();
+        }
+    }
+    publish(flight, outcome);
+}
+
+void SingleFlight::publish(Flight* flight, const Outcome& outcome) {
+    ScopedLock lock(mutex_);
+    flights_.erase(flight->key);
+    flight->outcome = outcome;
+    flight->landed = true;
+    flight->landed_cv.notifyAll();
+    release(flight);
+}
+
+bool SingleFlight::wait(Flight* flight, const CancellationToken* cancellation, uint64_t deadline_ns,
+                        Outcome& out) {
+    ScopedLock lock(mutex_);
+    while (!flight->landed) {
+        if (cancellation && cancellation->isCancelled()) return false;
+        int wait_ms = -1;
+        if (deadline_ns != 0) {
+            uint64_t now = monotonic_ns();
+            if (now + 1000000ULL > deadline_ns) return false;
+            wait_ms = static_cast<int>((deadline_ns - now) / 1000000ULL);
+        }
+        if (cancellation && (wait_ms < 0 || wait_ms > CANCEL_POLL_MS)) {
+            wait_ms = CANCEL_POLL_MS;
+        }
+        if (wait_ms < 0) {
+            flight->landed_cv.wait(mutex_);
+        } else {
+            flight->landed_cv.waitFor(mutex_, wait_ms);
+        }
+    }
+    out = flight->outcome;
+    return true;
+}
+
+void SingleFlight::leave(Flight* flight) {
+    ScopedLock lock(mutex_);
+    release(flight);
+}
+
+/* mutex_ held */
+void SingleFlight::release(Flight* flight) {
+    if (--flight->refs == 0) delete flight;
+}
+
+} // namespace detail
+} // namespace drip
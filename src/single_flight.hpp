@@ -0,0 +1,96 @@
+#ifndef DRIP_SINGLE_FLIGHT_HPP
+#define DRIP_SINGLE_FLIGHT_HPP
+
+/*
+ * Coalescing of concurrent identical GETs (Config::coalesce_gets).
+ * Internal header — not installed.
+ */
+
+#include "captured_error.hpp"
+#include "codec.hpp"
+#include "sync.hpp"
+
+#include <map>
+#include <string>
+
+/* C++03: use <stdint.h> instead of <cstdint> */
+#include <stdint.h>
+
+namespace drip {
+
+class CancellationToken;
+
+namespace detail {
+
+struct Flight;
+
+/**
+ * At most one request in flight per key. The first caller for a key
+ * leads: it sends the request and lands the outcome. Callers that join
+ * while it is in flight wait and get a copy of the parsed result, or the
+ * same exception. A flight is forgotten once it lands, so a later call
+ * sends a fresh request.
+ *
+ * Failures that belong to the leader's call rather than the request —
+ * its cancellation or its deadline — are landed as abandoned, and the
+ * followers then send their own request.
+ */
+class SingleFlight {
+public:
+    /** A result, an error (error.kind set), or neither: abandoned. */
+    struct Outcome {
+        bool ok;
+        JsonObj data;            /* ok */
+        CapturedError error;
+
+        Outcome() : ok(false) {}
+
+        bool abandoned() const { return !ok && error.kind == CapturedError::NONE; }
+    };
+
+    SingleFlight() {}
+
+    /**
+     * Join or start the flight for @p key. Sets @p leader when the caller
+     * must send the request and then call land() or landCurrentException().
+     * Otherwise the caller must wait() and then leave().
+     */
+    Flight* join(const std::string& key, bool& leader);
+
+    /** Leader: publish the result and release the flight. */
+    void land(Flight* flight, const JsonObj& data);
+
+    /**
+     * Leader, inside a catch block: publish the exception being handled
+     * (or, with @p abandon, let followers retry on their own) and release
+     * the flight.
+     */
+    void landCurrentException(Flight* flight, bool abandon);
+
+    /**
+     * Follower: wait for the leader. Returns false, without an outcome,
+     * once @p cancellation is cancelled or less than 1 ms is left before
+     * @p deadline_ns (0 = none).
+     */
+    bool wait(Flight* flight, const CancellationToken* cancellation, uint64_t deadline_ns,
+              Outcome& out);
+
+    /** Follower: release the flight after wait(). */
+    void leave(Flight* flight);
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    SingleFlight(const SingleFlight&);
+    SingleFlight& operator=(const SingleFlight&);
+
+    void publish(Flight* flight, const Outcome& outcome);
+    void release(Flight* flight);   /* mutex_ held */
+
+    Mutex mutex_;
+    std::map<std::string, Flight*> flights_;
+};
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_SINGLE_FLIGHT_HPP
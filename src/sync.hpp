@@ -0,0 +1,198 @@
+#ifndef DRIP_SYNC_HPP
+#define DRIP_SYNC_HPP
+
+/*
+ * Thread primitives (C++03 has no <mutex> or <thread>). pthreads on POSIX,
+ * SRW locks and condition variables on Windows. Internal header — not
+ * installed.
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+namespace drip {
+namespace detail {
+
+class Mutex {
+public:
+    Mutex() {
+#ifdef _WIN32
+        InitializeSRWLock(&lock_);
+#else
+        pthread_mutex_init(&lock_, NULL);
+#endif
+    }
+
+    ~Mutex() {
+#ifndef _WIN32
+        pthread_mutex_destroy(&lock_);
+#endif
+    }
+
+    void lock() {
+#ifdef _WIN32
+        AcquireSRWLockExclusive(&lock_);
+#else
+        pthread_mutex_lock(&lock_);
+#endif
+    }
+
+    void unlock() {
+#ifdef _WIN32
+        ReleaseSRWLockExclusive(&lock_);
+#else
+        pthread_mutex_unlock(&lock_);
+#endif
+    }
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    Mutex(const Mutex&);
+    Mutex& operator=(const Mutex&);
+
+    friend class CondVar;
+
+#ifdef _WIN32
+    SRWLOCK lock_;
+#else
+    pthread_mutex_t lock_;
+#endif
+};
+
+/** RAII lock guard (std::lock_guard stand-in). */
+class ScopedLock {
+public:
+    explicit ScopedLock(Mutex& m) : m_(m) { m_.lock(); }
+    ~ScopedLock() { m_.unlock(); }
+
+private:
+    ScopedLock(const ScopedLock&);
+    ScopedLock& operator=(const ScopedLock&);
+
+    Mutex& m_;
+};
+
+/** Condition variable paired with Mutex (std::condition_variable stand-in). */
+class CondVar {
+public:
+    CondVar() {
+#ifdef _WIN32
+        InitializeConditionVariable(&cond_);
+#else
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+#ifndef __APPLE__
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+        pthread_cond_init(&cond_, &attr);
+        pthread_condattr_destroy(&attr);
+#endif
+    }
+
+    ~CondVar() {
+#ifndef _WIN32
+        pthread_cond_destroy(&cond_);
+#endif
+    }
+
+    /** Wait until notified; m must be locked. Spurious wakeups happen. */
+    void wait(Mutex& m) {
+#ifdef _WIN32
+        SleepConditionVariableSRW(&cond_, &m.lock_, INFINITE, 0);
+#else
+        pthread_cond_wait(&cond_, &m.lock_);
+#endif
+    }
+
+    /** wait() with a timeout of ms milliseconds. */
+    void waitFor(Mutex& m, int ms) {
+        if (ms < 0) ms = 0;
+#ifdef _WIN32
+        SleepConditionVariableSRW(&cond_, &m.lock_, static_cast<DWORD>(ms), 0);
+#else
+        struct timespec ts;
+#ifdef __APPLE__
+        ts.tv_sec = ms / 1000;
+        ts.tv_nsec = static_cast<long>(ms % 1000) * 1000000L;
+        pthread_cond_timedwait_relative_np(&cond_, &m.lock_, &ts);
+#else
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_sec += ms / 1000;
+        ts.tv_nsec += static_cast<long>(ms % 1000) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec += 1;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&cond_, &m.lock_, &ts);
+#endif
+#endif
+    }
+
+    void notifyAll() {
+#ifdef _WIN32
+        WakeAllConditionVariable(&cond_);
+#else
+        pthread_cond_broadcast(&cond_);
+#endif
+    }
+
+private:
+    CondVar(const CondVar&);
+    CondVar& operator=(const CondVar&);
+
+#ifdef _WIN32
+    CONDITION_VARIABLE cond_;
+#else
+    pthread_cond_t cond_;
+#endif
+};
+
+/* Trampoline state for start_detached_thread() */
+struct DetachedThreadStart {
+    void (*fn)(void*);
+    void* arg;
+};
+
+#ifdef _WIN32
+inline DWORD WINAPI detached_thread_main(LPVOID p) {
+#else
+inline void* detached_thread_main(void* p) {
+#endif
+    DetachedThreadStart start = *static_cast<DetachedThreadStart*>(p);
+    delete static_cast<DetachedThreadStart*>(p);
+    start.fn(start.arg);
+    return 0;
+}
+
+/**
+ * Run fn(arg) on a new detached thread (C++03 has no <thread>).
+ * Returns false if the thread could not be created.
+ */
+inline bool start_detached_thread(void (*fn)(void*), void* arg) {
+    DetachedThreadStart* start = new DetachedThreadStart;
+    start->fn = fn;
+    start->arg = arg;
+#ifdef _WIN32
+    HANDLE h = CreateThread(NULL, 0, detached_thread_main, start, 0, NULL);
+    bool ok = h != NULL;
+    if (ok) CloseHandle(h);
+#else
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t thread;
+    bool ok = pthread_create(&thread, &attr, detached_thread_main, start) == 0;
+    pthread_attr_destroy(&attr);
+#endif
+    if (!ok) delete start;
+    return ok;
+}
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_SYNC_HPP
@@ -0,0 +1,238 @@
+#include "upstream_pool.hpp"
+#include "clock.hpp"
+
+#include <picojson/picojson.h>
+
+#include <sstream>
+
+namespace drip {
+namespace detail {
+
+/* Weight of the newest sample in the latency and failure EWMAs */
+static const double EWMA_ALPHA = 0.2;
+
+/* Cost of a failure-rate of 1.0, in ns of expected latency */
+static const double FAILURE_PENALTY_NS = 1e9;
+
+static const int EJECT_AFTER = 3;
+static const uint64_t EJECT_NS = 5000ULL * 1000000ULL;
+
+UpstreamPool::UpstreamPool()
+    : transport_(NULL)
+    , interval_ms_(0)
+    , timeout_ms_(0)
+    , probing_(false)
+    , stop_(false)
+{}
+
+UpstreamPool::~UpstreamPool() {
+    stopProbes();
+}
+
+void UpstreamPool::configure(const std::vector<std::string>& base_urls) {
+    ScopedLock lock(mutex_);
+    upstreams_.clear();
+    size_t n = base_urls.size() < static_cast<size_t>(MAX_UPSTREAMS)
+             ? base_urls.size() : static_cast<size_t>(MAX_UPSTREAMS);
+    for (size_t i = 0; i < n; ++i) {
+        Upstream u;
+        u.base_url = base_urls[i];
+        while (!u.base_url.empty() && u.base_url[u.base_url.size() - 1] == '/') {
+            u.base_url.erase(u.base_url.size() - 1);
+        }
+
+        /* /health lives at the API root, outside the /v1 prefix */
+        u.root_url = u.base_url;
+        std::string suffix = "/v1";
+        if (u.root_url.size() >= suffix.size() &&
+            u.root_url.compare(u.root_url.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            u.root_url.erase(u.root_url.size() - suffix.size());
+        }
+
+        u.latency_ns = 0;
+        u.failure_rate = 0.0;
+        u.consecutive_failures = 0;
+        u.ejected_until_ns = 0;
+        u.probe_ok = false;
+        u.probe_latency_ns = 0;
+        u.probe_last_latency_ns = 0;
+        u.probed_at_ns = 0;
+        u.probes = 0;
+        u.probe_failures = 0;
+        u.probe_consecutive_failures = 0;
+        upstreams_.push_back(u);
+    }
+}
+
+size_t UpstreamPool::pick(uint64_t exclude, uint64_t now_ns) const {
+    if (upstreams_.size() == 1) return 0;
+
+    ScopedLock lock(mutex_);
+    size_t best = upstreams_.size();
+    double best_cost = 0;
+    bool best_ejected = true;
+    for (size_t i = 0; i < upstreams_.size(); ++i) {
+        if (exclude & (static_cast<uint64_t>(1) << i)) continue;
+        const Upstream& u = upstreams_[i];
+        bool ejected = now_ns < u.ejected_until_ns;
+        double cost = static_cast<double>(u.latency_ns) + u.failure_rate * FAILURE_PENALTY_NS;
+        /* Healthy beats ejected; then lowest cost; ties go to the earlier URL */
+        if (best == upstreams_.size() || (best_ejected && !ejected) ||
+            (ejected == best_ejected && cost < best_cost)) {
+            best = i;
+            best_cost = cost;
+            best_ejected = ejected;
+        }
+    }
+    return best < upstreams_.size() ? best : 0;
+}
+
+void UpstreamPool::record(size_t i, bool failed, uint64_t latency_ns, uint64_t now_ns) {
+    if (upstreams_.size() == 1) return;
+
+    ScopedLock lock(mutex_);
+    Upstream& u = upstreams_[i];
+    u.failure_rate = u.failure_rate * (1.0 - EWMA_ALPHA) + (failed ? EWMA_ALPHA : 0.0);
+    /* A quick failure (connection refused) says nothing about latency; a slow one does */
+    if (!failed || latency_ns > u.latency_ns) {
+        u.latency_ns = u.latency_ns == 0
+            ? latency_ns
+            : static_cast<uint64_t>(static_cast<double>(u.latency_ns) * (1.0 - EWMA_ALPHA) +
+                                    static_cast<double>(latency_ns) * EWMA_ALPHA);
+    }
+    if (failed) {
+        if (++u.consecutive_failures >= EJECT_AFTER) {
+            u.ejected_until_ns = now_ns + EJECT_NS;
+        }
+    } else {
+        u.consecutive_failures = 0;
+        u.ejected_until_ns = 0;
+    }
+}
+
+void UpstreamPool::health(size_t i, uint64_t now_ns, HealthSnapshot& out) const {
+    ScopedLock lock(mutex_);
+    const Upstream& u = upstreams_[i];
+    out.ok = u.probe_ok;
+    out.status = u.probe_status;
+    out.error = u.probe_error;
+    out.base_url = u.base_url;
+    out.latency_ns = static_cast<int64_t>(u.probe_latency_ns);
+    out.last_latency_ns = static_cast<int64_t>(u.probe_last_latency_ns);
+    out.age_ns = u.probes > 0 ? static_cast<int64_t>(now_ns - u.probed_at_ns) : 0;
+    out.checks = u.probes;
+    out.failures = u.probe_failures;
+    out.consecutive_failures = u.probe_consecutive_failures;
+}
+
+// =============================================================================
+// Background probes
+// =============================================================================
+
+void UpstreamPool::startProbes(Transport& transport, const std::string& auth_header,
+                               int interval_ms, int timeout_ms) {
+    ScopedLock lock(probe_mutex_);
+    if (probing_ || interval_ms <= 0) return;
+    transport_ = &transport;
+    auth_header_ = auth_header;
+    interval_ms_ = interval_ms;
+    timeout_ms_ = timeout_ms;
+    stop_ = false;
+    probing_ = start_detached_thread(&UpstreamPool::probeMain, this);
+}
+
+void UpstreamPool::stopProbes() {
+    ScopedLock lock(probe_mutex_);
+    if (!probing_) return;
+    stop_ = true;
+    probe_cancel_.cancel();
+    probe_cv_.notifyAll();
+    while (probing_) probe_cv_.wait(probe_mutex_);
+}
+
+void UpstreamPool::probeMain(void* arg) {
+    static_cast<UpstreamPool*>(arg)->probeLoop();
+}
+
+void UpstreamPool::probeLoop() {
+    for (;;) {
+        for (size_t i = 0; i < upstreams_.size(); ++i) {
+            {
+                ScopedLock lock(probe_mutex_);
+                if (stop_) break;
+            }
+            probe(i);
+        }
+
+        ScopedLock lock(probe_mutex_);
+        if (!stop_) probe_cv_.waitFor(probe_mutex_, interval_ms_);
+        if (stop_) {
+            probing_ = false;
+            probe_cv_.notifyAll();
+            return;
+        }
+    }
+}
+
+/** One GET /health; healthy means 2xx and a status of "healthy" (as ping()). */
+void UpstreamPool::probe(size_t i) {
+    HttpRequest req;
+    req.method = "GET";
+    req.url = upstreams_[i].root_url + "/health";
+    req.headers.push_back(auth_header_);
+    req.timeout_ms = timeout_ms_;
+    req.connect_timeout_ms = timeout_ms_;
+    req.cancellation = &probe_cancel_;
+
+    HttpResponse resp;
+    uint64_t start = monotonic_ns();
+    transport_->perform(req, resp);
+    uint64_t end = monotonic_ns();
+    if (resp.status == TRANSPORT_CANCELLED) return;
+
+    bool answered = resp.status == TRANSPORT_OK && resp.http_status < 500;
+    record(i, !answered, end - start, end);
+
+    std::string status;
+    std::string error = resp.error;
+    if (resp.status == TRANSPORT_OK && (resp.http_status < 200 || resp.http_status >= 300)) {
+        std::ostringstream msg;
+        msg << "Health check failed with status " << resp.http_status;
+        error = msg.str();
+    } else if (resp.status == TRANSPORT_OK) {
+        picojson::value parsed;
+        picojson::parse(parsed, resp.body);
+        if (parsed.is<picojson::object>() && parsed.contains("status") &&
+            parsed.get("status").is<std::string>()) {
+            status = parsed.get("status").get<std::string>();
+        }
+        if (status.empty()) status = "healthy";
+    }
+    bool ok = error.empty() && status == "healthy";
+    if (error.empty() && !ok) error = "Reported status: " + status;
+
+    ScopedLock lock(mutex_);
+    Upstream& u = upstreams_[i];
+    uint64_t latency = end - start;
+    u.probe_ok = ok;
+    u.probe_status = status;
+    u.probe_error = ok ? std::string() : error;
+    u.probe_last_latency_ns = latency;
+    if (answered) {
+        u.probe_latency_ns = u.probe_latency_ns == 0
+            ? latency
+            : static_cast<uint64_t>(static_cast<double>(u.probe_latency_ns) * (1.0 - EWMA_ALPHA) +
+                                    static_cast<double>(latency) * EWMA_ALPHA);
+    }
+    u.probed_at_ns = end;
+    ++u.probes;
+    if (ok) {
+        u.probe_consecutive_failures = 0;
+    } else {
+        ++u.probe_failures;
+        ++u.probe_consecutive_failures;
+    }
+}
+
+} // namespace detail
+} // namespace drip
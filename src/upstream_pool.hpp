@@ -0,0 +1,126 @@
+#ifndef DRIP_UPSTREAM_POOL_HPP
+#define DRIP_UPSTREAM_POOL_HPP
+
+/*
+ * Base URL selection and failover behind Config::base_urls, and the
+ * /health monitor behind Config::probe_interval_ms. Internal header —
+ * not installed.
+ */
+
+#include "drip/types.hpp"
+#include "drip/transport.hpp"
+#include "drip/cancellation.hpp"
+#include "sync.hpp"
+
+#include <string>
+#include <vector>
+
+/* C++03: use <stdint.h> instead of <cstdint> */
+#include <stdint.h>
+
+namespace drip {
+namespace detail {
+
+/**
+ * The API base URLs a client may send to ("upstreams"), each with an
+ * EWMA of its latency and failure rate. pick() returns the upstream with
+ * the lowest expected cost:
+ *
+ *   latency EWMA + failure-rate EWMA * FAILURE_PENALTY
+ *
+ * so a fast upstream that starts failing loses traffic to a slower one
+ * that answers. After EJECT_AFTER consecutive failures an upstream is
+ * skipped for EJECT_MS unless nothing else is left, and any success
+ * (including a probe) brings it back.
+ *
+ * With a single upstream pick() is a constant and nothing is tracked.
+ */
+class UpstreamPool {
+public:
+    enum { MAX_UPSTREAMS = 64 };   /* pick() takes a 64-bit exclusion mask */
+
+    UpstreamPool();
+    ~UpstreamPool();
+
+    /** @p base_urls must be non-empty; trailing slashes are stripped. */
+    void configure(const std::vector<std::string>& base_urls);
+
+    size_t size() const { return upstreams_.size(); }
+
+    /** Base URL of upstream i, e.g. https://api.example.com/v1 */
+    const std::string& baseUrl(size_t i) const { return upstreams_[i].base_url; }
+
+    /** Base URL without the /v1 suffix, where /health lives. */
+    const std::string& rootUrl(size_t i) const { return upstreams_[i].root_url; }
+
+    /** Best upstream not set in @p exclude (bit i = upstream i). */
+    size_t pick(uint64_t exclude, uint64_t now_ns) const;
+
+    /**
+     * Record a request outcome. Failed means the upstream did not answer
+     * usefully: a transport error or a 5xx.
+     */
+    void record(size_t i, bool failed, uint64_t latency_ns, uint64_t now_ns);
+
+    /** Fill @p out with the probe results for upstream i. */
+    void health(size_t i, uint64_t now_ns, HealthSnapshot& out) const;
+
+    /**
+     * Probe every upstream's /health each @p interval_ms on a background
+     * thread. Feeds health(), and keeps selection estimates fresh for
+     * upstreams that get no traffic. @p transport must outlive stopProbes().
+     */
+    void startProbes(Transport& transport, const std::string& auth_header,
+                     int interval_ms, int timeout_ms);
+
+    /** Stop the probe thread and wait for it to exit. Idempotent. */
+    void stopProbes();
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    UpstreamPool(const UpstreamPool&);
+    UpstreamPool& operator=(const UpstreamPool&);
+
+    struct Upstream {
+        std::string base_url;
+        std::string root_url;
+        uint64_t latency_ns;       /* EWMA; 0 until the first sample */
+        double failure_rate;       /* EWMA of 0/1 outcomes */
+        int consecutive_failures;
+        uint64_t ejected_until_ns;
+
+        /* Last probe, and EWMA over successful probes, for health() */
+        bool probe_ok;
+        std::string probe_status;
+        std::string probe_error;
+        uint64_t probe_latency_ns;
+        uint64_t probe_last_latency_ns;
+        uint64_t probed_at_ns;
+        uint64_t probes;
+        uint64_t probe_failures;
+        int probe_consecutive_failures;
+    };
+
+    static void probeMain(void* arg);
+    void probeLoop();
+    void probe(size_t i);
+
+    mutable Mutex mutex_;
+    std::vector<Upstream> upstreams_;
+
+    /* Background probes */
+    Transport* transport_;
+    std::string auth_header_;
+    int interval_ms_;
+    int timeout_ms_;
+    Mutex probe_mutex_;
+    CondVar probe_cv_;
+    bool probing_;
+    bool stop_;
+    CancellationToken probe_cancel_;
+};
+
+} // namespace detail
+} // namespace drip
+
+#endif // DRIP_UPSTREAM_POOL_HPP
@@ -0,0 +1,242 @@
+#include "fault_transport.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cmath>
+#include <cstdlib>
+
+#include <errno.h>
+#include <time.h>
+
+namespace drip {
+namespace mock {
+
+// =============================================================================
+// Helpers
+// =============================================================================
+
+/** splitmix64 step; returns a double in [0, 1). */
+static double next_unit(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return static_cast<double>(z >> 11) / 9007199254740992.0;
+}
+
+static void sleep_ms(int ms) {
+    if (ms <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = static_cast<long>(ms % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+/** sleep_ms() that wakes within ~10 ms of a cancel; false if cancelled. */
+static bool sleep_unless_cancelled(int ms, const CancellationToken* token) {
+    if (!token) {
+        sleep_ms(ms);
+        return true;
+    }
+    for (int slept = 0; slept < ms; slept += 10) {
+        if (token->isCancelled()) return false;
+        sleep_ms(ms - slept < 10 ? ms - slept : 10);
+    }
+    return !token->isCancelled();
+}
+
+static std::string trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+static void fail_response(HttpResponse& response, int status, const std::string& message) {
+    response.status = TRANSPORT_OK;
+    response.http_status = status;
+    response.info.http_status = status;
+    response.body = "{\"error\":\"" + message + "\",\"code\":\"INJECTED_FAULT\"}";
+}
+
+// =============================================================================
+// Scenario files
+// =============================================================================
+
+FaultScenario load_fault_scenario(const std::string& path) {
+    std::ifstream in(path.c_str());
+    if (!in) {
+        throw std::runtime_error("Cannot open fault scenario: " + path);
+    }
+
+    FaultScenario s;
+    s.name = path;
+    size_t slash = s.name.find_last_of('/');
+    if (slash != std::string::npos) s.name.erase(0, slash + 1);
+    size_t dot = s.name.find_last_of('.');
+    if (dot != std::string::npos && dot > 0) s.name.erase(dot);
+
+    std::string line;
+    int line_no = 0;
+    while (std::getline(in, line)) {
+        ++line_no;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        size_t eq = line.find('=');
+        std::ostringstream where;
+        where << path << ":" << line_no;
+        if (eq == std::string::npos) {
+            throw std::runtime_error(where.str() + ": expected key = value");
+        }
+        std::string key = trim(line.substr(0, eq));
+        std::string value = trim(line.substr(eq + 1));
+        const char* v = value.c_str();
+
+        if (key == "name") s.name = value;
+        else if (key == "seed") s.seed = std::strtoull(v, NULL, 10);
+        else if (key == "latency") {
+            if (value == "none") s.latency = LATENCY_NONE;
+            else if (value == "fixed") s.latency = LATENCY_FIXED;
+            else if (value == "uniform") s.latency = LATENCY_UNIFORM;
+            else if (value == "lognormal") s.latency = LATENCY_LOGNORMAL;
+            else throw std::runtime_error(where.str() + ": unknown latency model '" + value + "'");
+        }
+        else if (key == "latency_ms") s.latency_ms = std::atoi(v);
+        else if (key == "latency_max_ms") s.latency_max_ms = std::atoi(v);
+        else if (key == "latency_p99_ms") s.latency_p99_ms = std::atoi(v);
+        else if (key == "reset_rate") s.reset_rate = std::atof(v);
+        else if (key == "timeout_rate") s.timeout_rate = std::atof(v);
+        else if (key == "rate_limit_rate") s.rate_limit_rate = std::atof(v);
+        else if (key == "retry_after_s") s.retry_after_s = std::atoi(v);
+        else if (key == "error_rate") s.error_rate = std::atof(v);
+        else if (key == "error_status") s.error_status = std::atoi(v);
+        else if (key == "burst_every") s.burst_every = std::atoi(v);
+        else if (key == "burst_length") s.burst_length = std::atoi(v);
+        else if (key == "burst_status") s.burst_status = std::atoi(v);
+        else if (key == "burst_latency_ms") s.burst_latency_ms = std::atoi(v);
+        else throw std::runtime_error(where.str() + ": unknown key '" + key + "'");
+    }
+    return s;
+}
+
+// =============================================================================
+// FaultInjectionTransport
+// =============================================================================
+
+FaultInjectionTransport::FaultInjectionTransport(Transport& inner, const FaultScenario& scenario)
+    : inner_(inner)
+    , scenario_(scenario)
+    , requests_(0)
+    , faults_(0)
+{
+    pthread_mutex_init(&mutex_, NULL);
+}
+
+FaultInjectionTransport::~FaultInjectionTransport() {
+    pthread_mutex_destroy(&mutex_);
+}
+
+uint64_t FaultInjectionTransport::requestCount() const {
+    pthread_mutex_lock(&mutex_);
+    uint64_t n = requests_;
+    pthread_mutex_unlock(&mutex_);
+    return n;
+}
+
+uint64_t FaultInjectionTransport::faultCount() const {
+    pthread_mutex_lock(&mutex_);
+    uint64_t n = faults_;
+    pthread_mutex_unlock(&mutex_);
+    return n;
+}
+
+int FaultInjectionTransport::sampleLatencyMs(uint64_t& rng) const {
+    const FaultScenario& s = scenario_;
+    switch (s.latency) {
+        case LATENCY_FIXED:
+            return s.latency_ms;
+        case LATENCY_UNIFORM: {
+            int span = s.latency_max_ms > s.latency_ms ? s.latency_max_ms - s.latency_ms : 0;
+            return s.latency_ms + static_cast<int>(next_unit(rng) * (span + 1));
+        }
+        case LATENCY_LOGNORMAL: {
+            if (s.latency_ms <= 0) return 0;
+            /* Box-Muller; sigma puts the 99th percentile (z = 2.326) at latency_p99_ms */
+            double ratio = s.latency_p99_ms > s.latency_ms
+                ? static_cast<double>(s.latency_p99_ms) / s.latency_ms : 1.0;
+            double sigma = std::log(ratio) / 2.326;
+            double u1 = next_unit(rng);
+            double u2 = next_unit(rng);
+            if (u1 < 1e-12) u1 = 1e-12;
+            double z = std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+            return static_cast<int>(s.latency_ms * std::exp(sigma * z));
+        }
+        case LATENCY_NONE:
+        default:
+            return 0;
+    }
+}
+
+void FaultInjectionTransport::perform(const HttpRequest& request, HttpResponse& response) {
+    const FaultScenario& s = scenario_;
+
+    pthread_mutex_lock(&mutex_);
+    uint64_t index = requests_++;
+    pthread_mutex_unlock(&mutex_);
+
+    /* Decisions depend only on (seed, index), never on timing */
+    uint64_t rng = s.seed * 0x9E3779B97F4A7C15ULL ^ index;
+    next_unit(rng);
+    int latency = sampleLatencyMs(rng);
+    double reset = next_unit(rng);
+    double timeout = next_unit(rng);
+    double limited = next_unit(rng);
+    double error = next_unit(rng);
+    bool in_burst = s.burst_every > 0 &&
+                    index % static_cast<uint64_t>(s.burst_every) < static_cast<uint64_t>(s.burst_length);
+    if (in_burst) latency += s.burst_latency_ms;
+
+    bool is_timeout = timeout < s.timeout_rate || latency >= request.timeout_ms;
+    int delay = reset < s.reset_rate ? (latency < request.timeout_ms ? latency : request.timeout_ms)
+              : is_timeout ? request.timeout_ms
+              : latency;
+    if (!sleep_unless_cancelled(delay, request.cancellation)) {
+        response.status = TRANSPORT_CANCELLED;
+        response.error = "Request cancelled";
+        return;
+    }
+
+    bool fault = true;
+    if (reset < s.reset_rate) {
+        response.status = TRANSPORT_NETWORK_ERROR;
+        response.error = "CURL error: Connection reset by peer (injected)";
+    } else if (is_timeout) {
+        response.status = TRANSPORT_TIMEOUT;
+        response.error = "Request timed out";
+    } else if (limited < s.rate_limit_rate) {
+        fail_response(response, 429, "Rate limited");
+        std::ostringstream secs;
+        secs << s.retry_after_s;
+        response.headers["retry-after"] = secs.str();
+    } else if (in_burst && s.burst_status > 0) {
+        fail_response(response, s.burst_status, "Injected burst");
+    } else if (error < s.error_rate) {
+        fail_response(response, s.error_status, "Injected error");
+    } else {
+        fault = false;
+        inner_.perform(request, response);
+    }
+
+    if (fault) {
+        pthread_mutex_lock(&mutex_);
+        ++faults_;
+        pthread_mutex_unlock(&mutex_);
+    }
+}
+
+} // namespace mock
+} // namespace drip
@@ -0,0 +1,126 @@
+#ifndef DRIP_FAULT_TRANSPORT_HPP
+#define DRIP_FAULT_TRANSPORT_HPP
+
+/*
+ * Fault-injecting Transport decorator for resilience tests and the
+ * drip_fault_suite benchmark. Wraps another Transport (normally a
+ * CurlTransport pointed at the mock server) and, per request, adds
+ * latency or replaces the exchange with a connection reset, a timeout,
+ * a 429 with Retry-After, or a 5xx.
+ *
+ * Faults for the Nth request are drawn from an RNG seeded with
+ * (scenario seed, N), so a scenario replays the same fault sequence on
+ * every run. With several threads the sequence is the same but which
+ * thread draws which request number is not.
+ */
+
+#include <drip/transport.hpp>
+
+#include <string>
+
+/* C++03: use <stdint.h> instead of <cstdint> */
+#include <stdint.h>
+
+#include <pthread.h>
+
+namespace drip {
+namespace mock {
+
+enum LatencyModel {
+    LATENCY_NONE,
+    LATENCY_FIXED,       // latency_ms
+    LATENCY_UNIFORM,     // [latency_ms, latency_max_ms]
+    LATENCY_LOGNORMAL    // Median latency_ms, 99th percentile latency_p99_ms
+};
+
+/**
+ * One fault scenario. Rates are per-request probabilities (0-1) and are
+ * checked in the order reset, timeout, rate limit, error.
+ */
+struct FaultScenario {
+    std::string name;
+    uint64_t seed;
+
+    LatencyModel latency;
+    int latency_ms;
+    int latency_max_ms;
+    int latency_p99_ms;
+
+    double reset_rate;       // Fail with TRANSPORT_NETWORK_ERROR, request not sent
+    double timeout_rate;     // Wait out the request timeout, then TRANSPORT_TIMEOUT
+    double rate_limit_rate;  // Answer 429 with "Retry-After: retry_after_s"
+    int retry_after_s;
+    double error_rate;       // Answer error_status
+    int error_status;
+
+    /*
+     * Bursts: requests [k*burst_every, k*burst_every + burst_length) are
+     * delayed by burst_latency_ms, then get burst_status (0: answered normally)
+     */
+    int burst_every;
+    int burst_length;
+    int burst_status;
+    int burst_latency_ms;
+
+    FaultScenario()
+        : name("baseline")
+        , seed(1)
+        , latency(LATENCY_NONE)
+        , latency_ms(0)
+        , latency_max_ms(0)
+        , latency_p99_ms(0)
+        , reset_rate(0.0)
+        , timeout_rate(0.0)
+        , rate_limit_rate(0.0)
+        , retry_after_s(1)
+        , error_rate(0.0)
+        , error_status(500)
+        , burst_every(0)
+        , burst_length(0)
+        , burst_status(503)
+        , burst_latency_ms(0)
+    {}
+};
+
+/**
+ * Load a scenario from "key = value" lines ('#' starts a comment). Keys
+ * are the FaultScenario field names; latency takes none, fixed, uniform
+ * or lognormal.
+ * @throws std::runtime_error on an unreadable file or an unknown key.
+ */
+FaultScenario load_fault_scenario(const std::string& path);
+
+class FaultInjectionTransport : public Transport {
+public:
+    /** @p inner is not owned and must outlive this transport. */
+    FaultInjectionTransport(Transport& inner, const FaultScenario& scenario);
+    ~FaultInjectionTransport();
+
+    void perform(const HttpRequest& request, HttpResponse& response);
+
+    const FaultScenario& scenario() const { return scenario_; }
+
+    /** Requests seen so far. */
+    uint64_t requestCount() const;
+
+    /** Requests answered with an injected fault (latency alone excluded). */
+    uint64_t faultCount() const;
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    FaultInjectionTransport(const FaultInjectionTransport&);
+    FaultInjectionTransport& operator=(const FaultInjectionTransport&);
+
+    int sampleLatencyMs(uint64_t& rng) const;
+
+    Transport& inner_;
+    FaultScenario scenario_;
+    mutable pthread_mutex_t mutex_;
+    uint64_t requests_;
+    uint64_t faults_;
+};
+
+} // namespace mock
+} // namespace drip
+
+#endif // DRIP_FAULT_TRANSPORT_HPP
@@ -0,0 +1,841 @@
+#include "mock_server.hpp"
+
+#include <picojson/picojson.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace drip {
+namespace mock {
+
+typedef picojson::value  JsonVal;
+typedef picojson::object JsonObj;
+typedef picojson::array  JsonArr;
+
+// =============================================================================
+// Helpers
+// =============================================================================
+
+static const size_t MAX_HEADER_BYTES = 64 * 1024;
+static const size_t MAX_BODY_BYTES = 16 * 1024 * 1024;
+
+static int64_t wall_ms() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return static_cast<int64_t>(tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+}
+
+static std::string iso_timestamp(int64_t ms) {
+    time_t secs = static_cast<time_t>(ms / 1000);
+    struct tm utc;
+    gmtime_r(&secs, &utc);
+    char buf[32];
+    size_t n = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &utc);
+    std::snprintf(buf + n, sizeof(buf) - n, ".%03dZ", static_cast<int>(ms % 1000));
+    return buf;
+}
+
+/** splitmix64 step; returns a double in [0, 1). */
+static double next_unit(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return static_cast<double>(z >> 11) / 9007199254740992.0;
+}
+
+static void sleep_ms(int ms) {
+    if (ms <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = static_cast<long>(ms % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+static std::string lower(const std::string& s) {
+    std::string out(s);
+    for (size_t i = 0; i < out.size(); ++i) {
+        if (out[i] >= 'A' && out[i] <= 'Z') out[i] = static_cast<char>(out[i] - 'A' + 'a');
+    }
+    return out;
+}
+
+static std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+static std::string query_param(const std::string& query, const std::string& name) {
+    size_t pos = 0;
+    while (pos <= query.size()) {
+        size_t amp = query.find('&', pos);
+        if (amp == std::string::npos) amp = query.size();
+        size_t eq = query.find('=', pos);
+        if (eq != std::string::npos && eq < amp && query.compare(pos, eq - pos, name) == 0) {
+            /* Percent-decode the value */
+            std::string value;
+            for (size_t i = eq + 1; i < amp; ++i) {
+                if (query[i] == '%' && i + 2 < amp) {
+                    value += static_cast<char>(std::strtol(query.substr(i + 1, 2).c_str(), NULL, 16));
+                    i += 2;
+                } else {
+                    value += query[i];
+                }
+            }
+            return value;
+        }
+        pos = amp + 1;
+    }
+    return "";
+}
+
+static const char* status_text(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 409: return "Conflict";
+        case 429: return "Too Many Requests";
+        case 500: return "Internal Server Error";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        case 504: return "Gateway Timeout";
+        default:  return "Unknown";
+    }
+}
+
+static MockResponse json_response(int status, const JsonObj& obj) {
+    MockResponse resp;
+    resp.status = status;
+    resp.body = JsonVal(obj).serialize();
+    return resp;
+}
+
+static MockResponse error_response(int status, const std::string& message, const char* code) {
+    JsonObj obj;
+    obj["error"] = JsonVal(message);
+    obj["code"] = JsonVal(std::string(code));
+    return json_response(status, obj);
+}
+
+static bool parse_body(const MockRequest& req, JsonObj& out) {
+    JsonVal v;
+    std::string err = picojson::parse(v, req.body);
+    if (!err.empty() || !v.is<JsonObj>()) return false;
+    out = v.get<JsonObj>();
+    return true;
+}
+
+static std::string field(const JsonObj& obj, const char* key) {
+    JsonObj::const_iterator it = obj.find(key);
+    if (it != obj.end() && it->second.is<std::string>()) return it->second.get<std::string>();
+    return "";
+}
+
+static double number_field(const JsonObj& obj, const char* key) {
+    JsonObj::const_iterator it = obj.find(key);
+    if (it != obj.end() && it->second.is<double>()) return it->second.get<double>();
+    return 0.0;
+}
+
+static std::string format_usdc(int64_t micros) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%s%lld.%06lld", micros < 0 ? "-" : "",
+                  static_cast<long long>((micros < 0 ? -micros : micros) / 1000000),
+                  static_cast<long long>((micros < 0 ? -micros : micros) % 1000000));
+    return buf;
+}
+
+/** Strong ETag for a response body: quoted FNV-1a hash. */
+static std::string body_etag(const std::string& body) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < body.size(); ++i) {
+        h ^= static_cast<unsigned char>(body[i]);
+        h *= 1099511628211ULL;
+    }
+    char buf[24];
+    std::snprintf(buf, sizeof(buf), "\"%016llx\"", static_cast<unsigned long long>(h));
+    return buf;
+}
+
+/** RAII pthread mutex guard. */
+class Lock {
+public:
+    explicit Lock(pthread_mutex_t& m) : m_(m) { pthread_mutex_lock(&m_); }
+    ~Lock() { pthread_mutex_unlock(&m_); }
+private:
+    Lock(const Lock&);
+    Lock& operator=(const Lock&);
+    pthread_mutex_t& m_;
+};
+
+// =============================================================================
+// Lifecycle
+// =============================================================================
+
+MockServer::MockServer(const MockServerOptions& options)
+    : options_(options)
+    , listen_fd_(-1)
+    , port_(0)
+    , running_(false)
+    , started_(false)
+    , connections_accepted_(0)
+    , requests_(0)
+    , injected_errors_(0)
+    , next_id_(0)
+{
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&idle_cond_, NULL);
+}
+
+MockServer::~MockServer() {
+    stop();
+    pthread_cond_destroy(&idle_cond_);
+    pthread_mutex_destroy(&mutex_);
+}
+
+void MockServer::start() {
+    if (started_) return;
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) throw std::runtime_error("mock server: socket() failed");
+
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<unsigned short>(options_.port));
+
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(listen_fd_, 512) != 0) {
+        std::string msg = std::string("mock server: cannot listen: ") + std::strerror(errno);
+        close(listen_fd_);
+        listen_fd_ = -1;
+        throw std::runtime_error(msg);
+    }
+
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+
+    running_ = true;
+    if (pthread_create(&accept_thread_, NULL, &MockServer::acceptMain, this) != 0) {
+        running_ = false;
+        close(listen_fd_);
+        listen_fd_ = -1;
+        throw std::runtime_error("mock server: cannot start accept thread");
+    }
+    started_ = true;
+}
+
+void MockServer::stop() {
+    if (!started_) return;
+    started_ = false;
+    running_ = false;
+
+    /* Unblocks accept() */
+    shutdown(listen_fd_, SHUT_RDWR);
+    pthread_join(accept_thread_, NULL);
+    close(listen_fd_);
+    listen_fd_ = -1;
+
+    /* Unblock connection threads and wait for them to exit */
+    Lock lock(mutex_);
+    for (std::set<int>::iterator it = open_fds_.begin(); it != open_fds_.end(); ++it) {
+        shutdown(*it, SHUT_RDWR);
+    }
+    while (!open_fds_.empty()) {
+        pthread_cond_wait(&idle_cond_, &mutex_);
+    }
+}
+
+std::string MockServer::baseUrl() const {
+    std::ostringstream oss;
+    oss << "http://127.0.0.1:" << port_ << "/v1";
+    return oss.str();
+}
+
+uint64_t MockServer::requestCount() const {
+    Lock lock(mutex_);
+    return requests_;
+}
+
+uint64_t MockServer::injectedErrorCount() const {
+    Lock lock(mutex_);
+    return injected_errors_;
+}
+
+// =============================================================================
+// Connections
+// =============================================================================
+
+void* MockServer::acceptMain(void* arg) {
+    static_cast<MockServer*>(arg)->acceptLoop();
+    return NULL;
+}
+
+void* MockServer::connectionMain(void* arg) {
+    Connection* conn = static_cast<Connection*>(arg);
+    MockServer* server = conn->server;
+    server->serve(conn);
+
+    Lock lock(server->mutex_);
+    close(conn->fd);
+    server->open_fds_.erase(conn->fd);
+    delete conn;
+    pthread_cond_broadcast(&server->idle_cond_);
+    return NULL;
+}
+
+void MockServer::acceptLoop() {
+    while (running_) {
+        int fd = accept(listen_fd_, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        Lock lock(mutex_);
+        if (!running_) {
+            close(fd);
+            break;
+        }
+
+        Connection* conn = new Connection();
+        conn->server = this;
+        conn->fd = fd;
+        conn->rng_state = options_.seed ^ (++connections_accepted_ * 0xD1B54A32D192ED03ULL);
+
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, &MockServer::connectionMain, conn) != 0) {
+            close(fd);
+            delete conn;
+            continue;
+        }
+        pthread_detach(thread);
+        open_fds_.insert(fd);
+    }
+}
+
+static bool send_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void MockServer::serve(Connection* conn) {
+    std::string buf;
+    char chunk[16384];
+
+    while (running_) {
+        /* Read the header block */
+        size_t header_end;
+        while ((header_end = buf.find("\r\n\r\n")) == std::string::npos) {
+            if (buf.size() > MAX_HEADER_BYTES) return;
+            ssize_t n = recv(conn->fd, chunk, sizeof(chunk), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return;
+            buf.append(chunk, static_cast<size_t>(n));
+        }
+
+        MockRequest req;
+        std::istringstream lines(buf.substr(0, header_end));
+        std::string line, target, version;
+        std::getline(lines, line);
+        std::istringstream request_line(line);
+        request_line >> req.method >> target >> version;
+
+        while (std::getline(lines, line)) {
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            req.headers[lower(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+        }
+
+        size_t qmark = target.find('?');
+        req.path = target.substr(0, qmark);
+        if (qmark != std::string::npos) req.query = target.substr(qmark + 1);
+        if (req.path.compare(0, 3, "/v1") == 0) req.path.erase(0, 3);
+
+        size_t content_length = 0;
+        if (req.headers.count("content-length")) {
+            content_length = static_cast<size_t>(std::strtoul(req.headers["content-length"].c_str(), NULL, 10));
+        }
+        if (content_length > MAX_BODY_BYTES) return;
+
+        size_t body_start = header_end + 4;
+        if (buf.size() - body_start < content_length &&
+            lower(req.headers["expect"]) == "100-continue") {
+            if (!send_all(conn->fd, "HTTP/1.1 100 Continue\r\n\r\n")) return;
+        }
+
+        while (buf.size() - body_start < content_length) {
+            ssize_t n = recv(conn->fd, chunk, sizeof(chunk), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return;
+            buf.append(chunk, static_cast<size_t>(n));
+        }
+        req.body = buf.substr(body_start, content_length);
+        buf.erase(0, body_start + content_length);
+
+        MockResponse resp = handle(req, conn->rng_state);
+        if (options_.etags && req.method == "GET" && resp.status == 200) {
+            std::string etag = body_etag(resp.body);
+            resp.extra_headers += "ETag: " + etag + "\r\n";
+            if (req.headers["if-none-match"] == etag) {
+                resp.status = 304;
+                resp.body.clear();
+            }
+        }
+
+        int delay = options_.latency_ms;
+        if (options_.jitter_ms > 0) {
+            delay += static_cast<int>(next_unit(conn->rng_state) * (options_.jitter_ms + 1));
+        }
+        sleep_ms(delay);
+
+        bool keep_alive = version != "HTTP/1.0" && lower(req.headers["connection"]) != "close";
+
+        std::ostringstream out;
+        out << "HTTP/1.1 " << resp.status << " " << status_text(resp.status) << "\r\n"
+            << "Content-Type: application/json\r\n"
+            << "Content-Length: " << resp.body.size() << "\r\n"
+            << resp.extra_headers
+            << (keep_alive ? "" : "Connection: close\r\n")
+            << "\r\n"
+            << resp.body;
+        if (!send_all(conn->fd, out.str())) return;
+
+        if (options_.verbose) {
+            std::cerr << req.method << " " << target << " -> " << resp.status << std::endl;
+        }
+        if (!keep_alive) return;
+    }
+}
+
+// =============================================================================
+// Routing
+// =============================================================================
+
+std::string MockServer::nextId(const char* prefix) {
+    char buf[48];
+    std::snprintf(buf, sizeof(buf), "%s_%010llu", prefix,
+                  static_cast<unsigned long long>(++next_id_));
+    return buf;
+}
+
+bool MockServer::markIdempotent(const std::string& key) {
+    if (key.empty()) return true;
+    return idempotency_keys_.insert(key).second;
+}
+
+MockResponse MockServer::handle(const MockRequest& req, uint64_t& rng_state) {
+    bool inject = options_.error_rate > 0.0 && next_unit(rng_state) < options_.error_rate;
+    {
+        Lock lock(mutex_);
+        ++requests_;
+        if (inject) ++injected_errors_;
+    }
+
+    if (inject) {
+        MockResponse resp = error_response(options_.error_status, "Injected failure", "MOCK_INJECTED");
+        if (options_.error_status == 429) resp.extra_headers = "Retry-After: 1\r\n";
+        return resp;
+    }
+
+    if (req.path == "/health") {
+        if (req.method != "GET") return error_response(405, "Method not allowed", "METHOD_NOT_ALLOWED");
+        JsonObj obj;
+        obj["status"] = JsonVal(std::string("healthy"));
+        obj["timestamp"] = JsonVal(static_cast<double>(wall_ms()));
+        return json_response(200, obj);
+    }
+
+    if (options_.require_auth) {
+        std::map<std::string, std::string>::const_iterator it = req.headers.find("authorization");
+        if (it == req.headers.end() || it->second.compare(0, 7, "Bearer ") != 0 || it->second.size() <= 7) {
+            return error_response(401, "Missing or invalid API key", "UNAUTHORIZED");
+        }
+    }
+
+    const std::string& p = req.path;
+    if (p == "/customers" || p.compare(0, 11, "/customers/") == 0) return handleCustomers(req, p.substr(10));
+    if (p == "/usage/internal") return handleUsage(req);
+    if (p == "/runs" || p.compare(0, 6, "/runs/") == 0) return handleRuns(req, p.substr(5));
+    if (p == "/run-events") return handleRunEvents(req, false);
+    if (p == "/run-events/batch") return handleRunEvents(req, true);
+    if (p == "/workflows") return handleWorkflows(req);
+
+    return error_response(404, "Route not found: " + p, "NOT_FOUND");
+}
+
+// =============================================================================
+// /customers
+// =============================================================================
+
+MockResponse MockServer::handleCustomers(const MockRequest& req, const std::string& rest) {
+    if (rest.empty() && req.method == "POST") {
+        JsonObj body;
+        if (!parse_body(req, body)) return error_response(400, "Invalid JSON body", "VALIDATION_ERROR");
+
+        std::string external_id = field(body, "externalCustomerId");
+        std::string onchain = field(body, "onchainAddress");
+        if (external_id.empty() && onchain.empty()) {
+            return error_response(400, "externalCustomerId or onchainAddress is required", "VALIDATION_ERROR");
+        }
+
+        Lock lock(mutex_);
+        if (!external_id.empty() && customer_by_ext_.count(external_id)) {
+            return error_response(409, "Customer with externalCustomerId " + external_id + " already exists",
+                                  "DUPLICATE_CUSTOMER");
+        }
+
+        std::string now = iso_timestamp(wall_ms());
+        JsonObj customer;
+        customer["id"] = JsonVal(nextId("cus"));
+        if (!external_id.empty()) customer["externalCustomerId"] = JsonVal(external_id);
+        if (!onchain.empty()) customer["onchainAddress"] = JsonVal(onchain);
+        customer["status"] = JsonVal(std::string("ACTIVE"));
+        customer["isInternal"] = JsonVal(false);
+        JsonObj::const_iterator meta = body.find("metadata");
+        if (meta != body.end() && meta->second.is<JsonObj>()) customer["metadata"] = meta->second;
+        customer["createdAt"] = JsonVal(now);
+        customer["updatedAt"] = JsonVal(now);
+
+        std::string id = customer["id"].get<std::string>();
+        customers_[id] = JsonVal(customer).serialize();
+        customer_status_[id] = "ACTIVE";
+        balances_[id] = options_.starting_balance_micros;
+        if (!external_id.empty()) customer_by_ext_[external_id] = id;
+
+        MockResponse resp;
+        resp.status = 201;
+        resp.body = customers_[id];
+        return resp;
+    }
+
+    if (rest.empty() && req.method == "GET") {
+        int limit = std::atoi(query_param(req.query, "limit").c_str());
+        if (limit <= 0) limit = 100;
+        int offset = std::atoi(query_param(req.query, "offset").c_str());
+        if (offset < 0) offset = 0;
+        std::string status = query_param(req.query, "status");
+        std::string external_id = query_param(req.query, "externalCustomerId");
+
+        Lock lock(mutex_);
+        std::string body = "{\"data\":[";
+        int matched = 0;
+        int emitted = 0;
+        for (std::map<std::string, std::string>::const_iterator it = customers_.begin();
+             it != customers_.end(); ++it) {
+            if (!status.empty() && customer_status_[it->first] != status) continue;
+            if (!external_id.empty() && (!customer_by_ext_.count(external_id) ||
+                                         customer_by_ext_[external_id] != it->first)) {
+                continue;
+            }
+            if (matched++ < offset || emitted >= limit) continue;
+            if (emitted++ > 0) body += ',';
+            body += it->second;
+        }
+        std::ostringstream tail;
+        tail << "],\"count\":" << matched << "}";
+        body += tail.str();
+
+        MockResponse resp;
+        resp.body = body;
+        return resp;
+    }
+
+    if (rest.size() < 2 || rest[0] != '/') return error_response(405, "Method not allowed", "METHOD_NOT_ALLOWED");
+    if (req.method != "GET") return error_response(405, "Method not allowed", "METHOD_NOT_ALLOWED");
+
+    std::string id = rest.substr(1);
+    bool balance = false;
+    size_t slash = id.find('/');
+    if (slash != std::string::npos) {
+        if (id.substr(slash) != "/balance") return error_response(404, "Route not found", "NOT_FOUND");
+        id.erase(slash);
+        balance = true;
+    }
+
+    Lock lock(mutex_);
+    std::map<std::string, std::string>::const_iterator it = customers_.find(id);
+    if (it == customers_.end()) return error_response(404, "Customer not found: " + id, "NOT_FOUND");
+
+    MockResponse resp;
+    if (balance) {
+        JsonObj obj;
+        obj["customerId"] = JsonVal(id);
+        obj["balanceUsdc"] = JsonVal(format_usdc(balances_[id]));
+        return json_response(200, obj);
+    }
+    resp.body = it->second;
+    return resp;
+}
+
+// =============================================================================
+// /usage/internal
+// =============================================================================
+
+MockResponse MockServer::handleUsage(const MockRequest& req) {
+    if (req.method != "POST") return error_response(405, "Method not allowed", "METHOD_NOT_ALLOWED");
+
+    JsonObj body;
+    if (!parse_body(req, body)) return error_response(400, "Invalid JSON body", "VALIDATION_ERROR");
+
+    std::string customer_id = field(body, "customerId");
+    std::string usage_type = field(body, "usageType");
+    double quantity = number_field(body, "quantity");
+    if (customer_id.empty() || usage_type.empty()) {
+        return error_response(400, "customerId and usageType are required", "VALIDATION_ERROR");
+    }
+
+    Lock lock(mutex_);
+    if (!customers_.count(customer_id)) {
+        return error_response(404, "Customer not found: " + customer_id, "NOT_FOUND");
+    }
+
+    bool fresh = markIdempotent(field(body, "idempotencyKey"));
+    if (fresh) {
+        balances_[customer_id] -= static_cast<int64_t>(quantity * static_cast<double>(options_.usage_price_micros));
+    }
+
+    JsonObj obj;
+    obj["success"] = JsonVal(true);
+    obj["usageEventId"] = JsonVal(nextId("use"));
+    obj["customerId"] = JsonVal(customer_id);
+    obj["usageType"] = JsonVal(usage_type);
+    obj["quantity"] = JsonVal(quantity);
+    obj["isInternal"] = JsonVal(false);
+    obj["message"] = JsonVal(std::string(fresh ? "Usage recorded" : "Duplicate usage ignored"));
+    return json_response(200, obj);
+}
+
+// =============================================================================
+// /runs
+// =============================================================================
+
+MockResponse MockServer::handleRuns(const MockRequest& req, const std::string& rest) {
+    if (rest.empty() ? req.method != "POST" : (req.method != "PATCH" || rest[0] != '/')) {
+        return error_response(405, "Method not allowed", "METHOD_NOT_ALLOWED");
+    }
+
+    JsonObj body;
+    if (!parse_body(req, body)) return error_response(400, "Invalid JSON body", "VALIDATION_ERROR");
+
+    if (rest.empty()) {
+
+        std::string customer_id = field(body, "customerId");
+        std::string workflow_id = field(body, "workflowId");
+
+        Lock lock(mutex_);
+        if (!customers_.count(customer_id)) {
+            return error_response(404, "Customer not found: " + customer_id, "NOT_FOUND");
+        }
+        std::map<std::string, std::string>::const_iterator wf = workflow_names_.find(workflow_id);
+        if (wf == workflow_names_.end()) {
+            return error_response(404, "Workflow not found: " + workflow_id, "NOT_FOUND");
+        }
+
+        Run run;
+        run.customer_id = customer_id;
+        run.workflow_id = workflow_id;
+        run.workflow_name = wf->second;
+        run.started_ms = wall_ms();
+        run.event_count = 0;
+        run.cost_units = 0.0;
+        std::string id = nextId("run");
+        runs_[id] = run;
+
+        JsonObj obj;
+        obj["id"] = JsonVal(id);
+        obj["customerId"] = JsonVal(customer_id);
+        obj["workflowId"] = JsonVal(workflow_id);
+        obj["workflowName"] = JsonVal(run.workflow_name);
+        obj["status"] = JsonVal(std::string("RUNNING"));
+        std::string correlation = field(body, "correlationId");
+        if (!correlation.empty()) obj["correlationId"] = JsonVal(correlation);
+        obj["createdAt"] = JsonVal(iso_timestamp(run.started_ms));
+        return json_response(201, obj);
+    }
+
+    std::string id = rest.substr(1);
+    std::string status = field(body, "status");
+    if (status.empty()) return error_response(400, "status is required", "VALIDATION_ERROR");
+
+    Lock lock(mutex_);
+    std::map<std::string, Run>::const_iterator it = runs_.find(id);
+    if (it == runs_.end()) return error_response(404, "Run not found: " + id, "NOT_FOUND");
+
+    int64_t now = wall_ms();
+    char cost[32];
+    std::snprintf(cost, sizeof(cost), "%.6f", it->second.cost_units);
+
+    JsonObj obj;
+    obj["id"] = JsonVal(id);
+    obj["status"] = JsonVal(status);
+    obj["endedAt"] = JsonVal(iso_timestamp(now));
+    obj["durationMs"] = JsonVal(static_cast<double>(now - it->second.started_ms));
+    obj["eventCount"] = JsonVal(static_cast<double>(it->second.event_count));
+    obj["totalCostUnits"] = JsonVal(std::string(cost));
+    return json_response(200, obj);
+}
+
+// =============================================================================
+// /run-events
+// =============================================================================
+
+MockResponse MockServer::handleRunEvents(const MockRequest& req, bool batch) {
+    if (req.method != "POST") return error_response(405, "Method not allowed", "METHOD_NOT_ALLOWED");
+
+    JsonObj body;
+    if (!parse_body(req, body)) return error_response(400, "Invalid JSON body", "VALIDATION_ERROR");
+
+    if (batch) {
+        JsonObj::const_iterator events = body.find("events");
+        if (events == body.end() || !events->second.is<JsonArr>()) {
+            return error_response(400, "events array is required", "VALIDATION_ERROR");
+        }
+        const JsonArr& arr = events->second.get<JsonArr>();
+
+        Lock lock(mutex_);
+        int created = 0;
+        int duplicates = 0;
+        for (size_t i = 0; i < arr.size(); ++i) {
+            if (!arr[i].is<JsonObj>()) continue;
+            const JsonObj& evt = arr[i].get<JsonObj>();
+            std::map<std::string, Run>::iterator run = runs_.find(field(evt, "runId"));
+            if (run == runs_.end()) continue;
+            if (!markIdempotent(field(evt, "idempotencyKey"))) {
+                ++duplicates;
+                continue;
+            }
+            ++created;
+            ++run->second.event_count;
+            run->second.cost_units += number_field(evt, "costUnits");
+        }
+
+        JsonObj obj;
+        obj["success"] = JsonVal(true);
+        obj["created"] = JsonVal(static_cast<double>(created));
+        obj["duplicates"] = JsonVal(static_cast<double>(duplicates));
+        return json_response(201, obj);
+    }
+
+    std::string run_id = field(body, "runId");
+    std::string event_type = field(body, "eventType");
+    if (run_id.empty() || event_type.empty()) {
+        return error_response(400, "runId and eventType are required", "VALIDATION_ERROR");
+    }
+
+    Lock lock(mutex_);
+    std::map<std::string, Run>::iterator run = runs_.find(run_id);
+    if (run == runs_.end()) return error_response(404, "Run not found: " + run_id, "NOT_FOUND");
+
+    bool duplicate = !markIdempotent(field(body, "idempotencyKey"));
+    double cost_units = number_field(body, "costUnits");
+    if (!duplicate) {
+        ++run->second.event_count;
+        run->second.cost_units += cost_units;
+    }
+
+    JsonObj obj;
+    obj["id"] = JsonVal(nextId("evt"));
+    obj["runId"] = JsonVal(run_id);
+    obj["eventType"] = JsonVal(event_type);
+    obj["quantity"] = JsonVal(number_field(body, "quantity"));
+    obj["costUnits"] = JsonVal(cost_units);
+    obj["isDuplicate"] = JsonVal(duplicate);
+    obj["timestamp"] = JsonVal(iso_timestamp(wall_ms()));
+    return json_response(duplicate ? 200 : 201, obj);
+}
+
+// =============================================================================
+// /workflows
+// =============================================================================
+
+MockResponse MockServer::handleWorkflows(const MockRequest& req) {
+    if (req.method == "GET") {
+        Lock lock(mutex_);
+        std::string body = "{\"data\":[";
+        for (std::map<std::string, std::string>::const_iterator it = workflows_.begin();
+             it != workflows_.end(); ++it) {
+            if (it != workflows_.begin()) body += ',';
+            body += it->second;
+        }
+        std::ostringstream tail;
+        tail << "],\"count\":" << workflows_.size() << "}";
+        body += tail.str();
+
+        MockResponse resp;
+        resp.body = body;
+        return resp;
+    }
+
+    if (req.method != "POST") return error_response(405, "Method not allowed", "METHOD_NOT_ALLOWED");
+
+    JsonObj body;
+    if (!parse_body(req, body)) return error_response(400, "Invalid JSON body", "VALIDATION_ERROR");
+
+    std::string name = field(body, "name");
+    std::string slug = field(body, "slug");
+    if (name.empty() || slug.empty()) return error_response(400, "name and slug are required", "VALIDATION_ERROR");
+
+    Lock lock(mutex_);
+    if (workflows_.count(slug)) {
+        return error_response(409, "Workflow with slug " + slug + " already exists", "DUPLICATE_WORKFLOW");
+    }
+
+    JsonObj obj;
+    obj["id"] = JsonVal(nextId("wf"));
+    obj["name"] = JsonVal(name);
+    obj["slug"] = JsonVal(slug);
+    std::string surface = field(body, "productSurface");
+    obj["productSurface"] = JsonVal(surface.empty() ? std::string("CUSTOM") : surface);
+    obj["createdAt"] = JsonVal(iso_timestamp(wall_ms()));
+
+    workflows_[slug] = JsonVal(obj).serialize();
+    workflow_names_[obj["id"].get<std::string>()] = name;
+
+    MockResponse resp;
+    resp.status = 201;
+    resp.body = workflows_[slug];
+    return resp;
+}
+
+} // namespace mock
+} // namespace drip
@@ -0,0 +1,172 @@
+#ifndef DRIP_MOCK_SERVER_HPP
+#define DRIP_MOCK_SERVER_HPP
+
+/*
+ * In-process mock of the Drip API for integration tests, benchmarks and
+ * load tests. Serves HTTP/1.1 with keep-alive on 127.0.0.1, one thread
+ * per connection. POSIX only.
+ *
+ * Implemented routes (with or without the /v1 prefix):
+ *
+ *   GET   /health
+ *   POST  /customers              GET /customers?limit=&offset=&status=&externalCustomerId=
+ *   GET   /customers/{id}         GET /customers/{id}/balance
+ *   POST  /usage/internal
+ *   POST  /runs                   PATCH /runs/{id}
+ *   POST  /run-events             POST /run-events/batch
+ *   GET   /workflows              POST /workflows
+ *
+ * Response bodies mirror the shapes the SDK parses. GET responses carry
+ * an ETag (a hash of the body) and honour If-None-Match with 304 Not
+ * Modified. State is kept in memory for the lifetime of the server.
+ */
+
+#include <string>
+#include <map>
+#include <set>
+
+/* C++03: use <stdint.h> instead of <cstdint> */
+#include <stdint.h>
+
+#include <pthread.h>
+
+namespace drip {
+namespace mock {
+
+struct MockServerOptions {
+    int port;              // 0 picks a free port; see MockServer::port()
+    int latency_ms;        // Added to every response
+    int jitter_ms;         // Uniform extra delay in [0, jitter_ms]
+    double error_rate;     // Fraction of requests (0-1) answered with error_status
+    int error_status;      // 500 by default; 429 adds "Retry-After: 1"
+    uint64_t seed;         // Seeds latency jitter and error injection
+    bool require_auth;     // Reject requests without "Authorization: Bearer ..."
+    bool etags;            // ETag on GET 200s; 304 when If-None-Match matches
+    int64_t starting_balance_micros;  // New customers' balance (micro-USDC)
+    int64_t usage_price_micros;       // Debited per unit of tracked usage
+    bool verbose;          // Log each request to stderr
+
+    MockServerOptions()
+        : port(0)
+        , latency_ms(0)
+        , jitter_ms(0)
+        , error_rate(0.0)
+        , error_status(500)
+        , seed(1)
+        , require_auth(true)
+        , etags(true)
+        , starting_balance_micros(1000000000LL)
+        , usage_price_micros(1000)
+        , verbose(false)
+    {}
+};
+
+struct MockRequest {
+    std::string method;
+    std::string path;       // Without /v1 prefix and query string
+    std::string query;      // Without the leading '?'
+    std::map<std::string, std::string> headers;  // Lower-cased names
+    std::string body;
+};
+
+struct MockResponse {
+    int status;
+    std::string body;
+    std::string extra_headers;  // Raw "Name: value\r\n" lines
+
+    MockResponse() : status(200) {}
+};
+
+class MockServer {
+public:
+    explicit MockServer(const MockServerOptions& options = MockServerOptions());
+    ~MockServer();
+
+    /**
+     * Bind and start accepting connections.
+     * @throws std::runtime_error if the socket cannot be bound.
+     */
+    void start();
+
+    /** Close the listener and all open connections, then join. Idempotent. */
+    void stop();
+
+    /** The bound port (valid after start()). */
+    int port() const { return port_; }
+
+    /** "http://127.0.0.1:<port>/v1", ready for Config::base_url. */
+    std::string baseUrl() const;
+
+    /** Requests answered so far, including injected errors. */
+    uint64_t requestCount() const;
+
+    /** Requests answered with an injected error. */
+    uint64_t injectedErrorCount() const;
+
+    /** Route a parsed request. Public so tests can drive it without sockets. */
+    MockResponse handle(const MockRequest& req, uint64_t& rng_state);
+
+private:
+    /* C++03: non-copyable via private declarations (no = delete) */
+    MockServer(const MockServer&);
+    MockServer& operator=(const MockServer&);
+
+    struct Connection {
+        MockServer* server;
+        int fd;
+        uint64_t rng_state;
+    };
+
+    struct Run {
+        std::string customer_id;
+        std::string workflow_id;
+        std::string workflow_name;
+        int64_t started_ms;
+        int event_count;
+        double cost_units;
+    };
+
+    static void* acceptMain(void* arg);
+    static void* connectionMain(void* arg);
+    void acceptLoop();
+    void serve(Connection* conn);
+
+    MockResponse handleCustomers(const MockRequest& req, const std::string& rest);
+    MockResponse handleRuns(const MockRequest& req, const std::string& rest);
+    MockResponse handleRunEvents(const MockRequest& req, bool batch);
+    MockResponse handleWorkflows(const MockRequest& req);
+    MockResponse handleUsage(const MockRequest& req);
+
+    std::string nextId(const char* prefix);
+    bool markIdempotent(const std::string& key);
+
+    MockServerOptions options_;
+    int listen_fd_;
+    int port_;
+    volatile bool running_;
+    bool started_;
+    pthread_t accept_thread_;
+
+    mutable pthread_mutex_t mutex_;
+    pthread_cond_t idle_cond_;
+    std::set<int> open_fds_;
+    uint64_t connections_accepted_;
+    uint64_t requests_;
+    uint64_t injected_errors_;
+
+    /* API state, guarded by mutex_ */
+    uint64_t next_id_;
+    std::map<std::string, std::string> customers_;        // id -> JSON object
+    std::map<std::string, std::string> customer_status_;  // id -> status
+    std::map<std::string, std::string> customer_by_ext_;  // externalCustomerId -> id
+    std::map<std::string, int64_t> balances_;             // id -> micro-USDC
+    std::map<std::string, std::string> workflows_;        // slug -> JSON object
+    std::map<std::string, std::string> workflow_names_;   // id -> name
+    std::map<std::string, Run> runs_;
+    std::set<std::string> idempotency_keys_;
+};
+
+} // namespace mock
+} // namespace drip
+
+#endif // DRIP_MOCK_SERVER_HPP
@@ -0,0 +1,104 @@
+/**
+ * Drip C++ SDK - Mock API Server
+ *
+ * Standalone mock of the Drip API for benchmarks and load tests.
+ *
+ * Usage:
+ *   drip_mock_server [--port N] [--latency-ms N] [--jitter-ms N]
+ *                    [--error-rate F] [--error-status N] [--seed N]
+ *                    [--no-auth] [--no-etags] [--verbose]
+ *
+ * Point a client at it with:
+ *   DRIP_BASE_URL=http://127.0.0.1:<port>/v1 DRIP_API_KEY=sk_test_mock ...
+ */
+
+#include "mock_server.hpp"
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+
+#include <unistd.h>
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int) {
+    g_stop = 1;
+}
+
+static void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options]\n"
+              << "  --port N          Listen port (default 3001, 0 = any free port)\n"
+              << "  --latency-ms N    Delay added to every response\n"
+              << "  --jitter-ms N     Uniform extra delay in [0, N]\n"
+              << "  --error-rate F    Fraction of requests (0-1) answered with an error\n"
+              << "  --error-status N  Status for injected errors (default 500)\n"
+              << "  --seed N          Seed for jitter and error injection (default 1)\n"
+              << "  --no-auth         Accept requests without an Authorization header\n"
+              << "  --no-etags        Send no ETags, so conditional GETs always get a full body\n"
+              << "  --verbose         Log every request to stderr\n";
+}
+
+int main(int argc, char** argv) {
+    drip::mock::MockServerOptions options;
+    options.port = 3001;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (arg == "--no-auth") {
+            options.require_auth = false;
+        } else if (arg == "--no-etags") {
+            options.etags = false;
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else if (arg == "--help" || arg == "-h") {
+            usage(argv[0]);
+            return 0;
+        } else if (value == NULL) {
+            usage(argv[0]);
+            return 2;
+        } else if (arg == "--port") {
+            options.port = std::atoi(value); ++i;
+        } else if (arg == "--latency-ms") {
+            options.latency_ms = std::atoi(value); ++i;
+        } else if (arg == "--jitter-ms") {
+            options.jitter_ms = std::atoi(value); ++i;
+        } else if (arg == "--error-rate") {
+            options.error_rate = std::atof(value); ++i;
+        } else if (arg == "--error-status") {
+            options.error_status = std::atoi(value); ++i;
+        } else if (arg == "--seed") {
+            options.seed = strtoull(value, NULL, 10); ++i;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    drip::mock::MockServer server(options);
+    try {
+        server.start();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Drip mock API listening on " << server.baseUrl() << std::endl;
+
+    while (!g_stop) {
+        sleep(1);
+    }
+
+    server.stop();
+    std::cout << "Served " << server.requestCount() << " requests ("
+              << server.injectedErrorCount() << " injected errors)" << std::endl;
+    return 0;
+}
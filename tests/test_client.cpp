@@ -5,9 +5,12 @@
  */
 
 #include <drip/drip.hpp>
+#include "balance_cache.hpp"
 #include <iostream>
 #include <cassert>
+#include <limits>
 #include <string>
+#include <vector>
 
 static int tests_passed = 0;
 static int tests_failed = 0;
@@ -33,7 +36,56 @@ void test_config_defaults() {
         drip::Config cfg;
         assert(cfg.api_key.empty());
         assert(cfg.base_url.empty());
+        assert(cfg.base_urls.empty());
+        assert(cfg.probe_interval_ms == 0);
         assert(cfg.timeout_ms == 30000);
+        assert(cfg.connect_timeout_ms == 10000);
+        assert(cfg.coalesce_gets == true);
+        assert(cfg.ack_only == false);
+        assert(cfg.trace_hooks == NULL);
+        assert(cfg.trace_header == "X-Request-Id");
+        assert(cfg.transport == NULL);
+        assert(cfg.max_retries == 0);
+        assert(cfg.retry_backoff_ms == 100);
+        assert(cfg.retry_max_backoff_ms == 5000);
+        assert(cfg.circuit_breaker.enabled == false);
+        assert(cfg.circuit_breaker.window == 20);
+        assert(cfg.circuit_breaker.open_ms == 5000);
+        assert(cfg.hedge.enabled == false);
+        assert(cfg.hedge.delay_ms == 0);
+        assert(cfg.hedge.percentile == 95.0);
+        assert(cfg.hedge.budget_percent == 5.0);
+        assert(cfg.customer_cache.enabled == false);
+        assert(cfg.customer_cache.capacity == 10000);
+        assert(cfg.customer_cache.ttl_ms == 30000);
+        assert(cfg.customer_cache.negative_ttl_ms == 5000);
+        assert(cfg.balance_cache.enabled == false);
+        assert(cfg.balance_cache.max_staleness_ms == 5000);
+        assert(cfg.balance_cache.refresh_below_usdc == 0);
+        assert(cfg.balance_cache.unit_price_usdc.empty());
+        assert(cfg.conditional_gets.enabled == false);
+        assert(cfg.conditional_gets.capacity == 1024);
+        assert(cfg.id_cache.path.empty());
+        assert(cfg.id_cache.refresh_interval_ms == 0);
+        assert(cfg.id_cache.reload_check_ms == 5000);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_request_options_defaults() {
+    TEST(request_options_defaults) {
+        drip::RequestOptions opts;
+        assert(opts.ack_only == false);
+        assert(opts.info == NULL);
+        assert(opts.trace_id.empty());
+        assert(opts.timeout_ms == 0);
+
+        drip::RequestInfo info;
+        assert(info.requests == 0);
+        assert(info.total_us == 0);
+        assert(info.connection_reused == false);
         PASS();
     } catch (const std::exception& e) {
         FAIL(e.what());
@@ -219,6 +271,368 @@ void test_all_structs_initialized() {
     }
 }
 
+// =============================================================================
+// Metrics tests
+// =============================================================================
+
+void test_histogram_buckets() {
+    TEST(histogram_buckets) {
+        /* Buckets tile the value range with no gaps and ~6% relative width */
+        size_t n = drip::HistogramSnapshot::bucketCount();
+        assert(n > 0);
+        assert(drip::HistogramSnapshot::bucketLowerBound(0) == 0);
+        for (size_t i = 0; i + 1 < n; ++i) {
+            uint64_t lo = drip::HistogramSnapshot::bucketLowerBound(i);
+            uint64_t hi = drip::HistogramSnapshot::bucketUpperBound(i);
+            assert(hi > lo);
+            assert(drip::HistogramSnapshot::bucketLowerBound(i + 1) == hi);
+            if (lo >= 16) assert((hi - lo) * 16 <= lo);
+        }
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_histogram_percentiles() {
+    TEST(histogram_percentiles) {
+        drip::HistogramSnapshot h;
+        assert(h.percentile(99) == 0);
+        assert(h.mean() == 0);
+
+        /* 100 samples: 1..100 microseconds, one per bucket-ish */
+        h.counts.resize(drip::HistogramSnapshot::bucketCount());
+        h.min_ns = 1000;
+        h.max_ns = 100000;
+        for (uint64_t v = 1000; v <= 100000; v += 1000) {
+            for (size_t i = 0; i < h.counts.size(); ++i) {
+                if (v >= drip::HistogramSnapshot::bucketLowerBound(i) &&
+                    v < drip::HistogramSnapshot::bucketUpperBound(i)) {
+                    h.counts[i]++;
+                    break;
+                }
+            }
+            h.count++;
+            h.sum_ns += v;
+        }
+        uint64_t p50 = h.percentile(50);
+        uint64_t p99 = h.percentile(99);
+        assert(p50 >= 50000 && p50 <= 53125);
+        assert(p99 >= 99000 && p99 <= 100000);
+        assert(h.percentile(100) == 100000);
+        assert(h.percentile(0) == 1000);
+        assert(h.mean() == 50500);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_metrics_start_empty() {
+    TEST(metrics_start_empty) {
+        drip::Config cfg;
+        cfg.api_key = "sk_test_metrics";
+        cfg.base_url = "http://127.0.0.1:1/v1";
+        drip::Client client(cfg);
+
+        drip::MetricsSnapshot snap = client.metrics();
+        for (int i = 0; i < drip::ENDPOINT_COUNT; ++i) {
+            const drip::EndpointMetrics& m = snap.endpoints[i];
+            assert(m.requests == 0);
+            assert(m.totalErrors() == 0);
+            assert(m.latency.count == 0);
+        }
+        assert(std::string(drip::endpoint_to_string(drip::ENDPOINT_RUN_EVENTS_BATCH)) == "/run-events/batch");
+        assert(std::string(drip::error_kind_to_string(drip::ERROR_RATE_LIMITED)) == "rate_limited");
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_metrics_count_network_errors() {
+    TEST(metrics_count_network_errors) {
+        /* Port 1 on loopback refuses connections immediately */
+        drip::Config cfg;
+        cfg.api_key = "sk_test_metrics";
+        cfg.base_url = "http://127.0.0.1:1/v1";
+        drip::Client client(cfg);
+
+        bool threw = false;
+        try {
+            client.getCustomer("cus_123");
+        } catch (const drip::NetworkError&) {
+            threw = true;
+        }
+        assert(threw);
+
+        /* Per-call info is reset on entry and filled even when the call throws */
+        drip::RequestInfo info;
+        info.requests = 42;
+        drip::RequestOptions opts;
+        opts.info = &info;
+        threw = false;
+        try {
+            client.getBalance("cus_123", opts);
+        } catch (const drip::NetworkError&) {
+            threw = true;
+        }
+        assert(threw);
+        assert(info.requests == 1);
+        assert(info.http_status == 0);
+
+        drip::MetricsSnapshot snap = client.metrics();
+        const drip::EndpointMetrics& m = snap.endpoint(drip::ENDPOINT_CUSTOMERS);
+        assert(m.requests == 2);
+        assert(m.errors[drip::ERROR_NETWORK] == 2);
+        assert(m.latency.count == 2);
+        assert(snap.endpoint(drip::ENDPOINT_USAGE).requests == 0);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+// =============================================================================
+// Tracing tests
+// =============================================================================
+
+/** Records span events as "start:name" / "end:name:ok" strings. */
+class RecordingHooks : public drip::TraceHooks {
+public:
+    std::vector<std::string> events;
+    std::vector<std::string> trace_ids;
+    int attempts;
+
+    RecordingHooks() : attempts(0) {}
+
+    void onOperationStart(drip::OperationSpan& span) {
+        events.push_back(std::string("start:") + span.name);
+    }
+    void onOperationEnd(drip::OperationSpan& span) {
+        events.push_back(std::string("end:") + span.name + (span.ok ? ":ok" : ":fail"));
+        trace_ids.push_back(span.trace_id);
+        if (!span.ok) assert(!span.error.empty());
+    }
+    void onAttemptStart(drip::AttemptSpan& span) {
+        assert(span.operation != NULL);
+        assert(span.attempt == 1);
+    }
+    void onAttemptEnd(drip::AttemptSpan& span) {
+        attempts++;
+        assert(!span.ok);
+        assert(!span.error.empty());
+    }
+};
+
+void test_circuit_breaker_fails_fast() {
+    TEST(circuit_breaker_fails_fast) {
+        drip::Config cfg;
+        cfg.api_key = "sk_test_breaker";
+        cfg.base_url = "http://127.0.0.1:1/v1";
+        cfg.circuit_breaker.enabled = true;
+        cfg.circuit_breaker.window = 2;
+        cfg.circuit_breaker.open_ms = 60000;
+        drip::Client client(cfg);
+
+        for (int i = 0; i < 2; ++i) {
+            try {
+                client.getCustomer("cus_123");
+            } catch (const drip::NetworkError&) {
+            }
+        }
+
+        bool rejected = false;
+        try {
+            client.getBalance("cus_123");
+        } catch (const drip::CircuitOpenError& e) {
+            rejected = true;
+            assert(e.code() == "CIRCUIT_OPEN");
+        }
+        assert(rejected);
+
+        /* Other endpoints have their own breaker */
+        bool network = false;
+        try {
+            drip::TrackUsageParams usage;
+            usage.customer_id = "cus_123";
+            usage.meter = "tokens";
+            usage.quantity = 1;
+            client.trackUsage(usage);
+        } catch (const drip::NetworkError&) {
+            network = true;
+        }
+        assert(network);
+
+        drip::MetricsSnapshot snap = client.metrics();
+        const drip::EndpointMetrics& customers = snap.endpoint(drip::ENDPOINT_CUSTOMERS);
+        assert(customers.requests == 2);
+        assert(customers.circuit_state == drip::CIRCUIT_OPEN);
+        assert(customers.circuit_opens == 1);
+        assert(customers.circuit_rejections == 1);
+        assert(snap.endpoint(drip::ENDPOINT_USAGE).circuit_state == drip::CIRCUIT_CLOSED);
+        assert(client.metricsText().find("drip_circuit_state{endpoint=\"/customers\"} 1") != std::string::npos);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_metrics_text_format() {
+    TEST(metrics_text_format) {
+        drip::Config cfg;
+        cfg.api_key = "sk_test_metrics";
+        cfg.base_url = "http://127.0.0.1:1/v1";
+        drip::Client client(cfg);
+
+        /* Untouched endpoints are omitted; global histograms always render */
+        std::string text = client.metricsText();
+        assert(text.find("endpoint=\"/customers\"") == std::string::npos);
+        assert(text.find("# TYPE drip_parse_duration_seconds histogram") != std::string::npos);
+
+        try {
+            client.getCustomer("cus_123");
+        } catch (const drip::NetworkError&) {
+        }
+
+        text.clear();
+        client.appendMetricsText(text);
+        assert(text.find("# TYPE drip_requests_total counter\n") != std::string::npos);
+        assert(text.find("drip_requests_total{endpoint=\"/customers\"} 1\n") != std::string::npos);
+        assert(text.find("drip_errors_total{endpoint=\"/customers\",kind=\"network\"} 1\n") != std::string::npos);
+        assert(text.find("drip_request_duration_seconds_bucket{endpoint=\"/customers\",le=\"+Inf\"} 1\n") != std::string::npos);
+        assert(text.find("drip_request_duration_seconds_count{endpoint=\"/customers\"} 1\n") != std::string::npos);
+        assert(text.find("endpoint=\"/usage/internal\"") == std::string::npos);
+        assert(text[text.size() - 1] == '\n');
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_trace_hooks_spans() {
+    TEST(trace_hooks_spans) {
+        RecordingHooks hooks;
+        drip::Config cfg;
+        cfg.api_key = "sk_test_trace";
+        cfg.base_url = "http://127.0.0.1:1/v1";
+        cfg.trace_hooks = &hooks;
+        drip::Client client(cfg);
+
+        drip::RecordRunParams run;
+        run.customer_id = "cus_123";
+        run.workflow = "training-run";
+        bool threw = false;
+        try {
+            client.recordRun(run);
+        } catch (const drip::NetworkError&) {
+            threw = true;
+        }
+        assert(threw);
+
+        /* Workflow lookup failure is swallowed; startRun's is not */
+        assert(hooks.events.size() == 6);
+        assert(hooks.events[0] == "start:recordRun");
+        assert(hooks.events[1] == "start:recordRun.resolveWorkflow");
+        assert(hooks.events[2] == "end:recordRun.resolveWorkflow:fail");
+        assert(hooks.events[3] == "start:recordRun.startRun");
+        assert(hooks.events[4] == "end:recordRun.startRun:fail");
+        assert(hooks.events[5] == "end:recordRun:fail");
+        assert(hooks.attempts == 2);
+
+        /* One generated trace id shared by the whole operation */
+        assert(hooks.trace_ids[0].size() == 32);
+        assert(hooks.trace_ids[0] == hooks.trace_ids[2]);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_usdc_parsing_bounds() {
+    TEST(usdc_parsing_bounds) {
+        int64_t micros = 0;
+        assert(drip::detail::parse_usdc_micros("12.5", micros));
+        assert(micros == 12500000);
+        assert(drip::detail::parse_usdc_micros("-0.000001", micros));
+        assert(micros == -1);
+
+        /* Largest whole amount whose micros still fit in int64_t */
+        assert(drip::detail::parse_usdc_micros("9223372036853.999999", micros));
+        assert(micros == 9223372036853999999LL);
+        assert(drip::detail::parse_usdc_micros("-9223372036853", micros));
+        assert(micros == -9223372036853000000LL);
+
+        assert(!drip::detail::parse_usdc_micros("9223372036854", micros));
+        assert(!drip::detail::parse_usdc_micros("12345678901234", micros));
+        assert(!drip::detail::parse_usdc_micros("-12345678901234.5", micros));
+        assert(!drip::detail::parse_usdc_micros("99999999999999999999", micros));
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_balance_cache_unpriceable_debits() {
+    TEST(balance_cache_unpriceable_debits) {
+        drip::BalanceCacheConfig config;
+        config.enabled = true;
+        config.unit_price_usdc["tokens"] = 0.001;
+        drip::detail::MetricsRegistry metrics;
+        drip::detail::BalanceCache cache;
+        cache.configure(config, metrics);
+
+        int64_t micros = 0;
+        uint64_t age_ns = 0;
+        const double bad[] = {
+            std::numeric_limits<double>::quiet_NaN(),
+            std::numeric_limits<double>::infinity(),
+            -1,
+            1e300
+        };
+        for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+            cache.put("cus_1", 1000000, cache.beginFetch("cus_1", 1));
+            cache.debit("cus_1", "tokens", 500);
+            assert(cache.get("cus_1", 2, micros, age_ns));
+            assert(micros == 500000);
+
+            /* Falls back to a fetch instead of converting the product */
+            cache.debit("cus_1", "tokens", bad[i]);
+            assert(!cache.get("cus_1", 3, micros, age_ns));
+        }
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_balance_cache_evicts_least_recently_fetched() {
+    TEST(balance_cache_evicts_least_recently_fetched) {
+        drip::BalanceCacheConfig config;
+        config.enabled = true;
+        config.capacity = 2;
+        drip::detail::MetricsRegistry metrics;
+        drip::detail::BalanceCache cache;
+        cache.configure(config, metrics);
+
+        cache.put("cus_a", 1000000, cache.beginFetch("cus_a", 1));
+        cache.put("cus_b", 1000000, cache.beginFetch("cus_b", 2));
+        cache.put("cus_a", 1000000, cache.beginFetch("cus_a", 3));
+        cache.put("cus_c", 1000000, cache.beginFetch("cus_c", 4));
+
+        int64_t micros = 0;
+        uint64_t age_ns = 0;
+        assert(cache.get("cus_a", 5, micros, age_ns));
+        assert(!cache.get("cus_b", 5, micros, age_ns));
+        assert(cache.get("cus_c", 5, micros, age_ns));
+        assert(metrics.cache(drip::CACHE_BALANCE).evictions == 1);
+        assert(metrics.cache(drip::CACHE_BALANCE).entries == 2);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
 // =============================================================================
 // Main
 // =============================================================================
@@ -228,6 +642,7 @@ int main() {
     std::cout << "==========================" << std::endl;
 
     test_config_defaults();
+    test_request_options_defaults();
     test_track_usage_params();
     test_record_run_params();
     test_run_status_conversion();
@@ -236,6 +651,16 @@ int main() {
     test_emit_event_defaults();
     test_version_defined();
     test_all_structs_initialized();
+    test_histogram_buckets();
+    test_histogram_percentiles();
+    test_metrics_start_empty();
+    test_metrics_count_network_errors();
+    test_metrics_text_format();
+    test_circuit_breaker_fails_fast();
+    test_trace_hooks_spans();
+    test_usdc_parsing_bounds();
+    test_balance_cache_unpriceable_debits();
+    test_balance_cache_evicts_least_recently_fetched();
 
     std::cout << std::endl;
     std::cout << "Results: " << tests_passed << " passed, "
@@ -0,0 +1,1582 @@
+/**
+ * Drip C++ SDK (C++03) - Integration tests.
+ *
+ * Drives a real Client over HTTP against the in-process mock server
+ * (tests/mock_server.hpp), so no live API is needed.
+ */
+
+#include <drip/drip.hpp>
+#include "mock_server.hpp"
+#include "fault_transport.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <cassert>
+#include <string>
+#include <csignal>
+
+#include <pthread.h>
+#include <time.h>
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    std::cout << "  " << #name << "... "; \
+    try
+
+#define PASS() \
+    std::cout << "OK" << std::endl; \
+    tests_passed++;
+
+#define FAIL(msg) \
+    std::cout << "FAIL: " << msg << std::endl; \
+    tests_failed++;
+
+static drip::Config mock_config(const drip::mock::MockServer& server) {
+    drip::Config cfg;
+    cfg.api_key = "sk_test_mock";
+    cfg.base_url = server.baseUrl();
+    cfg.timeout_ms = 5000;
+    return cfg;
+}
+
+// =============================================================================
+// Tests
+// =============================================================================
+
+void test_customer_lifecycle(drip::mock::MockServer& server) {
+    TEST(customer_lifecycle) {
+        drip::Client client(mock_config(server));
+
+        drip::CreateCustomerParams params;
+        params.external_customer_id = "ext_lifecycle";
+        params.metadata["plan"] = "pro";
+        drip::CustomerResult created = client.createCustomer(params);
+        assert(!created.id.empty());
+        assert(created.external_customer_id == "ext_lifecycle");
+        assert(created.status == "ACTIVE");
+        assert(created.metadata["plan"] == "pro");
+
+        drip::CustomerResult fetched = client.getCustomer(created.id);
+        assert(fetched.id == created.id);
+
+        bool conflict = false;
+        try {
+            client.createCustomer(params);
+        } catch (const drip::DripError& e) {
+            conflict = e.status_code() == 409;
+        }
+        assert(conflict);
+
+        bool not_found = false;
+        try {
+            client.getCustomer("cus_missing");
+        } catch (const drip::NotFoundError&) {
+            not_found = true;
+        }
+        assert(not_found);
+
+        drip::ListCustomersResult list = client.listCustomers();
+        assert(list.total >= 1);
+        assert(!list.customers.empty());
+
+        drip::BalanceResult balance = client.getBalance(created.id);
+        assert(balance.customer_id == created.id);
+        assert(balance.balance_usdc == "1000.000000");
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_track_usage_debits_balance(drip::mock::MockServer& server) {
+    TEST(track_usage_debits_balance) {
+        drip::Client client(mock_config(server));
+
+        drip::CreateCustomerParams cparams;
+        cparams.external_customer_id = "ext_usage";
+        std::string customer_id = client.createCustomer(cparams).id;
+
+        drip::TrackUsageParams params;
+        params.customer_id = customer_id;
+        params.meter = "tokens";
+        params.quantity = 1000;
+        params.idempotency_key = "usage_once";
+        drip::TrackUsageResult result = client.trackUsage(params);
+        assert(result.success);
+        assert(!result.usage_event_id.empty());
+
+        /* Replays with the same key are not charged twice */
+        client.trackUsage(params);
+        assert(client.getBalance(customer_id).balance_usdc == "999.000000");
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_ack_only(drip::mock::MockServer& server) {
+    TEST(ack_only) {
+        drip::Client client(mock_config(server));
+        drip::CreateCustomerParams cparams;
+        cparams.external_customer_id = "ext_ack_only";
+        std::string customer_id = client.createCustomer(cparams).id;
+
+        drip::TrackUsageParams params;
+        params.customer_id = customer_id;
+        params.meter = "tokens";
+        params.quantity = 250;
+
+        drip::RequestOptions per_call;
+        per_call.ack_only = true;
+        drip::Config cfg = mock_config(server);
+        cfg.ack_only = true;
+        drip::Client acking(cfg);
+
+        /* 2xx: result echoes params; the server's fields are never parsed */
+        drip::TrackUsageResult results[2];
+        params.idempotency_key = "ack_per_call";
+        results[0] = client.trackUsage(params, per_call);
+        params.idempotency_key = "ack_config";
+        results[1] = acking.trackUsage(params);
+        for (int i = 0; i < 2; ++i) {
+            assert(results[i].success);
+            assert(results[i].customer_id == customer_id);
+            assert(results[i].usage_type == "tokens");
+            assert(results[i].quantity == 250);
+            assert(results[i].usage_event_id.empty());
+            assert(results[i].message.empty());
+        }
+        assert(acking.metrics().parse.count == 0);
+        assert(client.metrics().endpoint(drip::ENDPOINT_USAGE).parse_ns == 0);
+        assert(client.getBalance(customer_id).balance_usdc == "999.500000");
+
+        /* 4xx: the error body is still parsed into the exception */
+        params.customer_id = "cus_ack_missing";
+        for (int i = 0; i < 2; ++i) {
+            std::string message;
+            try {
+                if (i == 0) client.trackUsage(params, per_call);
+                else acking.trackUsage(params);
+            } catch (const drip::NotFoundError& e) {
+                assert(e.status_code() == 404);
+                assert(e.code() == "NOT_FOUND");
+                message = e.what();
+            }
+            assert(message == "Customer not found: cus_ack_missing");
+        }
+        assert(acking.metrics().parse.count == 1);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_record_run(drip::mock::MockServer& server) {
+    TEST(record_run) {
+        drip::Client client(mock_config(server));
+
+        drip::CreateCustomerParams cparams;
+        cparams.external_customer_id = "ext_run";
+        std::string customer_id = client.createCustomer(cparams).id;
+
+        drip::RecordRunParams params;
+        params.customer_id = customer_id;
+        params.workflow = "integration-flow";
+        params.status = drip::RUN_COMPLETED;
+        for (int i = 0; i < 3; ++i) {
+            drip::RecordRunEvent evt;
+            evt.event_type = "step";
+            evt.quantity = i + 1;
+            evt.cost_units = 0.5;
+            params.events.push_back(evt);
+        }
+
+        drip::RecordRunResult result = client.recordRun(params);
+        assert(!result.run.id.empty());
+        assert(!result.run.workflow_id.empty());
+        assert(result.events.created == 3);
+        assert(result.events.duplicates == 0);
+        assert(result.total_cost_units == "1.500000");
+
+        /* Second run reuses the workflow created by the first */
+        drip::RecordRunResult again = client.recordRun(params);
+        assert(again.run.workflow_id == result.run.workflow_id);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_ping_and_auth(drip::mock::MockServer& server) {
+    TEST(ping_and_auth) {
+        drip::Client client(mock_config(server));
+        drip::PingResult ping = client.ping();
+        assert(ping.ok);
+        assert(ping.status == "healthy");
+
+        drip::MetricsSnapshot snap = client.metrics();
+        assert(snap.endpoint(drip::ENDPOINT_HEALTH).requests == 1);
+        assert(snap.endpoint(drip::ENDPOINT_HEALTH).totalErrors() == 0);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_error_injection() {
+    TEST(error_injection) {
+        drip::mock::MockServerOptions options;
+        options.error_rate = 1.0;
+        options.error_status = 503;
+        drip::mock::MockServer failing(options);
+        failing.start();
+
+        drip::Client client(mock_config(failing));
+        int status = 0;
+        try {
+            client.getCustomer("cus_any");
+        } catch (const drip::DripError& e) {
+            status = e.status_code();
+        }
+        assert(status == 503);
+        assert(failing.injectedErrorCount() == 1);
+
+        drip::MetricsSnapshot snap = client.metrics();
+        assert(snap.endpoint(drip::ENDPOINT_CUSTOMERS).errors[drip::ERROR_SERVER] == 1);
+        failing.stop();
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_retry_policy(drip::mock::MockServer& server) {
+    TEST(retry_policy) {
+        /* Every other request is answered 503: 0 fails, 1 succeeds, ... */
+        drip::mock::FaultScenario scenario;
+        scenario.burst_every = 2;
+        scenario.burst_length = 1;
+        scenario.burst_status = 503;
+        drip::CurlTransport inner;
+        drip::mock::FaultInjectionTransport faults(inner, scenario);
+
+        drip::Config cfg = mock_config(server);
+        cfg.transport = &faults;
+        cfg.max_retries = 2;
+        cfg.retry_backoff_ms = 1;
+        drip::Client client(cfg);
+
+        /* Idempotent: retried once and succeeds */
+        drip::CreateCustomerParams cparams;
+        cparams.external_customer_id = "ext_retry";
+        drip::TrackUsageParams usage;
+        usage.customer_id = drip::Client(mock_config(server)).createCustomer(cparams).id;
+        usage.meter = "tokens";
+        usage.quantity = 3;
+        assert(client.trackUsage(usage).success);
+        assert(faults.requestCount() == 2);
+        assert(client.metrics().endpoint(drip::ENDPOINT_USAGE).retries == 1);
+
+        /* Not idempotent: a 5xx on createCustomer is not retried */
+        int status = 0;
+        try {
+            cparams.external_customer_id = "ext_retry_2";
+            client.createCustomer(cparams);
+        } catch (const drip::DripError& e) {
+            status = e.status_code();
+        }
+        assert(status == 503);
+        assert(faults.requestCount() == 3);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_circuit_breaker_recovers(drip::mock::MockServer& server) {
+    TEST(circuit_breaker_recovers) {
+        /* The first four requests get 503, everything after succeeds */
+        drip::mock::FaultScenario scenario;
+        scenario.burst_every = 1000000;
+        scenario.burst_length = 4;
+        drip::CurlTransport inner;
+        drip::mock::FaultInjectionTransport faults(inner, scenario);
+
+        drip::Config cfg = mock_config(server);
+        cfg.transport = &faults;
+        cfg.circuit_breaker.enabled = true;
+        cfg.circuit_breaker.window = 4;
+        cfg.circuit_breaker.open_ms = 50;
+        drip::Client client(cfg);
+
+        drip::CreateCustomerParams cparams;
+        cparams.external_customer_id = "ext_breaker";
+        std::string id = drip::Client(mock_config(server)).createCustomer(cparams).id;
+
+        for (int i = 0; i < 4; ++i) {
+            try {
+                client.getCustomer(id);
+            } catch (const drip::DripError& e) {
+                assert(e.status_code() == 503);
+            }
+        }
+        bool rejected = false;
+        try {
+            client.getCustomer(id);
+        } catch (const drip::CircuitOpenError&) {
+            rejected = true;
+        }
+        assert(rejected);
+        assert(faults.requestCount() == 4);
+
+        /* After open_ms one probe goes through, succeeds and closes the breaker */
+        struct timespec ts = { 0, 80 * 1000000L };
+        nanosleep(&ts, NULL);
+        assert(client.getCustomer(id).id == id);
+        assert(client.getCustomer(id).id == id);
+        drip::MetricsSnapshot snap = client.metrics();
+        assert(snap.endpoint(drip::ENDPOINT_CUSTOMERS).circuit_state == drip::CIRCUIT_CLOSED);
+        assert(snap.endpoint(drip::ENDPOINT_CUSTOMERS).circuit_opens == 1);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_call_deadline(drip::mock::MockServer& server) {
+    TEST(call_deadline) {
+        /* 60 ms per request: recordRun's four requests cannot fit in 150 ms */
+        drip::mock::FaultScenario scenario;
+        scenario.latency = drip::mock::LATENCY_FIXED;
+        scenario.latency_ms = 60;
+        drip::CurlTransport inner;
+        drip::mock::FaultInjectionTransport faults(inner, scenario);
+
+        drip::Config cfg = mock_config(server);
+        cfg.transport = &faults;
+        cfg.max_retries = 3;
+        drip::Client client(cfg);
+
+        drip::CreateCustomerParams cparams;
+        cparams.external_customer_id = "ext_deadline";
+        drip::RecordRunParams params;
+        params.customer_id = drip::Client(mock_config(server)).createCustomer(cparams).id;
+        params.workflow = "deadline-test";
+        drip::RecordRunEvent evt;
+        evt.event_type = "step";
+        params.events.push_back(evt);
+
+        drip::RequestOptions opts;
+        opts.timeout_ms = 150;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        bool timed_out = false;
+        try {
+            client.recordRun(params, opts);
+        } catch (const drip::TimeoutError&) {
+            timed_out = true;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        long elapsed_ms = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+        assert(timed_out);
+        assert(elapsed_ms < 400);
+        assert(faults.requestCount() <= 3);
+
+        /* Without a deadline the same call completes */
+        assert(client.recordRun(params).run.id.size() > 0);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_hedged_reads(drip::mock::MockServer& server) {
+    TEST(hedged_reads) {
+        /* The first request stalls for a second; later ones are prompt */
+        drip::mock::FaultScenario scenario;
+        scenario.burst_every = 1000000;
+        scenario.burst_length = 1;
+        scenario.burst_status = 0;
+        scenario.burst_latency_ms = 1000;
+        drip::CurlTransport inner;
+        drip::mock::FaultInjectionTransport faults(inner, scenario);
+
+        drip::Config cfg = mock_config(server);
+        cfg.transport = &faults;
+        cfg.hedge.enabled = true;
+        cfg.hedge.delay_ms = 50;
+        cfg.hedge.budget_percent = 100;
+        drip::Client client(cfg);
+
+        drip::CreateCustomerParams cparams;
+        cparams.external_customer_id = "ext_hedge";
+        std::string id = drip::Client(mock_config(server)).createCustomer(cparams).id;
+
+        /* The hedge answers first and the stalled original is cancelled */
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        assert(client.getCustomer(id).id == id);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        long elapsed_ms = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+        assert(elapsed_ms < 500);
+        assert(faults.requestCount() == 2);
+
+        /* A prompt answer is never hedged */
+        assert(client.getBalance(id).customer_id == id);
+        assert(faults.requestCount() == 3);
+
+        drip::MetricsSnapshot snap = client.metrics();
+        assert(snap.endpoint(drip::ENDPOINT_CUSTOMERS).hedges == 1);
+        assert(snap.endpoint(drip::ENDPOINT_CUSTOMERS).hedge_wins == 1);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+/**
+ * Stalls the first request for stall_ms, then passes it on (stall_status
+ * 0) or answers it with stall_status. Every later request gets a 503 at
+ * once.
+ */
+class StallThenFailTransport : public drip::Transport {
+public:
+    StallThenFailTransport(drip::Transport& inner, int stall_ms, int stall_status)
+        : inner_(inner)
+        , stall_ms_(stall_ms)
+        , stall_status_(stall_status)
+        , requests_(0)
+    {
+        pthread_mutex_init(&mutex_, NULL);
+    }
+
+    ~StallThenFailTransport() {
+        pthread_mutex_destroy(&mutex_);
+    }
+
+    void perform(const drip::HttpRequest& request, drip::HttpResponse& response) {
+        pthread_mutex_lock(&mutex_);
+        int n = requests_++;
+        pthread_mutex_unlock(&mutex_);
+        if (n > 0) {
+            unavailable(response);
+            return;
+        }
+        for (int waited = 0; waited < stall_ms_; waited += 10) {
+            if (request.cancellation && request.cancellation->isCancelled()) {
+                response.status = drip::TRANSPORT_CANCELLED;
+                response.error = "Request cancelled";
+                return;
+            }
+            struct timespec ts = {0, 10 * 1000000L};
+            nanosleep(&ts, NULL);
+        }
+        if (stall_status_ == 0) {
+            inner_.perform(request, response);
+        } else {
+            unavailable(response);
+        }
+    }
+
+    int requestCount() {
+        pthread_mutex_lock(&mutex_);
+        int n = requests_;
+        pthread_mutex_unlock(&mutex_);
+        return n;
+    }
+
+private:
+    static void unavailable(drip::HttpResponse& response) {
+        response.status = drip::TRANSPORT_OK;
+        response.http_status = 503;
+        response.body = "{\"message\":\"Service unavailable\",\"code\":\"UNAVAILABLE\"}";
+    }
+
+    drip::Transport& inner_;
+    int stall_ms_;
+    int stall_status_;
+    pthread_mutex_t mutex_;
+    int requests_;
+};
+
+void test_hedge_failed_leg_loses(drip::mock::MockServer& server) {
+    TEST(hedge_failed_leg_loses) {
+        drip::CreateCustomerParams cparams;
+        cparams.external_customer_id = "ext_hedge_fail";
+        std::string id = drip::Client(mock_config(server)).createCustomer(cparams).id;
+
+        drip::CurlTransport inner;
+        drip::Config cfg = mock_config(server);
+        cfg.hedge.enabled = true;
+        cfg.hedge.delay_ms = 50;
+        cfg.hedge.budget_percent = 100;
+
+        /* A fast 503 on the hedge does not beat the slow but healthy original */
+        StallThenFailTransport slow_ok(inner, 200, 0);
+        cfg.transport = &slow_ok;
+        drip::Client client(cfg);
+        assert(client.getCustomer(id).id == id);
+        assert(slow_ok.requestCount() == 2);
+        drip::MetricsSnapshot snap = client.metrics();
+        assert(snap.endpoint(drip::ENDPOINT_CUSTOMERS).hedges == 1);
+        assert(snap.endpoint(drip::ENDPOINT_CUSTOMERS).hedge_wins == 0);
+
+        /* The error is returned only once both have failed */
+        StallThenFailTransport slow_fail(inner, 200, 503);
+        cfg.transport = &slow_fail;
+        drip::Client failing(cfg);
+        int status = 0;
+        try {
+            failing.getCustomer(id);
+        } catch (const drip::DripError& e) {
+            status = e.status_code();
+        }
+        assert(status == 503);
+        assert(slow_fail.requestCount() == 2);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_failover(drip::mock::MockServer& server) {
+    TEST(failover) {
+        drip::CreateCustomerParams cparams;
+        cparams.external_customer_id = "ext_failover";
+        std::string id = drip::Client(mock_config(server)).createCustomer(cparams).id;
+
+        /* Nothing listens on port 1: the first base URL refuses connections */
+        drip::Config cfg = mock_config(server);
+        cfg.base_urls.push_back("http://127.0.0.1:1/v1");
+        cfg.base_urls.push_back(server.baseUrl());
+        drip::Client client(cfg);
+
+        /* Fails over without max_retries, then keeps to the working URL */
+        assert(client.getCustomer(id).id == id);
+        assert(client.getBalance(id).customer_id == id);
+        assert(client.ping().ok);
+        drip::MetricsSnapshot snap = client.metrics();
+        assert(snap.endpoint(drip::ENDPOINT_CUSTOMERS).failovers == 1);
+        assert(snap.endpoint(drip::ENDPOINT_CUSTOMERS).errors[drip::ERROR_NETWORK] == 1);
+        assert(snap.endpoint(drip::ENDPOINT_HEALTH).failovers == 0);
+
+        /* With probes on, the dead URL is known bad before the first call */
+        cfg.probe_interval_ms = 20;
+        drip::Client probed(cfg);
+        struct timespec ts = { 0, 100 * 1000000L };
+        nanosleep(&ts, NULL);
+        assert(probed.getCustomer(id).id == id);
+        assert(probed.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).failovers == 0);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+/** Poll health() until a probe has completed, for up to a second. */
+static drip::HealthSnapshot first_health(const drip::Client& client) {
+    drip::HealthSnapshot h = client.health();
+    for (int i = 0; i < 100 && h.checks == 0; ++i) {
+        struct timespec ts = { 0, 10 * 1000000L };
+        nanosleep(&ts, NULL);
+        h = client.health();
+    }
+    return h;
+}
+
+void test_health_monitor(drip::mock::MockServer& server) {
+    TEST(health_monitor) {
+        /* Monitor off: nothing is probed */
+        drip::Client plain(mock_config(server));
+        assert(plain.health().checks == 0);
+
+        drip::Config cfg = mock_config(server);
+        cfg.probe_interval_ms = 20;
+        drip::Client client(cfg);
+        drip::HealthSnapshot h = first_health(client);
+        assert(h.checks > 0);
+        assert(h.ok);
+        assert(h.status == "healthy");
+        assert(h.error.empty());
+        assert(h.base_url == server.baseUrl());
+        assert(h.latency_ns > 0);
+        assert(h.age_ns >= 0);
+        assert(client.metrics().endpoint(drip::ENDPOINT_HEALTH).requests == 0);
+
+        cfg.base_url = "http://127.0.0.1:1/v1";
+        drip::Client down(cfg);
+        h = first_health(down);
+        assert(h.checks > 0);
+        assert(!h.ok);
+        assert(!h.error.empty());
+        assert(h.failures == h.checks);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_customer_cache(drip::mock::MockServer& server) {
+    TEST(customer_cache) {
+        drip::Config cfg = mock_config(server);
+        cfg.customer_cache.enabled = true;
+        cfg.customer_cache.capacity = 2;
+        cfg.customer_cache.ttl_ms = 60000;
+        drip::Client client(cfg);
+
+        drip::CreateCustomerParams cparams;
+        cparams.external_customer_id = "ext_cache_a";
+        std::string a = client.createCustomer(cparams).id;
+        cparams.external_customer_id = "ext_cache_b";
+        std::string b = client.createCustomer(cparams).id;
+
+        /* createCustomer() filled the cache: no GETs */
+        assert(client.getCustomer(a).id == a);
+        assert(client.getCustomer(b).id == b);
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == 2);
+
+        /* Not found is cached too */
+        for (int i = 0; i < 2; ++i) {
+            bool not_found = false;
+            try {
+                client.getCustomer("cus_missing");
+            } catch (const drip::NotFoundError&) {
+                not_found = true;
+            }
+            assert(not_found);
+        }
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == 3);
+
+        /* The miss above evicted the least recently used entry (a) */
+        assert(client.getCustomer(b).id == b);
+        assert(client.getCustomer(a).id == a);
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == 4);
+
+        client.invalidateCustomer(a);
+        assert(client.getCustomer(a).id == a);
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == 5);
+
+        drip::CacheMetrics cm = client.metrics().cache(drip::CACHE_CUSTOMER);
+        assert(cm.hits == 4);
+        assert(cm.negative_hits == 1);
+        assert(cm.misses == 3);
+        assert(cm.evictions == 2);
+        assert(cm.entries == 2);
+        assert(client.metricsText().find("drip_cache_lookups_total{cache=\"customer\",result=\"hit\"} 3") != std::string::npos);
+
+        /* Expired entries are fetched again */
+        cfg.customer_cache.ttl_ms = 30;
+        drip::Client short_lived(cfg);
+        assert(short_lived.getCustomer(a).id == a);
+        struct timespec ts = { 0, 60 * 1000000L };
+        nanosleep(&ts, NULL);
+        assert(short_lived.getCustomer(a).id == a);
+        assert(short_lived.metrics().cache(drip::CACHE_CUSTOMER).misses == 2);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_customer_index(drip::mock::MockServer& server) {
+    TEST(customer_index) {
+        drip::Config cfg = mock_config(server);
+        drip::Client writer(cfg);
+        drip::CreateCustomerParams cparams;
+        cparams.external_customer_id = "ext_index_a";
+        std::string a = writer.createCustomer(cparams).id;
+
+        drip::Client client(cfg);
+        size_t indexed = client.warmCustomerIndex();
+        assert(indexed >= 1);
+        uint64_t list_requests = client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests;
+
+        /* Warm index: no round trip */
+        assert(client.resolveCustomer("ext_index_a") == a);
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == list_requests);
+
+        /* Created by another client: one page of new customers */
+        cparams.external_customer_id = "ext_index_b";
+        std::string b = writer.createCustomer(cparams).id;
+        assert(client.resolveCustomer("ext_index_b") == b);
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == list_requests + 1);
+
+        /* Created through this client: indexed on the way back */
+        cparams.external_customer_id = "ext_index_c";
+        std::string c = client.createCustomer(cparams).id;
+        uint64_t requests = client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests;
+        assert(client.resolveCustomer("ext_index_c") == c);
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == requests);
+
+        bool not_found = false;
+        try {
+            client.resolveCustomer("ext_index_missing");
+        } catch (const drip::NotFoundError&) {
+            not_found = true;
+        }
+        assert(not_found);
+
+        drip::CacheMetrics cm = client.metrics().cache(drip::CACHE_CUSTOMER_INDEX);
+        assert(cm.hits == 2);
+        assert(cm.misses == 2);
+        assert(cm.entries == indexed + 2);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_balance_cache(drip::mock::MockServer& server) {
+    TEST(balance_cache) {
+        drip::Config cfg = mock_config(server);
+        cfg.balance_cache.enabled = true;
+        cfg.balance_cache.max_staleness_ms = 60000;
+        cfg.balance_cache.refresh_below_usdc = 998.5;
+        cfg.balance_cache.unit_price_usdc["tokens"] = 0.001;   /* The mock's price */
+        drip::Client client(cfg);
+
+        drip::CreateCustomerParams cparams;
+        cparams.external_customer_id = "ext_balance_cache";
+        std::string id = client.createCustomer(cparams).id;
+        uint64_t requests = client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests;
+
+        drip::BalanceResult b = client.getBalance(id);
+        assert(!b.estimated);
+        assert(b.balance_usdc == "1000.000000");
+
+        /* Tracked usage is subtracted locally */
+        drip::TrackUsageParams usage;
+        usage.customer_id = id;
+        usage.meter = "tokens";
+        usage.quantity = 1000;
+        client.trackUsage(usage);
+        b = client.getBalance(id);
+        assert(b.estimated);
+        assert(b.balance_usdc == "999.000000");
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == requests + 1);
+
+        /* Estimate below the threshold: fetched again */
+        usage.quantity = 1500;
+        client.trackUsage(usage);
+        b = client.getBalance(id);
+        assert(!b.estimated);
+        assert(b.balance_usdc == "997.500000");
+
+        /* Unpriced meter: fetched again */
+        cfg.balance_cache.refresh_below_usdc = 0;
+        drip::Client priced(cfg);
+        assert(!priced.getBalance(id).estimated);
+        assert(priced.getBalance(id).estimated);
+        usage.meter = "api_calls";
+        usage.quantity = 1;
+        priced.trackUsage(usage);
+        b = priced.getBalance(id);
+        assert(!b.estimated);
+        assert(b.balance_usdc == "997.499000");
+
+        /* Past the staleness bound: fetched again */
+        cfg.balance_cache.max_staleness_ms = 30;
+        drip::Client short_lived(cfg);
+        short_lived.getBalance(id);
+        struct timespec ts = { 0, 60 * 1000000L };
+        nanosleep(&ts, NULL);
+        assert(!short_lived.getBalance(id).estimated);
+
+        drip::CacheMetrics cm = client.metrics().cache(drip::CACHE_BALANCE);
+        assert(cm.hits == 1);
+        assert(cm.misses == 2);
+        assert(cm.entries == 1);
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_conditional_gets(drip::mock::MockServer& server) {
+    TEST(conditional_gets) {
+        drip::Config cfg = mock_config(server);
+        cfg.conditional_gets.enabled = true;
+        drip::Client client(cfg);
+
+        drip::CreateCustomerParams cparams;
+        cparams.external_customer_id = "ext_conditional";
+        std::string id = client.createCustomer(cparams).id;
+
+        /* The second read is answered 304 and served from the kept body */
+        assert(client.getCustomer(id).id == id);
+        drip::CustomerResult again = client.getCustomer(id);
+        assert(again.id == id);
+        assert(again.external_customer_id == "ext_conditional");
+        drip::CacheMetrics cm = client.metrics().cache(drip::CACHE_CONDITIONAL);
+        assert(cm.hits == 1);
+        assert(cm.misses == 1);
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).totalErrors() == 0);
+
+        /* The workflow list revalidates until a new workflow changes it */
+        drip::RecordRunParams params;
+        params.customer_id = id;
+        params.workflow = "conditional-flow";
+        params.status = drip::RUN_COMPLETED;
+        std::string workflow_id = client.recordRun(params).run.workflow_id;
+        assert(client.recordRun(params).run.workflow_id == workflow_id);
+        assert(client.recordRun(params).run.workflow_id == workflow_id);
+        cm = client.metrics().cache(drip::CACHE_CONDITIONAL);
+        assert(cm.hits == 2);
+        assert(cm.misses == 3);
+        assert(cm.entries == 2);
+
+        /* Off by default */
+        drip::Client plain(mock_config(server));
+        plain.getCustomer(id);
+        plain.getCustomer(id);
+        assert(plain.metrics().cache(drip::CACHE_CONDITIONAL).hits == 0);
+        assert(plain.metrics().cache(drip::CACHE_CONDITIONAL).misses == 0);
+
+        /* A server without validators costs no misses and keeps nothing */
+        drip::mock::MockServerOptions mock_options;
+        mock_options.etags = false;
+        drip::mock::MockServer no_etags(mock_options);
+        no_etags.start();
+        drip::Config no_etags_cfg = mock_config(no_etags);
+        no_etags_cfg.conditional_gets.enabled = true;
+        drip::Client unvalidated(no_etags_cfg);
+        std::string other_id = unvalidated.createCustomer(cparams).id;
+        unvalidated.getCustomer(other_id);
+        unvalidated.getCustomer(other_id);
+        cm = unvalidated.metrics().cache(drip::CACHE_CONDITIONAL);
+        assert(cm.hits == 0);
+        assert(cm.misses == 0);
+        assert(cm.entries == 0);
+        no_etags.stop();
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_customer_iterator() {
+    TEST(customer_iterator) {
+        drip::mock::MockServer fresh;
+        fresh.start();
+        drip::Client client(mock_config(fresh));
+        drip::CreateCustomerParams cparams;
+        for (int i = 0; i < 250; ++i) {
+            std::ostringstream ext;
+            ext << "ext_iter_" << i;
+            cparams.external_customer_id = ext.str();
+            client.createCustomer(cparams);
+        }
+
+        /* Prefetching: every customer once, in creation order, three pages */
+        drip::CustomerIterator it(client);
+        drip::CustomerResult customer;
+        std::set<std::string> seen;
+        int n = 0;
+        while (it.next(customer)) {
+            std::ostringstream ext;
+            ext << "ext_iter_" << n++;
+            assert(customer.external_customer_id == ext.str());
+            seen.insert(customer.id);
+        }
+        assert(n == 250);
+        assert(seen.size() == 250);
+        assert(it.total() == 250);
+        assert(it.pagesFetched() == 3);
+        assert(!it.next(customer));
+
+        /* On demand, from an offset */
+        drip::CustomerIteratorOptions options;
+        options.page_size = 40;
+        options.prefetch_pages = 0;
+        options.offset = 200;
+        drip::CustomerIterator tail(client, options);
+        n = 0;
+        while (tail.next(customer)) ++n;
+        assert(n == 50);
+        assert(tail.pagesFetched() == 2);
+
+        /* Dropped mid-walk: the prefetch thread stops */
+        {
+            drip::CustomerIterator partial(client);
+            assert(partial.next(customer));
+        }
+
+        /* A failed page surfaces on the calling thread */
+        drip::Config cfg = mock_config(fresh);
+        cfg.base_url = "http://127.0.0.1:1/v1";
+        drip::Client down(cfg);
+        drip::CustomerIterator broken(down);
+        bool failed = false;
+        try {
+            broken.next(customer);
+        } catch (const drip::NetworkError&) {
+            failed = true;
+        }
+        assert(failed);
+        assert(!broken.next(customer));
+
+        fresh.stop();
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+/* Collects exported customers; throws after `fail_after` of them if set. */
+class CollectingSink : public drip::CustomerSink {
+public:
+    std::vector<drip::CustomerResult> customers;
+    size_t fail_after;
+
+    CollectingSink() : fail_after(0) {}
+
+    void onCustomer(const drip::CustomerResult& customer) {
+        if (fail_after > 0 && customers.size() == fail_after) {
+            throw std::runtime_error("sink full");
+        }
+        customers.push_back(customer);
+    }
+};
+
+void test_export_customers() {
+    TEST(export_customers) {
+        drip::mock::MockServer fresh;
+        fresh.start();
+        drip::Client client(mock_config(fresh));
+        drip::CreateCustomerParams cparams;
+        for (int i = 0; i < 250; ++i) {
+            std::ostringstream ext;
+            ext << "ext_export_" << i;
+            cparams.external_customer_id = ext.str();
+            client.createCustomer(cparams);
+        }
+
+        /* Concurrent pages, delivered in creation order */
+        drip::ExportCustomersOptions options;
+        options.page_size = 20;
+        options.concurrency = 4;
+        CollectingSink sink;
+        drip::ExportCustomersResult result = client.exportCustomers(sink, options);
+        assert(sink.customers.size() == 250);
+        for (size_t i = 0; i < sink.customers.size(); ++i) {
+            std::ostringstream ext;
+            ext << "ext_export_" << i;
+            assert(sink.customers[i].external_customer_id == ext.str());
+        }
+        assert(result.customers == 250);
+        assert(result.pages == 13);
+        assert(result.customers_per_second > 0);
+        assert(result.pages_per_second > 0);
+
+        /* One pass per status */
+        options.statuses.push_back("ACTIVE");
+        options.statuses.push_back("PAUSED");
+        CollectingSink by_status;
+        result = client.exportCustomers(by_status, options);
+        assert(result.customers == 250);
+        assert(result.pages == 14);
+
+        /* NDJSON file */
+        const char* path = "export_customers_test.ndjson";
+        result = client.exportCustomersToFile(path, drip::ExportCustomersOptions());
+        assert(result.customers == 250);
+        std::ifstream in(path);
+        std::string line;
+        int lines = 0;
+        while (std::getline(in, line)) {
+            if (lines == 0) assert(line.find("\"externalCustomerId\":\"ext_export_0\"") != std::string::npos);
+            ++lines;
+        }
+        in.close();
+        std::remove(path);
+        assert(lines == 250);
+
+        bool io_error = false;
+        try {
+            client.exportCustomersToFile("/nonexistent_dir/export.ndjson");
+        } catch (const drip::DripError& e) {
+            io_error = e.code() == "IO_ERROR";
+        }
+        assert(io_error);
+
+        /* A throwing sink aborts the export */
+        CollectingSink limited;
+        limited.fail_after = 30;
+        bool aborted = false;
+        try {
+            client.exportCustomers(limited, options);
+        } catch (const std::runtime_error&) {
+            aborted = true;
+        }
+        assert(aborted);
+        assert(limited.customers.size() == 30);
+
+        /* A failed page surfaces on the calling thread */
+        drip::Config cfg = mock_config(fresh);
+        cfg.base_url = "http://127.0.0.1:1/v1";
+        drip::Client down(cfg);
+        bool failed = false;
+        try {
+            down.exportCustomers(sink);
+        } catch (const drip::NetworkError&) {
+            failed = true;
+        }
+        assert(failed);
+
+        fresh.stop();
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+/* Counts createCustomers() progress calls; throws at `fail_at` if set. */
+/** Records the name, parent and trace id of every finished operation span. */
+class SpanRecorder : public drip::TraceHooks {
+public:
+    struct Span {
+        std::string name;
+        std::string parent;
+        std::string trace_id;
+    };
+
+    SpanRecorder() {
+        pthread_mutex_init(&mutex_, NULL);
+    }
+
+    ~SpanRecorder() {
+        pthread_mutex_destroy(&mutex_);
+    }
+
+    void onOperationEnd(drip::OperationSpan& span) {
+        Span s;
+        s.name = span.name;
+        s.parent = span.parent ? span.parent->name : "";
+        s.trace_id = span.trace_id;
+        pthread_mutex_lock(&mutex_);
+        spans.push_back(s);
+        pthread_mutex_unlock(&mutex_);
+    }
+
+    /* Read once the client is idle */
+    std::vector<Span> spans;
+
+    /* Every span but the last (the top-level call) is its child, in the same trace; returns their count. */
+    size_t checkChildrenOf(const std::string& name) const {
+        assert(!spans.empty());
+        const Span& root = spans.back();
+        assert(root.name == name);
+        assert(root.parent.empty());
+        for (size_t i = 0; i + 1 < spans.size(); ++i) {
+            assert(spans[i].parent == name);
+            assert(spans[i].trace_id == root.trace_id);
+        }
+        return spans.size() - 1;
+    }
+
+private:
+    pthread_mutex_t mutex_;
+};
+
+class CountingProgress : public drip::CreateCustomersProgress {
+public:
+    size_t calls;
+    size_t last_completed;
+    size_t fail_at;
+
+    CountingProgress() : calls(0), last_completed(0), fail_at(0) {}
+
+    void onItem(size_t /*index*/, const drip::CreateCustomerItem& /*item*/, size_t completed,
+                size_t /*total*/) {
+        ++calls;
+        last_completed = completed;
+        if (fail_at > 0 && calls == fail_at) throw std::runtime_error("stop import");
+    }
+};
+
+void test_create_customers() {
+    TEST(create_customers) {
+        drip::mock::MockServerOptions mock_options;
+        mock_options.latency_ms = 50;
+        drip::mock::MockServer slow(mock_options);
+        slow.start();
+        drip::Client client(mock_config(slow));
+
+        drip::CreateCustomerParams existing;
+        existing.external_customer_id = "ext_bulk_3";
+        std::string existing_id = client.createCustomer(existing).id;
+
+        /* 40 new or existing customers and one invalid input */
+        std::vector<drip::CreateCustomerParams> params(41);
+        for (int i = 0; i < 40; ++i) {
+            std::ostringstream ext;
+            ext << "ext_bulk_" << i;
+            params[i].external_customer_id = ext.str();
+        }
+        drip::CreateCustomersOptions options;
+        options.concurrency = 8;
+        CountingProgress progress;
+        options.progress = &progress;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        drip::CreateCustomersResult result = client.createCustomers(params, options);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        long elapsed_ms = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+
+        assert(result.items.size() == 41);
+        assert(result.created == 39);
+        assert(result.existed == 1);
+        assert(result.failed == 1);
+        for (int i = 0; i < 40; ++i) {
+            assert(result.items[i].ok);
+            assert(result.items[i].customer.external_customer_id == params[i].external_customer_id);
+        }
+        assert(result.items[3].existed);
+        assert(result.items[3].customer.id == existing_id);
+        assert(!result.items[40].ok);
+        assert(result.items[40].status_code == 400);
+        assert(result.items[40].error_code == "VALIDATION_ERROR");
+        assert(progress.calls == 41);
+        assert(progress.last_completed == 41);
+        /* Serially this would take over 2 s */
+        assert(elapsed_ms < 1500);
+
+        /* Running it again: everything already exists */
+        params.pop_back();
+        uint64_t requests = client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests;
+        result = client.createCustomers(params, options);
+        assert(result.existed == 40);
+        assert(result.failed == 0);
+        assert(result.items[3].customer.id == existing_id);
+
+        /* One filtered lookup per duplicate; the resolveCustomer() index stays off */
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == requests + 80);
+        assert(client.metrics().cache(drip::CACHE_CUSTOMER_INDEX).misses == 0);
+        assert(client.metrics().cache(drip::CACHE_CUSTOMER_INDEX).entries == 0);
+
+        /* Items are spans of the bulk call and share its deadline */
+        SpanRecorder recorder;
+        drip::Config traced = mock_config(slow);
+        traced.trace_hooks = &recorder;
+        drip::Client traced_client(traced);
+        std::vector<drip::CreateCustomerParams> batch(10);
+        for (int i = 0; i < 10; ++i) {
+            std::ostringstream ext;
+            ext << "ext_bulk_deadline_" << i;
+            batch[i].external_customer_id = ext.str();
+        }
+        drip::CreateCustomersOptions serial;
+        serial.concurrency = 1;
+        drip::RequestOptions bounded;
+        bounded.timeout_ms = 200;
+        result = traced_client.createCustomers(batch, serial, bounded);
+        assert(result.created > 0 && result.created < 10);
+        for (int i = 0; i < 10; ++i) {
+            assert(result.items[i].ok || result.items[i].error_code == "TIMEOUT");
+        }
+        assert(recorder.checkChildrenOf("createCustomers") == 10);
+
+        /* A throwing progress callback stops the import */
+        CountingProgress stopping;
+        stopping.fail_at = 2;
+        options.progress = &stopping;
+        bool stopped = false;
+        try {
+            client.createCustomers(params, options);
+        } catch (const std::runtime_error&) {
+            stopped = true;
+        }
+        assert(stopped);
+
+        slow.stop();
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+void test_multi_get(drip::mock::MockServer& server) {
+    TEST(multi_get) {
+        drip::Client creator(mock_config(server));
+        std::vector<std::string> ids;
+        drip::CreateCustomerParams cparams;
+        for (int i = 0; i < 3; ++i) {
+            std::ostringstream ext;
+            ext << "ext_multi_" << i;
+            cparams.external_customer_id = ext.str();
+            ids.push_back(creator.createCustomer(cparams).id);
+        }
+        ids.push_back("cus_multi_missing");
+        ids.push_back(ids[0]);
+
+        drip::Config cfg = mock_config(server);
+        cfg.customer_cache.enabled = true;
+        cfg.balance_cache.enabled = true;
+        drip::Client client(cfg);
+
+        /* Input order, one request per distinct id, errors per id */
+        std::vector<drip::CustomerLookup> customers = client.getCustomers(ids);
+        assert(customers.size() == 5);
+        for (size_t i = 0; i < customers.size(); ++i) {
+            assert(customers[i].customer_id == ids[i]);
+            assert(customers[i].ok == (i != 3));
+            if (customers[i].ok) assert(customers[i].customer.id == ids[i]);
+        }
+        assert(customers[3].status_code == 404);
+        assert(customers[3].error_code == "NOT_FOUND");
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == 4);
+
+        /* Served from the customer cache, including the miss */
+        customers = client.getCustomers(ids);
+        assert(customers[4].ok);
+        assert(customers[3].status_code == 404);
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == 4);
+
+        std::vector<drip::BalanceLookup> balances = client.getBalances(ids);
+        assert(balances.size() == 5);
+        assert(balances[0].ok && !balances[0].balance.estimated);
+        assert(balances[0].balance.balance_usdc == balances[4].balance.balance_usdc);
+        assert(!balances[3].ok);
+        assert(balances[3].status_code == 404);
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == 8);
+
+        /* Balance estimates; only the unknown id is asked again */
+        balances = client.getBalances(ids);
+        assert(balances[1].ok && balances[1].balance.estimated);
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == 9);
+
+        assert(client.getCustomers(std::vector<std::string>()).empty());
+
+        /* Fetches are spans of the multi-get */
+        SpanRecorder recorder;
+        drip::Config traced = mock_config(server);
+        traced.trace_hooks = &recorder;
+        drip::Client traced_client(traced);
+        traced_client.getBalances(ids);
+        assert(recorder.checkChildrenOf("getBalances") == 4);
+
+        /* ...and share its deadline */
+        drip::mock::MockServerOptions mock_options;
+        mock_options.latency_ms = 50;
+        drip::mock::MockServer slow(mock_options);
+        slow.start();
+        drip::Client slow_creator(mock_config(slow));
+        std::vector<std::string> slow_ids;
+        for (int i = 0; i < 8; ++i) {
+            std::ostringstream ext;
+            ext << "ext_multi_slow_" << i;
+            cparams.external_customer_id = ext.str();
+            slow_ids.push_back(slow_creator.createCustomer(cparams).id);
+        }
+        drip::Client slow_client(mock_config(slow));
+        drip::MultiGetOptions serial;
+        serial.concurrency = 1;
+        drip::RequestOptions bounded;
+        bounded.timeout_ms = 200;
+        customers = slow_client.getCustomers(slow_ids, serial, bounded);
+        int fetched = 0;
+        for (size_t i = 0; i < customers.size(); ++i) {
+            if (customers[i].ok) {
+                ++fetched;
+            } else {
+                assert(customers[i].error_code == "TIMEOUT");
+            }
+        }
+        assert(fetched > 0 && fetched < 8);
+        slow.stop();
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+static void sleep_ms(int ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+void test_id_cache() {
+    TEST(id_cache) {
+        drip::mock::MockServer fresh;
+        fresh.start();
+        const char* path = "id_cache_test.bin";
+        std::remove(path);
+
+        drip::Config cfg = mock_config(fresh);
+        cfg.id_cache.path = path;
+        cfg.id_cache.reload_check_ms = 1;
+        drip::Client writer(cfg);
+        drip::CreateCustomerParams cparams;
+        std::vector<std::string> ids;
+        for (int i = 0; i < 3; ++i) {
+            std::ostringstream ext;
+            ext << "ext_idc_" << i;
+            cparams.external_customer_id = ext.str();
+            ids.push_back(writer.createCustomer(cparams).id);
+        }
+        drip::RecordRunParams run;
+        run.customer_id = ids[0];
+        run.workflow = "id-cache-flow";
+        run.status = drip::RUN_COMPLETED;
+        std::string workflow_id = writer.recordRun(run).run.workflow_id;
+        writer.refreshIdCache();
+
+        /* A new client resolves from the file without asking the API */
+        drip::Client reader(cfg);
+        assert(reader.resolveCustomer("ext_idc_1") == ids[1]);
+        assert(reader.recordRun(run).run.workflow_id == workflow_id);
+        assert(reader.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == 0);
+        assert(reader.metrics().endpoint(drip::ENDPOINT_WORKFLOWS).requests == 0);
+        assert(reader.metrics().cache(drip::CACHE_ID_CACHE).hits == 2);
+        assert(reader.metrics().cache(drip::CACHE_ID_CACHE).entries == 4);
+
+        /* A miss only lists customers created after the file was written */
+        cparams.external_customer_id = "ext_idc_new";
+        std::string new_id = writer.createCustomer(cparams).id;
+        assert(reader.resolveCustomer("ext_idc_new") == new_id);
+        assert(reader.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == 1);
+
+        /* A rewritten file is picked up by running readers */
+        cparams.external_customer_id = "ext_idc_late";
+        std::string late_id = writer.createCustomer(cparams).id;
+        writer.refreshIdCache();
+        sleep_ms(5);
+        assert(reader.resolveCustomer("ext_idc_late") == late_id);
+        assert(reader.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == 1);
+
+        /* A refreshing client writes the file on its own */
+        const char* background_path = "id_cache_background_test.bin";
+        std::remove(background_path);
+        drip::Config bg = mock_config(fresh);
+        bg.id_cache.path = background_path;
+        bg.id_cache.refresh_interval_ms = 60000;
+        {
+            drip::Client refresher(bg);
+            bool written = false;
+            for (int i = 0; i < 200 && !written; ++i) {
+                std::ifstream probe(background_path);
+                written = probe.good();
+                if (!written) sleep_ms(10);
+            }
+            assert(written);
+        }
+        drip::Config bg_reader = bg;
+        bg_reader.id_cache.refresh_interval_ms = 0;
+        drip::Client from_background(bg_reader);
+        assert(from_background.resolveCustomer("ext_idc_late") == late_id);
+        assert(from_background.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == 0);
+        std::remove(background_path);
+
+        /* A list shorter than the file's offset (customers removed) is read again from the start */
+        drip::mock::MockServer shorter;
+        shorter.start();
+        drip::Config shorter_cfg = mock_config(shorter);
+        shorter_cfg.id_cache.path = path;
+        cparams.external_customer_id = "ext_idc_shorter";
+        std::string shorter_id = drip::Client(mock_config(shorter)).createCustomer(cparams).id;
+        drip::Client rescanning(shorter_cfg);
+        assert(rescanning.resolveCustomer("ext_idc_shorter") == shorter_id);
+        assert(rescanning.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests == 2);
+        shorter.stop();
+
+        /* A damaged file is ignored */
+        std::ofstream damaged(path, std::ios::binary | std::ios::trunc);
+        damaged << "DRIPIDC1 but not really";
+        damaged.close();
+        drip::Client after_damage(cfg);
+        assert(after_damage.resolveCustomer("ext_idc_2") == ids[2]);
+        assert(after_damage.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).requests > 0);
+        std::remove(path);
+
+        fresh.stop();
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+struct CoalesceArgs {
+    drip::Client* client;
+    std::string customer_id;
+    bool ok;
+    bool not_found;
+};
+
+static void* get_customer_thread(void* arg) {
+    CoalesceArgs* a = static_cast<CoalesceArgs*>(arg);
+    try {
+        a->ok = a->client->getCustomer(a->customer_id).id == a->customer_id;
+    } catch (const drip::NotFoundError&) {
+        a->not_found = true;
+    } catch (const std::exception&) {
+    }
+    return NULL;
+}
+
+/* Run getCustomer(customer_id) on `n` threads at once; returns how many succeeded. */
+static int concurrent_get_customer(drip::Client& client, const std::string& customer_id, int n,
+                                   int& not_found) {
+    pthread_t threads[8];
+    CoalesceArgs args[8];
+    for (int i = 0; i < n; ++i) {
+        args[i].client = &client;
+        args[i].customer_id = customer_id;
+        args[i].ok = false;
+        args[i].not_found = false;
+        pthread_create(&threads[i], NULL, get_customer_thread, &args[i]);
+    }
+    int ok = 0;
+    not_found = 0;
+    for (int i = 0; i < n; ++i) {
+        pthread_join(threads[i], NULL);
+        if (args[i].ok) ++ok;
+        if (args[i].not_found) ++not_found;
+    }
+    return ok;
+}
+
+void test_coalesced_gets() {
+    TEST(coalesced_gets) {
+        drip::mock::MockServerOptions options;
+        options.latency_ms = 200;
+        drip::mock::MockServer slow(options);
+        slow.start();
+        drip::Client client(mock_config(slow));
+
+        drip::CreateCustomerParams cparams;
+        cparams.external_customer_id = "ext_coalesce";
+        std::string id = client.createCustomer(cparams).id;
+
+        /* Threads that arrive while the first GET is in flight share it */
+        int not_found = 0;
+        assert(concurrent_get_customer(client, id, 8, not_found) == 8);
+        drip::EndpointMetrics em = client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS);
+        assert(em.coalesced > 0);
+        assert(em.requests - 1 + em.coalesced == 8);
+
+        /* Errors are shared too */
+        assert(concurrent_get_customer(client, "cus_coalesce_missing", 8, not_found) == 0);
+        assert(not_found == 8);
+
+        /* Disabled: every call sends its own request */
+        drip::Config cfg = mock_config(slow);
+        cfg.coalesce_gets = false;
+        drip::Client separate(cfg);
+        assert(concurrent_get_customer(separate, id, 4, not_found) == 4);
+        em = separate.metrics().endpoint(drip::ENDPOINT_CUSTOMERS);
+        assert(em.requests == 4);
+        assert(em.coalesced == 0);
+
+        slow.stop();
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+static void* cancel_after_50ms(void* arg) {
+    struct timespec ts = { 0, 50 * 1000000L };
+    nanosleep(&ts, NULL);
+    static_cast<drip::CancellationToken*>(arg)->cancel();
+    return NULL;
+}
+
+void test_cancellation() {
+    TEST(cancellation) {
+        drip::mock::MockServerOptions options;
+        options.latency_ms = 1000;
+        drip::mock::MockServer slow(options);
+        slow.start();
+        drip::Client client(mock_config(slow));
+
+        /* Cancelled mid-transfer: aborts well before the server answers */
+        drip::CancellationToken token;
+        drip::RequestOptions opts;
+        opts.cancellation = &token;
+        pthread_t canceller;
+        pthread_create(&canceller, NULL, cancel_after_50ms, &token);
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        bool cancelled = false;
+        try {
+            client.getCustomer("cus_slow", opts);
+        } catch (const drip::CancelledError& e) {
+            cancelled = true;
+            assert(e.code() == "CANCELLED");
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        pthread_join(canceller, NULL);
+        long elapsed_ms = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+        assert(cancelled);
+        assert(elapsed_ms < 600);
+        assert(client.metrics().endpoint(drip::ENDPOINT_CUSTOMERS).errors[drip::ERROR_CANCELLED] == 1);
+
+        /* Already cancelled: nothing is sent */
+        cancelled = false;
+        try {
+            client.ping(opts);
+        } catch (const drip::CancelledError&) {
+            cancelled = true;
+        }
+        assert(cancelled);
+        assert(client.metrics().endpoint(drip::ENDPOINT_HEALTH).requests == 0);
+
+        slow.stop();
+        PASS();
+    } catch (const std::exception& e) {
+        FAIL(e.what());
+    }
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+int main() {
+    std::cout << "Drip C++ SDK (C++03) Integration Tests" << std::endl;
+    std::cout << "======================================" << std::endl;
+
+    std::signal(SIGPIPE, SIG_IGN);
+
+    drip::mock::MockServer server;
+    server.start();
+
+    test_customer_lifecycle(server);
+    test_track_usage_debits_balance(server);
+    test_ack_only(server);
+    test_record_run(server);
+    test_ping_and_auth(server);
+    test_error_injection();
+    test_retry_policy(server);
+    test_circuit_breaker_recovers(server);
+    test_call_deadline(server);
+    test_cancellation();
+    test_hedged_reads(server);
+    test_hedge_failed_leg_loses(server);
+    test_failover(server);
+    test_health_monitor(server);
+    test_customer_cache(server);
+    test_customer_index(server);
+    test_balance_cache(server);
+    test_coalesced_gets();
+    test_conditional_gets(server);
+    test_customer_iterator();
+    test_export_customers();
+    test_create_customers();
+    test_multi_get(server);
+    test_id_cache();
+
+    server.stop();
+
+    std::cout << std::endl;
+    std::cout << "Results: " << tests_passed << " passed, "
+              << tests_failed << " failed" << std::endl;
+
+    return tests_failed > 0 ? 1 : 0;
+}